@@ -0,0 +1,76 @@
+#include "../../src/dev/cipsim.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+/*
+
+1. Load the tag database
+2. Start the simulator
+3. Serve until Enter is pressed
+4. Stop the simulator
+
+Usage:
+	cip_sim                   default tags on port 44818
+	cip_sim <config_file>     tags and settings from file (see sample_tags.txt)
+	cip_sim <port>            default tags on another port
+
+Then connect with plcscan::connect("127.0.0.1:<port>", "1,0", data)
+
+*/
+
+
+static bool is_number(cstr str)
+{
+	if (!*str)
+	{
+		return false;
+	}
+
+	for (; *str; ++str)
+	{
+		if (*str < '0' || *str > '9')
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+int main(int argc, char* argv[])
+{
+	// 1. Load the tag database
+	auto config = cipsim::default_config();
+
+	if (argc > 1)
+	{
+		if (is_number(argv[1]))
+		{
+			config.port = (u16)std::atoi(argv[1]);
+		}
+		else if (!cipsim::load_config(argv[1], config))
+		{
+			printf("Error. Invalid config file %s\n", argv[1]);
+			return 1;
+		}
+	}
+
+	// 2. Start the simulator
+	if (!cipsim::start(config))
+	{
+		printf("Error. Could not start simulator on port %u\n", (unsigned)config.port);
+		return 1;
+	}
+
+	printf("Serving %u tags and %u UDTs on 127.0.0.1:%u\n", (unsigned)config.tags.size(), (unsigned)config.udts.size(), (unsigned)config.port);
+
+	// 3. Serve until Enter is pressed
+	printf("Press Enter to stop\n");
+	getchar();
+
+	// 4. Stop the simulator
+	cipsim::stop();
+	return 0;
+}
@@ -0,0 +1,216 @@
+#include "../../src/plcscan/historian.hpp"
+#include "../../src/dev/cipsim.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+
+Record scans to a capture file and read them back
+
+1. Start a simulated controller
+2. Initialize the library and connect to the controller
+3. Start recording and record every scan
+4. Stop recording
+5. Open the capture and list its schemas and blocks
+6. Decode each block and report the compression
+7. Replay the capture through a scan callback
+
+Usage:
+	historian [capture_file] [n_scans]     record, read and replay
+	historian read <capture_file>          read only
+	historian replay <capture_file> [speed]  replay only, speed 0 is as fast as possible
+
+*/
+
+
+constexpr u16 SIM_PORT = 44930;
+constexpr auto SIM_GATEWAY = "127.0.0.1:44930";
+constexpr auto SIM_PATH = "1,0";
+
+constexpr auto DEFAULT_CAPTURE_FILE = "plcscan_capture.plch";
+constexpr u32 DEFAULT_N_SCANS = 500;
+constexpr f64 DEFAULT_REPLAY_SPEED = 0.0;
+
+
+static f64 to_mb(u64 n_bytes)
+{
+	return n_bytes / (1024.0 * 1024.0);
+}
+
+
+static bool record_capture(cstr capture_file, u32 n_scans)
+{
+	// 1. Start a simulated controller
+	auto sim_config = cipsim::default_config();
+	sim_config.port = SIM_PORT;
+
+	if (!cipsim::start(sim_config))
+	{
+		printf("Error. Could not start simulator\n");
+		return false;
+	}
+
+	// 2. Initialize the library and connect to the controller
+	auto plc_data = plcscan::init();
+
+	if (!plc_data.is_init || !plcscan::connect(SIM_GATEWAY, SIM_PATH, plc_data))
+	{
+		printf("Error. Could not connect to simulator\n");
+		cipsim::stop();
+		return false;
+	}
+
+	// 3. Start recording and record every scan
+	if (!historian::start_recording(capture_file, plc_data))
+	{
+		printf("Error. Could not create %s\n", capture_file);
+		plcscan::shutdown();
+		cipsim::stop();
+		return false;
+	}
+
+	u32 scan_count = 0;
+
+	auto const record_scan = [&](plcscan::PlcTagData const& data)
+	{
+		historian::record(data);
+		scan_count++;
+	};
+
+	auto const still_scanning = [&]() { return scan_count < n_scans; };
+
+	printf("Recording %u scans of %u tags to %s\n", n_scans, (u32)plc_data.tags.size(), capture_file);
+
+	plcscan::scan(record_scan, still_scanning, plc_data);
+
+	// 4. Stop recording
+	historian::stop_recording();
+
+	auto stats = historian::get_recorder_stats();
+
+	plcscan::shutdown();
+	cipsim::stop();
+
+	printf("  recorded: %llu\n", (unsigned long long)stats.snapshots_recorded);
+	printf("   dropped: %llu\n", (unsigned long long)stats.snapshots_dropped);
+	printf("    blocks: %llu\n", (unsigned long long)stats.blocks_written);
+	printf("record max: %.3f ms\n\n", stats.max_record_ms);
+
+	return true;
+}
+
+
+static bool read_capture(cstr capture_file)
+{
+	// 5. Open the capture and list its schemas and blocks
+	historian::Capture capture;
+
+	if (!historian::open_capture(capture_file, capture))
+	{
+		printf("Error. Could not open %s\n", capture_file);
+		return false;
+	}
+
+	printf("%s\n", capture_file);
+	printf("   schemas: %u\n", (u32)capture.schemas.size());
+	printf("    blocks: %u\n", (u32)capture.blocks.size());
+	printf("      rows: %llu\n", (unsigned long long)capture.n_rows);
+	printf("  duration: %.3f s\n\n", (capture.last_us - capture.first_us) / 1'000'000.0);
+
+	for (auto const& schema : capture.schemas)
+	{
+		printf("schema %u: %u tags, %u UDTs, %u bytes per scan\n",
+			schema.schema_id, (u32)schema.tags.size(), (u32)schema.udt_types.size(), schema.row_size);
+	}
+
+	// 6. Decode each block and report the compression
+	historian::CaptureBlock block;
+
+	u64 raw_bytes = 0;
+
+	for (u32 i = 0; i < (u32)capture.blocks.size(); ++i)
+	{
+		if (!historian::read_block(i, capture, block))
+		{
+			printf("Error. Block %u is not valid\n", i);
+			historian::close_capture(capture);
+			return false;
+		}
+
+		raw_bytes += block.values.size() + block.timestamps_us.size() * sizeof(u64);
+	}
+
+	auto file_bytes = capture.file.size;
+
+	printf("\n  raw: %.3f MB\n", to_mb(raw_bytes));
+	printf(" file: %.3f MB\n", to_mb(file_bytes));
+	printf("ratio: %.1f\n", file_bytes ? (f64)raw_bytes / file_bytes : 0.0);
+
+	historian::close_capture(capture);
+
+	return true;
+}
+
+
+static bool replay_capture(cstr capture_file, f64 speed)
+{
+	// 7. Replay the capture through a scan callback
+	historian::ReplayConfig config;
+	config.speed = speed;
+
+	u64 scan_count = 0;
+	u64 changed_count = 0;
+
+	auto const process_scan = [&](plcscan::PlcTagData const& data)
+	{
+		scan_count++;
+		changed_count += data.changed_tags.size();
+	};
+
+	auto const still_replaying = []() { return true; };
+
+	printf("\nReplaying %s at %.1fx\n", capture_file, speed);
+
+	if (!historian::replay(capture_file, process_scan, still_replaying, config))
+	{
+		printf("Error. Could not replay %s\n", capture_file);
+		return false;
+	}
+
+	printf("       scans: %llu\n", (unsigned long long)scan_count);
+	printf("changed/scan: %.1f\n", scan_count ? (f64)changed_count / scan_count : 0.0);
+
+	return true;
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (argc > 2 && !strcmp(argv[1], "read"))
+	{
+		return read_capture(argv[2]) ? 0 : 1;
+	}
+
+	if (argc > 2 && !strcmp(argv[1], "replay"))
+	{
+		auto speed = argc > 3 ? atof(argv[3]) : 1.0;
+		return replay_capture(argv[2], speed) ? 0 : 1;
+	}
+
+	auto capture_file = argc > 1 ? argv[1] : DEFAULT_CAPTURE_FILE;
+	auto n_scans = argc > 2 ? (u32)atoi(argv[2]) : DEFAULT_N_SCANS;
+
+	if (!record_capture(capture_file, n_scans))
+	{
+		return 1;
+	}
+
+	if (!read_capture(capture_file))
+	{
+		return 1;
+	}
+
+	return replay_capture(capture_file, DEFAULT_REPLAY_SPEED) ? 0 : 1;
+}
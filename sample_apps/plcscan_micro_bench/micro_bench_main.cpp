@@ -0,0 +1,684 @@
+// benchmarks reach into plcscan.cpp, no PLC or network needed
+#define DEVPLCTAG
+#include "../../src/plcscan/plcscan.cpp"
+#include "../plcscan_tag_viewer/app/value_map.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h> // _aligned_malloc
+#include <intrin.h> // _ReadWriteBarrier
+#endif
+
+/*
+
+Microbenchmarks for the plcscan parse and publish paths
+
+1. Build synthetic @tags and @udt buffers
+2. Time each function until it has run for at least MIN_BENCH_MS
+3. Report ns/op, MB/s and heap allocations per op
+
+Allocations count calls to every form of operator new.
+MemoryBuffer allocations use malloc and are not counted.
+
+*/
+
+
+constexpr f64 MIN_BENCH_MS = 200.0;
+
+
+/* allocation counter */
+
+static std::atomic<u64> g_n_allocations = 0;
+
+
+static void* allocate(std::size_t size)
+{
+	g_n_allocations++;
+
+	return std::malloc(size ? size : 1);
+}
+
+
+static void* allocate_aligned(std::size_t size, std::align_val_t align)
+{
+	g_n_allocations++;
+
+	auto alignment = (std::size_t)align;
+	size = size ? size : 1;
+
+#ifdef _WIN32
+	return _aligned_malloc(size, alignment);
+#else
+	// a multiple of the alignment
+	return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+
+static void free_aligned(void* p)
+{
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+
+
+static void* allocate_or_throw(std::size_t size)
+{
+	auto p = allocate(size);
+	if (!p)
+	{
+		throw std::bad_alloc();
+	}
+
+	return p;
+}
+
+
+static void* allocate_aligned_or_throw(std::size_t size, std::align_val_t align)
+{
+	auto p = allocate_aligned(size, align);
+	if (!p)
+	{
+		throw std::bad_alloc();
+	}
+
+	return p;
+}
+
+
+void* operator new(std::size_t size) { return allocate_or_throw(size); }
+void* operator new[](std::size_t size) { return allocate_or_throw(size); }
+
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept { return allocate(size); }
+void* operator new[](std::size_t size, std::nothrow_t const&) noexcept { return allocate(size); }
+
+void* operator new(std::size_t size, std::align_val_t align) { return allocate_aligned_or_throw(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return allocate_aligned_or_throw(size, align); }
+
+void* operator new(std::size_t size, std::align_val_t align, std::nothrow_t const&) noexcept { return allocate_aligned(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align, std::nothrow_t const&) noexcept { return allocate_aligned(size, align); }
+
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+void operator delete(void* p, std::nothrow_t const&) noexcept { std::free(p); }
+void operator delete[](void* p, std::nothrow_t const&) noexcept { std::free(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept { free_aligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { free_aligned(p); }
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { free_aligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { free_aligned(p); }
+
+void operator delete(void* p, std::align_val_t, std::nothrow_t const&) noexcept { free_aligned(p); }
+void operator delete[](void* p, std::align_val_t, std::nothrow_t const&) noexcept { free_aligned(p); }
+
+
+/* benchmark runner */
+
+// keeps results from being optimized away
+static u64 g_sink = 0;
+
+
+// the compiler has to assume that g_sink is read here
+static inline void read_sink()
+{
+#ifdef _MSC_VER
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "r"(&g_sink) : "memory");
+#endif
+}
+
+
+class BenchResult
+{
+public:
+	std::string name;
+
+	u64 n_ops = 0;
+	u64 bytes_per_op = 0;
+	u64 n_allocations = 0;
+
+	f64 total_ns = 0.0;
+};
+
+
+static void print_header()
+{
+	printf("%-44s %14s %12s %12s %12s\n", "benchmark", "ops", "ns/op", "MB/s", "allocs/op");
+}
+
+
+static void print_result(BenchResult const& result)
+{
+	auto n_ops = (f64)result.n_ops;
+
+	auto ns_per_op = result.total_ns / n_ops;
+	auto mb_per_sec = result.bytes_per_op ? (f64)result.bytes_per_op * n_ops / result.total_ns * 1000.0 : 0.0;
+	auto allocs_per_op = (f64)result.n_allocations / n_ops;
+
+	printf("%-44s %14llu %12.1f %12.1f %12.2f\n", result.name.c_str(), (unsigned long long)result.n_ops, ns_per_op, mb_per_sec, allocs_per_op);
+}
+
+
+template <class FUNC>
+static void run_bench(std::string const& name, u64 bytes_per_op, FUNC const& func)
+{
+	using clock = std::chrono::steady_clock;
+
+	constexpr f64 min_ns = MIN_BENCH_MS * 1'000'000.0;
+
+	func(); // warm up
+	read_sink();
+
+	BenchResult result{};
+	result.name = name;
+	result.bytes_per_op = bytes_per_op;
+
+	u64 n_ops = 1;
+
+	for (;;)
+	{
+		auto allocs_begin = g_n_allocations.load();
+		auto time_begin = clock::now();
+
+		for (u64 i = 0; i < n_ops; ++i)
+		{
+			func();
+			read_sink();
+		}
+
+		auto ns = (f64)std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - time_begin).count();
+
+		if (ns >= min_ns)
+		{
+			result.n_ops = n_ops;
+			result.total_ns = ns;
+			result.n_allocations = g_n_allocations.load() - allocs_begin;
+			break;
+		}
+
+		auto scale = ns > 0.0 ? 1.2 * min_ns / ns : 100.0;
+		scale = scale < 2.0 ? 2.0 : (scale > 100.0 ? 100.0 : scale);
+
+		n_ops = (u64)(n_ops * scale);
+	}
+
+	print_result(result);
+}
+
+
+/* synthetic controller data */
+
+namespace
+{
+	static void push16(std::vector<u8>& dst, u16 value)
+	{
+		dst.push_back((u8)(value & 0xFF));
+		dst.push_back((u8)(value >> 8));
+	}
+
+
+	static void push32(std::vector<u8>& dst, u32 value)
+	{
+		push16(dst, (u16)(value & 0xFFFF));
+		push16(dst, (u16)(value >> 16));
+	}
+
+
+	static void push_str(std::vector<u8>& dst, std::string const& str)
+	{
+		dst.insert(dst.end(), str.begin(), str.end());
+	}
+
+
+	static std::vector<u8> make_tag_listing(u32 n_tags)
+	{
+		// fixed types, arrays and udts in roughly the mix of a real controller
+		constexpr u16 type_codes[] = { 0xC1, 0xC2, 0xC3, 0xC4, 0xC4, 0xC4, 0xC5, 0xCA, 0xCA, 0xCB, 0xD0 };
+		constexpr u16 type_sizes[] = { 1, 1, 2, 4, 4, 4, 8, 4, 4, 8, 88 };
+		constexpr u32 n_types = (u32)(sizeof(type_codes) / sizeof(type_codes[0]));
+
+		std::vector<u8> listing;
+		listing.reserve((size_t)n_tags * 40);
+
+		for (u32 i = 0; i < n_tags; ++i)
+		{
+			auto t = i % n_types;
+
+			u16 symbol = type_codes[t];
+			u16 elem_size = type_sizes[t];
+			u32 dim = 0;
+
+			if (i % 7 == 0)
+			{
+				symbol = (u16)(0x8000 | (100 + i % 20));
+				elem_size = 48;
+			}
+
+			if (i % 5 == 0)
+			{
+				symbol |= 0x2000;
+				dim = 2 + i % 30;
+			}
+
+			auto name = "Synthetic_Tag_" + std::to_string(i);
+
+			push32(listing, i + 1);
+			push16(listing, symbol);
+			push16(listing, elem_size);
+			push32(listing, dim);
+			push32(listing, 0);
+			push32(listing, 0);
+			push16(listing, (u16)name.length());
+			push_str(listing, name);
+		}
+
+		return listing;
+	}
+
+
+	static std::vector<u8> make_udt_listing(u32 n_fields)
+	{
+		std::vector<u8> listing;
+
+		u32 udt_size = 0;
+
+		std::vector<u8> fields;
+
+		for (u32 i = 0; i < n_fields; ++i)
+		{
+			u16 info = 0;
+			u16 type = (u16)(0xC2 + i % 10);
+			u32 size = 4;
+
+			if (i % 4 == 0)
+			{
+				info = 10;
+				type |= 0x2000;
+				size = 40;
+			}
+
+			push16(fields, info);
+			push16(fields, type);
+			push32(fields, udt_size);
+
+			udt_size += size;
+		}
+
+		push16(listing, (u16)(0x8000 | 101));
+		push32(listing, 0);
+		push32(listing, udt_size);
+		push16(listing, (u16)n_fields);
+		push16(listing, 0x1234);
+
+		listing.insert(listing.end(), fields.begin(), fields.end());
+
+		push_str(listing, "Synthetic_UDT;n");
+		listing.push_back(0);
+
+		for (u32 i = 0; i < n_fields; ++i)
+		{
+			push_str(listing, "Field_" + std::to_string(i));
+			listing.push_back(0);
+		}
+
+		return listing;
+	}
+
+
+	static ByteView to_view(std::vector<u8>& bytes)
+	{
+		ByteView view{};
+		view.data = bytes.data();
+		view.length = (u32)bytes.size();
+
+		return view;
+	}
+
+
+	// about one packet per fragment, entries are split between them
+	constexpr u32 LISTING_FRAGMENT_SIZE = 4000;
+
+
+	static void push_tag_listing(ByteView const& view, u32 fragment_size, TagEntryStream& stream)
+	{
+		for (u32 begin = 0; begin < view.length; begin += fragment_size)
+		{
+			auto end = std::min(begin + fragment_size, view.length);
+			push_tag_entry_bytes(stream, mb::sub_view(view, begin, end));
+		}
+	}
+
+
+	static u64 total_value_bytes(TagEntryList const& entries)
+	{
+		u64 total = 0;
+		for (auto const& e : entries)
+		{
+			total += elem_size(e);
+		}
+
+		return total;
+	}
+}
+
+
+/* benchmarks */
+
+namespace
+{
+	static void bench_tag_listing(u32 n_tags)
+	{
+		auto listing = make_tag_listing(n_tags);
+		auto view = to_view(listing);
+
+		auto suffix = " " + std::to_string(n_tags) + " tags";
+
+		run_bench("push_tag_entry_bytes" + suffix, view.length, [&]()
+		{
+			TagEntryStream stream;
+			push_tag_listing(view, LISTING_FRAGMENT_SIZE, stream);
+
+			g_sink += stream.entries.size();
+		});
+
+		run_bench("push_tag_entry_bytes one fragment" + suffix, view.length, [&]()
+		{
+			TagEntryStream stream;
+			push_tag_listing(view, view.length, stream);
+
+			g_sink += stream.entries.size();
+		});
+
+		TagEntryList entries;
+		entries.reserve(n_tags);
+
+		u64 offset = 0;
+
+		run_bench("append_tag_entry" + suffix, view.length / n_tags, [&]()
+		{
+			if (offset >= view.length)
+			{
+				offset = 0;
+				entries.clear();
+			}
+
+			offset += append_tag_entry(entries, mb::sub_view(view, (u32)offset));
+		});
+	}
+
+
+	static void bench_udt_entry(u32 n_fields)
+	{
+		auto listing = make_udt_listing(n_fields);
+		auto view = to_view(listing);
+
+		run_bench("parse_udt_entry " + std::to_string(n_fields) + " fields", view.length, [&]()
+		{
+			auto entry = parse_udt_entry(view);
+			g_sink += entry.fields.size();
+		});
+	}
+
+
+	static void bench_udt_types(u32 n_udts, u32 n_fields)
+	{
+		auto listing = make_udt_listing(n_fields);
+		auto entry = parse_udt_entry(to_view(listing));
+
+		List<UdtEntry> entries(n_udts, entry);
+
+		for (u32 i = 0; i < n_udts; ++i)
+		{
+			entries[i].udt_id = (u16)(entry.udt_id + i);
+		}
+
+		auto suffix = " " + std::to_string(n_udts) + " x " + std::to_string(n_fields) + " fields";
+
+		DataTypeMemory mem{};
+		PlcTagData data{};
+
+		run_bench("set_udt_types" + suffix, 0, [&]()
+		{
+			set_udt_types(entries, mem, data);
+			g_sink += data.udt_fields.size();
+		});
+
+		index_udt_types(data);
+
+		run_bench("walk udt fields" + suffix, 0, [&]()
+		{
+			u64 total = 0;
+
+			for (auto const& udt : data.udt_types)
+			{
+				for (auto const& field : udt.fields)
+				{
+					total += field.offset;
+				}
+			}
+
+			g_sink += total;
+		});
+
+		destroy_data_type_memory(mem);
+	}
+
+
+	static void bench_tag_memory(u32 n_tags)
+	{
+		auto listing = make_tag_listing(n_tags);
+		TagEntryStream stream;
+		push_tag_listing(to_view(listing), LISTING_FRAGMENT_SIZE, stream);
+
+		auto& entries = stream.entries;
+		auto value_bytes = total_value_bytes(entries);
+
+		auto suffix = " " + std::to_string(n_tags) + " tags";
+
+		run_bench("create_tags" + suffix, value_bytes, [&]()
+		{
+			TagMemory mem{};
+			List<Tag> tags;
+
+			create_tags(entries, mem, tags);
+			g_sink += tags.size();
+
+			destroy_tag_memory(mem);
+		});
+
+		TagMemory mem{};
+		List<Tag> tags;
+
+		if (!create_tags(entries, mem, tags))
+		{
+			printf("Error. create_tags failed\n");
+			return;
+		}
+
+		// plain copy, the floor for copy_changed_tags
+		run_bench("copy scan_data" + suffix, value_bytes, [&]()
+		{
+			mh::copy(mb::make_read_view(mem.scan_data), mb::make_view(mem.public_tag_data));
+			g_sink += mem.public_tag_data.data_[0];
+		});
+
+		List<u32> changed_tags;
+		u32 n_changes = 0;
+
+		run_bench("copy_changed_tags" + suffix, value_bytes, [&]()
+		{
+			// about 1% of tags change each scan
+			auto read_view = mb::make_read_view(mem.scan_data);
+			for (u32 i = 0; i < mem.n_tags / 100; ++i)
+			{
+				auto& offset = mem.connections[(i * 97 + n_changes) % mem.n_tags].scan_offset;
+				read_view.data[offset.begin]++;
+			}
+
+			++n_changes;
+
+			copy_changed_tags(mem, changed_tags);
+			g_sink += changed_tags.size();
+		});
+
+		PlcTagData data{};
+		data.tags = tags;
+		data.is_connected = true;
+
+		ColumnView columns{};
+		plcscan::update_columns(data, columns);
+
+		u64 column_bytes = 0;
+		for (auto const& col : columns.columns)
+		{
+			column_bytes += col.values.size();
+		}
+
+		run_bench("update_columns" + suffix, column_bytes, [&]()
+		{
+			plcscan::update_columns(data, columns);
+			g_sink += columns.columns[0].values.size();
+		});
+
+		run_bench("flip_read_write", 0, [&]()
+		{
+			mb::flip_read_write(mem.scan_data);
+			g_sink += mem.scan_data.read_id;
+		});
+
+		destroy_tag_memory(mem);
+	}
+
+
+	// every 4 or 8 byte value of a UDT array, the scalar copy against gather_4() and gather_8()
+	template <u32 SIZE>
+	static void bench_gather(u32 n_values, u32 stride)
+	{
+		std::vector<u8> base((size_t)n_values * stride + SIZE, 0xA5);
+		std::vector<u32> offsets(n_values);
+		std::vector<u8> dst((size_t)n_values * SIZE);
+
+		for (u32 i = 0; i < n_values; ++i)
+		{
+			offsets[i] = i * stride;
+		}
+
+		auto suffix = " " + std::to_string(SIZE) + " bytes " + std::to_string(n_values) + " values";
+		auto n_bytes = (u64)n_values * SIZE;
+
+		run_bench("gather_scalar" + suffix, n_bytes, [&]()
+		{
+			gather_scalar<SIZE>(base.data(), offsets.data(), dst.data(), 0, n_values);
+			g_sink += dst[0];
+		});
+
+		run_bench((SIZE == 4 ? "gather_4" : "gather_8") + suffix, n_bytes, [&]()
+		{
+			auto n = SIZE == 4 ? gather_4(base.data(), offsets.data(), dst.data(), n_values) : gather_8(base.data(), offsets.data(), dst.data(), n_values);
+			gather_scalar<SIZE>(base.data(), offsets.data(), dst.data(), n, n_values);
+			g_sink += dst[0];
+		});
+	}
+
+
+	static void bench_bytes(u32 n_bytes)
+	{
+		std::vector<u8> src(n_bytes, 0xA5);
+		std::vector<u8> dst(n_bytes, 0xA5);
+
+		auto suffix = " " + std::to_string(n_bytes) + " bytes";
+
+		run_bench("mh::copy_bytes" + suffix, n_bytes, [&]()
+		{
+			mh::copy_bytes(src.data(), dst.data(), n_bytes);
+			g_sink += dst[n_bytes - 1];
+		});
+
+		run_bench("mh::bytes_equal" + suffix, n_bytes, [&]()
+		{
+			g_sink += mh::bytes_equal(src.data(), dst.data(), n_bytes);
+		});
+	}
+
+
+	static void bench_map_value(cstr name, plcscan::TagType type, u32 n_bytes)
+	{
+		constexpr u32 str_len = 40;
+
+		std::vector<u8> src(n_bytes + sizeof(int), 0x41);
+		char dst[str_len + 1] = { 0 };
+
+		ByteView src_view{};
+		src_view.data = src.data();
+		src_view.length = n_bytes;
+
+		StringView dst_view{};
+		dst_view.char_data = dst;
+		dst_view.length = str_len;
+
+		run_bench(std::string("map_value ") + name, n_bytes, [&]()
+		{
+			value_map::map_value(src_view, dst_view, type);
+			g_sink += (u8)dst[0];
+		});
+	}
+}
+
+
+int main()
+{
+	using T = plcscan::TagType;
+
+	print_header();
+
+	// 1. and 2. tag listing
+	bench_tag_listing(1'000);
+	bench_tag_listing(10'000);
+	bench_tag_listing(100'000);
+
+	bench_udt_entry(8);
+	bench_udt_entry(64);
+
+	bench_udt_types(1'000, 16);
+
+
+	// tag memory
+	bench_tag_memory(10'000);
+	bench_tag_memory(100'000);
+
+	// column gather, 4 and 8 byte UDT members
+	bench_gather<4>(100'000, 12);
+	bench_gather<8>(100'000, 24);
+
+	// byte helpers
+	for (u32 n_bytes : { 8u, 64u, 1024u, 65536u })
+	{
+		bench_bytes(n_bytes);
+	}
+
+	// tag viewer formatters
+	bench_map_value("DINT", T::DINT, 4);
+	bench_map_value("LINT", T::LINT, 8);
+	bench_map_value("REAL", T::REAL, 4);
+	bench_map_value("LREAL", T::LREAL, 8);
+	bench_map_value("STRING", T::STRING, 88);
+	bench_map_value("UDT hex", T::UDT, 64);
+
+	return 0;
+}
@@ -0,0 +1,623 @@
+#include "../../src/plcscan/plcscan.hpp"
+
+#ifdef DEVPLCTAG
+#include "../../src/dev/devplctag.hpp"
+#else
+#include "../../src/dev/cipsim.hpp"
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+
+#pragma comment(lib, "psapi.lib")
+
+#else
+
+#include <sys/resource.h>
+
+#endif
+
+/*
+
+End-to-end scan benchmark
+
+1. Start a simulated controller with a generated tag database
+2. Initialize the library and connect to the controller
+3. Scan for a fixed time and record every cycle
+4. Append one JSON line of results to the results file
+5. Shutdown
+
+Each tag count runs in its own process so that peak RSS is per run.
+
+The controller is the CIP simulator, read through libplctag over loopback.
+Define DEVPLCTAG for the whole build to use the in-process dev database instead.
+It measures plcscan alone and is the backend for large tag counts.
+
+Usage:
+	scan_bench [results_file] [label]                  each of DEFAULT_TAG_COUNTS
+	scan_bench run <n_tags> <results_file> [label]     one run
+	scan_bench compare <base_file> <new_file>          regression report
+
+compare returns 1 when a metric is worse by more than REGRESSION_PERCENT.
+
+*/
+
+
+constexpr u16 SIM_PORT = 44920;
+constexpr auto SIM_GATEWAY = "127.0.0.1:44920";
+constexpr auto SIM_PATH = "1,0";
+
+constexpr u32 DEV_SEED = 1;
+constexpr u32 DEV_N_UDTS = 32;
+
+constexpr f64 SCAN_SECONDS = 10.0;
+constexpr u32 MIN_CYCLES = 5;
+
+constexpr f64 REGRESSION_PERCENT = 10.0;
+
+#ifdef DEVPLCTAG
+constexpr u32 DEFAULT_TAG_COUNTS[] = { 1'000, 10'000, 100'000 };
+constexpr auto BACKEND_NAME = "devplctag";
+#else
+// libplctag services every tag on each pass of its tickler thread, 100k tags takes hours per cycle
+constexpr u32 DEFAULT_TAG_COUNTS[] = { 1'000, 10'000 };
+constexpr auto BACKEND_NAME = "cipsim";
+#endif
+constexpr auto DEFAULT_RESULTS_FILE = "scan_bench_results.json";
+
+
+using clock_type = std::chrono::steady_clock;
+
+
+static f64 ms_since(clock_type::time_point begin)
+{
+	return std::chrono::duration<f64, std::milli>(clock_type::now() - begin).count();
+}
+
+
+/* process stats */
+
+namespace
+{
+	static f64 process_cpu_ms()
+	{
+#ifdef _WIN32
+
+		FILETIME create, exit, kernel, user;
+		if (!GetProcessTimes(GetCurrentProcess(), &create, &exit, &kernel, &user))
+		{
+			return 0.0;
+		}
+
+		auto const to_100ns = [](FILETIME const& ft) { return ((u64)ft.dwHighDateTime << 32) | ft.dwLowDateTime; };
+
+		return (to_100ns(kernel) + to_100ns(user)) / 10'000.0;
+
+#else
+
+		rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+
+		auto const to_ms = [](timeval const& tv) { return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0; };
+
+		return to_ms(usage.ru_utime) + to_ms(usage.ru_stime);
+
+#endif
+	}
+
+
+	static u64 peak_rss_kb()
+	{
+#ifdef _WIN32
+
+		PROCESS_MEMORY_COUNTERS pmc{};
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		{
+			return 0;
+		}
+
+		return (u64)pmc.PeakWorkingSetSize / 1024;
+
+#else
+
+		rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+
+		return (u64)usage.ru_maxrss; // kilobytes on Linux
+
+#endif
+	}
+}
+
+
+/* controller */
+
+namespace
+{
+#ifdef DEVPLCTAG
+
+	static bool start_controller(u32 n_tags)
+	{
+		// no read latency, times plcscan and not the simulated network
+		dev::DevConfig config{};
+		config.seed = DEV_SEED;
+		config.n_generated_tags = n_tags;
+		config.n_generated_udts = DEV_N_UDTS;
+
+		dev::set_config(config);
+
+		return true;
+	}
+
+
+	static void stop_controller()
+	{
+
+	}
+
+#else
+
+	static cipsim::SimConfig make_sim_config(u32 n_tags)
+	{
+		// keep the UDTs of the default database
+		auto config = cipsim::default_config();
+		config.port = SIM_PORT;
+		config.tags.clear();
+		config.tags.reserve(n_tags);
+
+		cstr type_names[] = 
+		{ 
+			"BOOL", "SINT", "INT", "DINT", "DINT", "DINT", "LINT", "REAL", "REAL", "LREAL", "STRING",
+			"UDTA", "UDTB", "UDTC", "UDTD"
+		};
+
+		constexpr u32 n_types = (u32)(sizeof(type_names) / sizeof(type_names[0]));
+
+		for (u32 i = 0; i < n_tags; ++i)
+		{
+			cipsim::TagConfig tag{};
+			tag.type_name = type_names[i % n_types];
+			tag.tag_name = "Bench_" + tag.type_name + "_" + std::to_string(i);
+			tag.array_count = i % 10 == 0 ? 5 : 1;
+
+			config.tags.push_back(std::move(tag));
+		}
+
+		return config;
+	}
+
+
+	static bool start_controller(u32 n_tags)
+	{
+		return cipsim::start(make_sim_config(n_tags));
+	}
+
+
+	static void stop_controller()
+	{
+		cipsim::stop();
+	}
+
+#endif
+}
+
+
+/* results */
+
+namespace
+{
+	class BenchResult
+	{
+	public:
+		std::string label;
+		std::string backend;
+
+		u32 n_tags = 0;
+		u32 n_tags_found = 0;
+		u32 n_cycles = 0;
+
+		f64 init_ms = 0.0;
+		f64 connect_ms = 0.0;
+
+		f64 cycles_per_sec = 0.0;
+		f64 cycle_p50_ms = 0.0;
+		f64 cycle_p99_ms = 0.0;
+		f64 cycle_max_ms = 0.0;
+
+		f64 cpu_ms_per_cycle = 0.0;
+		f64 peak_rss_kb = 0.0;
+
+		f64 network_ms = 0.0;
+		f64 network_p99_ms = 0.0;
+		f64 process_ms = 0.0;
+		f64 process_p99_ms = 0.0;
+
+		f64 overrun_count = 0.0;
+		f64 tags_failed = 0.0;
+	};
+
+
+	class MetricDef
+	{
+	public:
+		cstr key = 0;
+		f64 BenchResult::* value = 0;
+
+		bool higher_is_better = false;
+	};
+
+
+	static MetricDef const METRICS[] =
+	{
+		{ "init_ms", &BenchResult::init_ms, false },
+		{ "connect_ms", &BenchResult::connect_ms, false },
+		{ "cycles_per_sec", &BenchResult::cycles_per_sec, true },
+		{ "cycle_p50_ms", &BenchResult::cycle_p50_ms, false },
+		{ "cycle_p99_ms", &BenchResult::cycle_p99_ms, false },
+		{ "cycle_max_ms", &BenchResult::cycle_max_ms, false },
+		{ "cpu_ms_per_cycle", &BenchResult::cpu_ms_per_cycle, false },
+		{ "peak_rss_kb", &BenchResult::peak_rss_kb, false },
+		{ "network_ms", &BenchResult::network_ms, false },
+		{ "network_p99_ms", &BenchResult::network_p99_ms, false },
+		{ "process_ms", &BenchResult::process_ms, false },
+		{ "process_p99_ms", &BenchResult::process_p99_ms, false },
+		{ "overrun_count", &BenchResult::overrun_count, false },
+		{ "tags_failed", &BenchResult::tags_failed, false },
+	};
+
+
+	static f64 percentile(std::vector<f64> const& sorted, f64 p)
+	{
+		if (sorted.empty())
+		{
+			return 0.0;
+		}
+
+		auto i = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+
+		return sorted[std::min(i, sorted.size() - 1)];
+	}
+
+
+	static bool append_result(cstr file_path, BenchResult const& result)
+	{
+		auto file = std::fopen(file_path, "a");
+		if (!file)
+		{
+			return false;
+		}
+
+		std::fprintf(file, "{\"label\":\"%s\",\"backend\":\"%s\",\"tags\":%u,\"tags_found\":%u,\"cycles\":%u", 
+			result.label.c_str(), result.backend.c_str(), result.n_tags, result.n_tags_found, result.n_cycles);
+
+		for (auto const& m : METRICS)
+		{
+			std::fprintf(file, ",\"%s\":%.3f", m.key, result.*(m.value));
+		}
+
+		std::fprintf(file, "}\n");
+		std::fclose(file);
+
+		return true;
+	}
+
+
+	static bool find_number(std::string const& line, cstr key, f64& value)
+	{
+		auto pattern = std::string("\"") + key + "\":";
+		auto pos = line.find(pattern);
+		if (pos == std::string::npos)
+		{
+			return false;
+		}
+
+		value = std::strtod(line.c_str() + pos + pattern.length(), nullptr);
+		return true;
+	}
+
+
+	static bool find_string(std::string const& line, cstr key, std::string& value)
+	{
+		auto pattern = std::string("\"") + key + "\":\"";
+		auto pos = line.find(pattern);
+		if (pos == std::string::npos)
+		{
+			return false;
+		}
+
+		auto begin = pos + pattern.length();
+		auto end = line.find('"', begin);
+		if (end == std::string::npos)
+		{
+			return false;
+		}
+
+		value = line.substr(begin, end - begin);
+		return true;
+	}
+
+
+	// one result per line, later lines replace earlier ones with the same tag count
+	static bool read_results(cstr file_path, std::vector<BenchResult>& results)
+	{
+		auto file = std::fopen(file_path, "r");
+		if (!file)
+		{
+			return false;
+		}
+
+		char buffer[1024];
+		while (std::fgets(buffer, sizeof(buffer), file))
+		{
+			std::string line = buffer;
+
+			BenchResult result{};
+
+			f64 n_tags = 0.0;
+			if (!find_number(line, "tags", n_tags))
+			{
+				continue;
+			}
+
+			result.n_tags = (u32)n_tags;
+			find_string(line, "label", result.label);
+			find_string(line, "backend", result.backend);
+
+			for (auto const& m : METRICS)
+			{
+				find_number(line, m.key, result.*(m.value));
+			}
+
+			auto it = std::find_if(results.begin(), results.end(), [&](auto const& r) { return r.n_tags == result.n_tags; });
+			if (it == results.end())
+			{
+				results.push_back(result);
+			}
+			else
+			{
+				*it = result;
+			}
+		}
+
+		std::fclose(file);
+
+		return true;
+	}
+}
+
+
+/* benchmark */
+
+namespace
+{
+	static bool run_bench(u32 n_tags, cstr results_file, cstr label)
+	{
+		BenchResult result{};
+		result.label = label;
+		result.backend = BACKEND_NAME;
+		result.n_tags = n_tags;
+
+		// 1. Start a simulated controller with a generated tag database
+		if (!start_controller(n_tags))
+		{
+			printf("Error. Could not start %s\n", BACKEND_NAME);
+			return false;
+		}
+
+		// 2. Initialize the library and connect to the controller
+		auto begin = clock_type::now();
+
+		auto data = plcscan::init();
+		result.init_ms = ms_since(begin);
+
+		if (!data.is_init)
+		{
+			printf("Error. Init failed\n");
+			stop_controller();
+			return false;
+		}
+
+		begin = clock_type::now();
+
+		if (!plcscan::connect(SIM_GATEWAY, SIM_PATH, data))
+		{
+			printf("Error. Connect failed\n");
+			plcscan::shutdown();
+			stop_controller();
+			return false;
+		}
+
+		result.connect_ms = ms_since(begin);
+		result.n_tags_found = (u32)data.tags.size();
+
+		// 3. Scan for a fixed time and record every cycle
+		std::vector<f64> cycle_ms;
+		cycle_ms.reserve(1024);
+
+		auto cycle_begin = clock_type::now();
+		auto scan_begin = cycle_begin;
+		auto cpu_begin = process_cpu_ms();
+
+		bool first_cycle = true;
+
+		auto const scan_cb = [&](plcscan::PlcTagData const&)
+		{
+			// the first callback only marks the start of the cycle timings
+			if (first_cycle)
+			{
+				first_cycle = false;
+				scan_begin = clock_type::now();
+				cycle_begin = scan_begin;
+				cpu_begin = process_cpu_ms();
+				return;
+			}
+
+			cycle_ms.push_back(ms_since(cycle_begin));
+			cycle_begin = clock_type::now();
+		};
+
+		auto const scan_condition = [&]()
+		{
+			return first_cycle || cycle_ms.size() < MIN_CYCLES || ms_since(scan_begin) < SCAN_SECONDS * 1000.0;
+		};
+
+		plcscan::scan(scan_cb, scan_condition, data);
+
+		auto scan_ms = ms_since(scan_begin);
+		auto cpu_ms = process_cpu_ms() - cpu_begin;
+
+		auto n_cycles = (u32)cycle_ms.size();
+
+		std::sort(cycle_ms.begin(), cycle_ms.end());
+
+		result.n_cycles = n_cycles;
+		result.cycles_per_sec = n_cycles * 1000.0 / scan_ms;
+		result.cycle_p50_ms = percentile(cycle_ms, 50.0);
+		result.cycle_p99_ms = percentile(cycle_ms, 99.0);
+		result.cycle_max_ms = cycle_ms.empty() ? 0.0 : cycle_ms.back();
+		result.cpu_ms_per_cycle = n_cycles ? cpu_ms / n_cycles : 0.0;
+		result.peak_rss_kb = (f64)peak_rss_kb();
+
+		auto const& tm = data.telemetry;
+		result.network_ms = tm.network.mean_ms();
+		result.network_p99_ms = plcscan::get_percentile_ms(tm.network, 99.0);
+		result.process_ms = tm.process.mean_ms();
+		result.process_p99_ms = plcscan::get_percentile_ms(tm.process, 99.0);
+		result.overrun_count = (f64)tm.overrun_count;
+		result.tags_failed = (f64)tm.total_tags_failed;
+
+		printf("%7u tags (%s): connect %.0f ms, %.2f cycles/s, p50 %.1f ms, p99 %.1f ms, max %.1f ms, cpu %.2f ms/cycle, rss %.0f KB\n",
+			result.n_tags_found, BACKEND_NAME, result.connect_ms, result.cycles_per_sec, result.cycle_p50_ms, result.cycle_p99_ms, result.cycle_max_ms, 
+			result.cpu_ms_per_cycle, result.peak_rss_kb);
+
+		// 4. Append one JSON line of results to the results file
+		auto ok = append_result(results_file, result);
+		if (!ok)
+		{
+			printf("Error. Could not write %s\n", results_file);
+		}
+
+		// 5. Shutdown
+		plcscan::shutdown();
+		stop_controller();
+
+		return ok;
+	}
+
+
+	static bool run_all(cstr exe_path, cstr results_file, cstr label)
+	{
+		bool ok = true;
+
+		for (auto n_tags : DEFAULT_TAG_COUNTS)
+		{
+			auto command = std::string("\"") + exe_path + "\" run " + std::to_string(n_tags) + " \"" + results_file + "\" \"" + label + "\"";
+
+#ifdef _WIN32
+			// cmd.exe strips the outer quotes
+			command = "\"" + command + "\"";
+#endif
+
+			ok &= std::system(command.c_str()) == 0;
+		}
+
+		return ok;
+	}
+
+
+	static bool compare_results(cstr base_file, cstr new_file)
+	{
+		std::vector<BenchResult> base_results;
+		std::vector<BenchResult> new_results;
+
+		if (!read_results(base_file, base_results) || !read_results(new_file, new_results))
+		{
+			printf("Error. Could not read results\n");
+			return false;
+		}
+
+		bool ok = true;
+
+		for (auto const& nr : new_results)
+		{
+			auto it = std::find_if(base_results.begin(), base_results.end(), [&](auto const& r) { return r.n_tags == nr.n_tags; });
+			if (it == base_results.end())
+			{
+				continue;
+			}
+
+			auto const& br = *it;
+
+			printf("\n%u tags (%s -> %s)\n", nr.n_tags, br.label.c_str(), nr.label.c_str());
+
+			if (br.backend != nr.backend)
+			{
+				printf("Warning. Comparing %s to %s\n", br.backend.c_str(), nr.backend.c_str());
+			}
+
+			printf("%-20s %14s %14s %10s\n", "metric", "base", "new", "change");
+
+			for (auto const& m : METRICS)
+			{
+				auto b = br.*(m.value);
+				auto n = nr.*(m.value);
+
+				auto change = b != 0.0 ? (n - b) / b * 100.0 : (n > 0.0 ? 100.0 : 0.0);
+				auto worse = m.higher_is_better ? -change : change;
+
+				auto is_regression = worse > REGRESSION_PERCENT;
+				ok &= !is_regression;
+
+				printf("%-20s %14.3f %14.3f %+9.1f%%%s\n", m.key, b, n, change, is_regression ? "  REGRESSION" : "");
+			}
+		}
+
+		return ok;
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && std::strcmp(argv[1], "run") == 0)
+	{
+		if (argc < 4)
+		{
+			printf("Usage: scan_bench run <n_tags> <results_file> [label]\n");
+			return 1;
+		}
+
+		auto n_tags = (u32)std::strtoul(argv[2], nullptr, 10);
+
+		return run_bench(n_tags, argv[3], argc > 4 ? argv[4] : "") ? 0 : 1;
+	}
+
+	if (argc > 1 && std::strcmp(argv[1], "compare") == 0)
+	{
+		if (argc < 4)
+		{
+			printf("Usage: scan_bench compare <base_file> <new_file>\n");
+			return 1;
+		}
+
+		return compare_results(argv[2], argv[3]) ? 0 : 1;
+	}
+
+	auto results_file = argc > 1 ? argv[1] : DEFAULT_RESULTS_FILE;
+	auto label = argc > 2 ? argv[2] : "";
+
+	return run_all(argv[0], results_file, label) ? 0 : 1;
+}
@@ -0,0 +1,512 @@
+#include "../../src/plcscan/plcscan.hpp"
+#include "../../src/dev/cipsim.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+
+Check that tags which are not read keep their last value
+
+1. Start a simulated controller whose values change on every read
+2. Initialize the library and connect to the controller, check that every UDT template was read
+3. Re-enumerate before scanning, with and without a failing template, and check that the UDT lookups still match
+4. Fault one tag and check that it holds its value while it fails
+5. Clear the fault and check that the tag is read again
+6. Re-enumerate while scanning and check that nothing changes
+7. Force a reconnect and check that every tag is read again
+8. Stop the controller and check that every tag holds its value while the link is down
+9. Shutdown
+
+Returns 0 when every check passes.
+
+*/
+
+
+constexpr u16 SIM_PORT = 44960;
+constexpr auto SIM_GATEWAY = "127.0.0.1:44960";
+constexpr auto SIM_PATH = "1,0";
+
+constexpr auto FAULT_TAG = "DINT_tag_A";
+
+constexpr u32 FAULT_CYCLE = 5;
+
+// the fault is set during a cycle, the next reads may already be in flight
+constexpr u32 SETTLE_CYCLES = 2;
+
+constexpr u32 N_FAULTED_CYCLES = 20;
+
+// backoff grows while the tag fails
+constexpr u32 MAX_RECOVER_CYCLES = 80;
+
+constexpr u32 MAX_LINK_DOWN_CYCLES = 50;
+
+constexpr u32 N_LINK_DOWN_CYCLES = 10;
+
+// the listing and templates are read in the background
+constexpr u32 N_REENUMERATE_CYCLES = 20;
+
+// the listing is compared in the background after the link returns
+constexpr u32 N_RECONNECT_SETTLE_CYCLES = 20;
+
+// more templates than fit in one packed reply
+constexpr u32 N_MANY_UDTS = 150;
+constexpr auto MANY_UDT_PREFIX = "ManyUdt_";
+
+// read first, so every later UDT moves when it is missing
+constexpr auto FAULT_UDT = "ManyUdt_0";
+
+
+static bool contains(List<u32> const& list, u32 value)
+{
+	for (auto v : list)
+	{
+		if (v == value)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+static void add_many_udts(cipsim::SimConfig& config)
+{
+	for (u32 i = 0; i < N_MANY_UDTS; ++i)
+	{
+		auto udt_name = MANY_UDT_PREFIX + std::to_string(i);
+
+		cipsim::UdtConfig udt{};
+		udt.udt_name = udt_name;
+		udt.fields.push_back({ "Count", "DINT", 1 });
+		udt.fields.push_back({ "Values", "REAL", 1 + i % 3 });
+
+		cipsim::TagConfig tag{};
+		tag.tag_name = "Many_tag_" + std::to_string(i);
+		tag.type_name = udt_name;
+
+		config.udts.push_back(udt);
+		config.tags.push_back(tag);
+	}
+}
+
+
+static u32 count_many_udts(plcscan::PlcTagData const& data)
+{
+	u32 count = 0;
+	auto len = strlen(MANY_UDT_PREFIX);
+
+	for (auto const& udt : data.udt_types)
+	{
+		count += !strncmp(udt.name(), MANY_UDT_PREFIX, len);
+	}
+
+	return count;
+}
+
+
+static u32 find_tag(plcscan::PlcTagData const& data, cstr tag_name)
+{
+	for (u32 i = 0; i < (u32)data.tags.size(); ++i)
+	{
+		if (!strcmp(data.tags[i].name(), tag_name))
+		{
+			return i;
+		}
+	}
+
+	return (u32)data.tags.size();
+}
+
+
+class FaultCheck
+{
+public:
+	u32 tag_index = 0;
+
+	u32 cycle = 0;
+
+	std::vector<u8> held_value;
+
+	u32 n_held = 0;
+	u32 n_value_changed = 0;
+	u32 n_reported_changed = 0;
+
+	bool was_unhealthy = false;
+	bool has_recovered = false;
+
+	bool is_done = false;
+};
+
+
+static void check_fault(plcscan::PlcTagData const& data, FaultCheck& check)
+{
+	auto const& tag = data.tags[check.tag_index];
+
+	auto cycle = check.cycle++;
+
+	auto hold_begin = FAULT_CYCLE + SETTLE_CYCLES;
+	auto hold_end = FAULT_CYCLE + N_FAULTED_CYCLES;
+
+	if (cycle == FAULT_CYCLE)
+	{
+		cipsim::set_tag_fault(FAULT_TAG, true);
+	}
+	else if (cycle == hold_begin)
+	{
+		check.held_value.assign(tag.data(), tag.data() + tag.size());
+	}
+	else if (cycle > hold_begin && cycle < hold_end)
+	{
+		check.n_held++;
+		check.n_value_changed += memcmp(tag.data(), check.held_value.data(), tag.size()) != 0;
+		check.n_reported_changed += contains(data.changed_tags, check.tag_index);
+		check.was_unhealthy |= !tag.is_ok();
+	}
+	else if (cycle == hold_end)
+	{
+		cipsim::set_tag_fault(FAULT_TAG, false);
+	}
+	else if (cycle > hold_end)
+	{
+		check.has_recovered = tag.is_ok() && memcmp(tag.data(), check.held_value.data(), tag.size()) != 0;
+		check.is_done = check.has_recovered || cycle > hold_end + MAX_RECOVER_CYCLES;
+	}
+}
+
+
+// every UDT is found by its own id and every UDT tag that was loaded is named after its UDT
+static bool udt_lookups_match(plcscan::PlcTagData const& data)
+{
+	for (auto const& udt : data.udt_types)
+	{
+		if (plcscan::find_udt_type(udt.type_id, data) != &udt)
+		{
+			return false;
+		}
+	}
+
+	for (auto const& tag : data.tags)
+	{
+		if (plcscan::get_tag_type(tag.type_id) != plcscan::TagType::UDT)
+		{
+			continue;
+		}
+
+		if (contains(data.missing_udt_types, tag.type_id))
+		{
+			continue;
+		}
+
+		auto udt = plcscan::find_udt_type(tag.type_id, data);
+		if (!udt || strcmp(udt->name(), tag.type()) != 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+static u32 count_ok_tags(plcscan::PlcTagData const& data)
+{
+	u32 count = 0;
+
+	for (auto const& tag : data.tags)
+	{
+		count += tag.is_ok();
+	}
+
+	return count;
+}
+
+
+class ReenumerateCheck
+{
+public:
+	u32 cycle = 0;
+
+	u32 tag_list_version = 0;
+
+	bool lookups_match = false;
+	bool version_kept = false;
+
+	bool is_done = false;
+};
+
+
+static void check_reenumerate(plcscan::PlcTagData const& data, ReenumerateCheck& check)
+{
+	auto cycle = check.cycle++;
+
+	if (cycle == 0)
+	{
+		check.tag_list_version = data.tag_list_version;
+		return;
+	}
+
+	if (cycle < N_REENUMERATE_CYCLES)
+	{
+		return;
+	}
+
+	check.lookups_match = udt_lookups_match(data);
+	check.version_kept = data.tag_list_version == check.tag_list_version;
+	check.is_done = true;
+}
+
+
+class ReconnectCheck
+{
+public:
+	u32 cycle = 0;
+
+	// cycles since the link came back
+	u32 up_cycle = 0;
+
+	u32 tag_list_version = 0;
+	u32 n_ok_tags = 0;
+
+	bool was_link_down = false;
+	bool has_recovered = false;
+	bool tag_set_kept = false;
+
+	bool is_done = false;
+};
+
+
+static void check_reconnect(plcscan::PlcTagData const& data, ReconnectCheck& check)
+{
+	auto cycle = check.cycle++;
+
+	if (cycle == 0)
+	{
+		check.tag_list_version = data.tag_list_version;
+		check.n_ok_tags = count_ok_tags(data);
+		return;
+	}
+
+	if (data.is_link_down)
+	{
+		check.was_link_down = true;
+		check.is_done = cycle > MAX_LINK_DOWN_CYCLES;
+		return;
+	}
+
+	if (!check.was_link_down)
+	{
+		check.is_done = cycle > MAX_LINK_DOWN_CYCLES;
+		return;
+	}
+
+	if (check.up_cycle++ < N_RECONNECT_SETTLE_CYCLES)
+	{
+		return;
+	}
+
+	check.has_recovered = count_ok_tags(data) >= check.n_ok_tags;
+	check.tag_set_kept = !data.tag_set_changed && data.tag_list_version == check.tag_list_version && udt_lookups_match(data);
+	check.is_done = true;
+}
+
+
+class LinkCheck
+{
+public:
+	u32 cycle = 0;
+
+	// cycles since the link went down
+	u32 down_cycle = 0;
+
+	std::vector<u8> held_values;
+
+	u32 n_held = 0;
+	u32 n_values_changed = 0;
+	u32 n_reported_changed = 0;
+
+	bool is_done = false;
+};
+
+
+static void copy_values(plcscan::PlcTagData const& data, std::vector<u8>& dst)
+{
+	dst.clear();
+
+	for (auto const& tag : data.tags)
+	{
+		dst.insert(dst.end(), tag.data(), tag.data() + tag.size());
+	}
+}
+
+
+static void check_link_loss(plcscan::PlcTagData const& data, LinkCheck& check)
+{
+	auto cycle = check.cycle++;
+
+	if (cycle == 0)
+	{
+		cipsim::stop();
+		return;
+	}
+
+	if (!data.is_link_down)
+	{
+		check.is_done = cycle > MAX_LINK_DOWN_CYCLES;
+		return;
+	}
+
+	auto down_cycle = check.down_cycle++;
+
+	if (down_cycle < SETTLE_CYCLES)
+	{
+		copy_values(data, check.held_values);
+		return;
+	}
+
+	std::vector<u8> values;
+	copy_values(data, values);
+
+	check.n_held++;
+	check.n_values_changed += values != check.held_values;
+	check.n_reported_changed += !data.changed_tags.empty();
+
+	check.is_done = check.n_held >= N_LINK_DOWN_CYCLES;
+}
+
+
+static bool report(cstr name, bool ok)
+{
+	printf("%s: %s\n", ok ? "  ok" : "FAIL", name);
+	return ok;
+}
+
+
+int main()
+{
+	// 1. Start a simulated controller whose values change on every read
+	auto sim_config = cipsim::default_config();
+	sim_config.port = SIM_PORT;
+	sim_config.value_change_percent = 100;
+	add_many_udts(sim_config);
+
+	if (!cipsim::start(sim_config))
+	{
+		printf("Error. Could not start simulator\n");
+		return 1;
+	}
+
+	// 2. Initialize the library and connect to the controller
+	auto plc_data = plcscan::init();
+
+	if (!plc_data.is_init || !plcscan::connect(SIM_GATEWAY, SIM_PATH, plc_data))
+	{
+		printf("Error. Could not connect to simulator\n");
+		cipsim::stop();
+		return 1;
+	}
+
+	auto n_many_udts = count_many_udts(plc_data);
+	auto n_missing_udts = (u32)plc_data.missing_udt_types.size();
+
+	// 3. Re-enumerate before scanning, with and without a failing template, and check that the UDT lookups still match
+	auto connect_version = plc_data.tag_list_version;
+	plcscan::reenumerate(plc_data);
+
+	auto unchanged_ok = udt_lookups_match(plc_data) && plc_data.tag_list_version == connect_version;
+
+	cipsim::set_template_fault(FAULT_UDT, true);
+	plcscan::reenumerate(plc_data);
+
+	auto faulted_ok = udt_lookups_match(plc_data) &&
+		plc_data.missing_udt_types.size() == 1 &&
+		count_many_udts(plc_data) == N_MANY_UDTS - 1;
+
+	cipsim::set_template_fault(FAULT_UDT, false);
+	plcscan::reenumerate(plc_data);
+
+	auto restored_ok = udt_lookups_match(plc_data) &&
+		plc_data.missing_udt_types.empty() &&
+		count_many_udts(plc_data) == N_MANY_UDTS;
+
+	FaultCheck fault{};
+	fault.tag_index = find_tag(plc_data, FAULT_TAG);
+
+	if (fault.tag_index >= (u32)plc_data.tags.size())
+	{
+		printf("Error. Tag %s not found\n", FAULT_TAG);
+		plcscan::shutdown();
+		cipsim::stop();
+		return 1;
+	}
+
+	ReenumerateCheck reenumerate{};
+	ReconnectCheck reconnect{};
+	LinkCheck link{};
+
+	auto const check_scan = [&](plcscan::PlcTagData const& data)
+	{
+		if (!fault.is_done)
+		{
+			// 4. Fault one tag and check that it holds its value while it fails
+			// 5. Clear the fault and check that the tag is read again
+			check_fault(data, fault);
+		}
+		else if (!reenumerate.is_done)
+		{
+			// 6. Re-enumerate while scanning and check that nothing changes
+			if (!reenumerate.cycle)
+			{
+				plcscan::reenumerate(plc_data);
+			}
+
+			check_reenumerate(data, reenumerate);
+		}
+		else if (!reconnect.is_done)
+		{
+			// 7. Force a reconnect and check that every tag is read again
+			if (!reconnect.cycle)
+			{
+				plcscan::reconnect(plc_data);
+			}
+
+			check_reconnect(data, reconnect);
+		}
+		else
+		{
+			// 8. Stop the controller and check that every tag holds its value while the link is down
+			check_link_loss(data, link);
+		}
+	};
+
+	auto const still_checking = [&]() { return !link.is_done; };
+
+	plcscan::scan(check_scan, still_checking, plc_data);
+
+	// 9. Shutdown
+	plcscan::shutdown();
+	cipsim::stop();
+
+	bool ok = true;
+
+	ok &= report("every UDT template is read", n_many_udts == N_MANY_UDTS && !n_missing_udts);
+	ok &= report("re-enumerating an unchanged controller changes nothing", unchanged_ok);
+	ok &= report("UDT lookups match when a template fails", faulted_ok);
+	ok &= report("UDT lookups match when the template is read again", restored_ok);
+	ok &= report("failing tag is unhealthy", fault.was_unhealthy);
+	ok &= report("failing tag keeps its value", fault.n_held && !fault.n_value_changed);
+	ok &= report("failing tag is not reported changed", fault.n_held && !fault.n_reported_changed);
+	ok &= report("tag is read again after the fault", fault.has_recovered);
+	ok &= report("UDT lookups match after re-enumerating while scanning", reenumerate.lookups_match && reenumerate.version_kept);
+	ok &= report("reconnect takes the link down", reconnect.was_link_down);
+	ok &= report("every tag is read again after the reconnect", reconnect.has_recovered);
+	ok &= report("tags and UDTs are kept after the reconnect", reconnect.tag_set_kept);
+	ok &= report("link loss is detected", link.n_held > 0);
+	ok &= report("tags keep their values while the link is down", link.n_held && !link.n_values_changed);
+	ok &= report("no tag is reported changed while the link is down", link.n_held && !link.n_reported_changed);
+
+	return ok ? 0 : 1;
+}
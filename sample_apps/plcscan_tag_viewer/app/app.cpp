@@ -4,9 +4,11 @@
 #include "../../../src/util/time_helper.hpp"
 #include "../../../src/util/qsprintf.hpp"
 #include "../../../src/util/memory_helper.hpp"
+#include "value_map.hpp"
 
 namespace tmh = time_helper;
 namespace mh = memory_helper;
+namespace vm = value_map;
 
 
 constexpr auto DEFAULT_PLC_IP = "192.168.123.123";
@@ -331,127 +333,14 @@ namespace
 }
 
 
-/* map bytes */
+/* map tag values */
 
 namespace
 {
-	static void map_string(ByteView const& src, StringView const& dst)
-	{
-		auto len = src.length < dst.length ? src.length : dst.length;
-
-		mh::copy_bytes(src.data, (u8*)dst.char_data, len);
-	}
-
-
-	static void map_hex(ByteView const& src, StringView const& dst)
-	{
-		auto dst_len = dst.length - 2;
-		auto src_len = src.length;
-
-		if (src_len > dst_len / 2)
-		{
-			src_len = dst_len / 2;
-		}
-
-		auto dst_data = dst.char_data;
-
-		qsnprintf(dst_data, 3, "0x");
-		dst_data += 2;
-
-		for (u32 i = 0; i < src_len; i++)
-		{
-			auto s = *(int*)(src.data + i);
-			auto d = dst_data + i * 2;
-			qsnprintf(d, 3, "%02x", s);
-		}
-
-		dst.char_data[2 * src_len] = NULL;
-	}
-
-
-	static void map_number(ByteView const& src, StringView const& dst, plcscan::TagType type)
-	{
-		using T = plcscan::TagType;
-
-		switch (type)
-		{
-		case T::BOOL:
-		case T::USINT:
-			qsnprintf(dst.char_data, dst.length, "%hhu", mh::cast_numeric_bytes<u8>(src.data, src.length));
-			break;
-
-		case T::SINT:
-			qsnprintf(dst.char_data, dst.length, "%hhd", mh::cast_numeric_bytes<i8>(src.data, src.length));
-			break;
-
-		case T::UINT:
-			qsnprintf(dst.char_data, dst.length, "%hu", mh::cast_numeric_bytes<u16>(src.data, src.length));
-			break;
-
-		case T::INT:
-			qsnprintf(dst.char_data, dst.length, "%hd", mh::cast_numeric_bytes<i16>(src.data, src.length));
-			break;
-
-		case T::UDINT:
-			qsnprintf(dst.char_data, dst.length, "%u", mh::cast_numeric_bytes<u32>(src.data, src.length));
-			break;
-
-		case T::DINT:
-			qsnprintf(dst.char_data, dst.length, "%d", mh::cast_numeric_bytes<i32>(src.data, src.length));
-			break;
-
-		case T::ULINT:
-			qsnprintf(dst.char_data, dst.length, "%llu", mh::cast_numeric_bytes<u64>(src.data, src.length));
-			break;
-
-		case T::LINT:
-			qsnprintf(dst.char_data, dst.length, "%lld", mh::cast_numeric_bytes<i64>(src.data, src.length));
-			break;
-
-		case T::REAL:
-			qsnprintf(dst.char_data, dst.length, "%f", mh::cast_numeric_bytes<f32>(src.data, src.length));
-			break;
-
-		case T::LREAL:
-			qsnprintf(dst.char_data, dst.length, "%lf", mh::cast_numeric_bytes<f64>(src.data, src.length));
-			break;
-
-		default:
-			qsnprintf(dst.char_data, dst.length, "error");
-			break;
-		}
-	}
-
-
-	static void map_value(ByteView const& src, StringView const& dst, plcscan::TagType type)
-	{
-		using T = plcscan::TagType;
-
-		switch (type)
-		{
-		case T::STRING:
-			map_string(src, dst);
-			break;
-
-		case T::UDT:
-			map_hex(src, dst);
-			break;
-
-		case T::MISC:
-			map_hex(src, dst);
-			break;
-
-		default:
-			map_number(src, dst, type);
-			break;
-		}
-	}
-
-
 	static void map_tag_value(UI_Tag const& ui)
 	{
 		mh::zero_string(ui.value_str);
-		map_value(ui.value_bytes, ui.value_str, plcscan::get_tag_type(ui.type_id));
+		vm::map_value(ui.value_bytes, ui.value_str, plcscan::get_tag_type(ui.type_id));
 	}
 
 
@@ -463,7 +352,7 @@ namespace
 
 		for (auto const& e : ui.elements)
 		{
-			map_value(e.value_bytes, e.value_str, type);
+			vm::map_value(e.value_bytes, e.value_str, type);
 		}
 	}
 
@@ -474,7 +363,7 @@ namespace
 
 		for (auto const& f : ui.fields)
 		{
-			map_value(f.value_bytes, f.value_str, plcscan::get_tag_type(f.type_id));
+			vm::map_value(f.value_bytes, f.value_str, plcscan::get_tag_type(f.type_id));
 		}
 	}
 
@@ -487,7 +376,7 @@ namespace
 		{
 			for (auto const& f : e.fields)
 			{
-				map_value(f.value_bytes, f.value_str, plcscan::get_tag_type(f.type_id));
+				vm::map_value(f.value_bytes, f.value_str, plcscan::get_tag_type(f.type_id));
 			}
 		}
 	}
@@ -617,10 +506,6 @@ namespace
 	{
 		using T = plcscan::TagType;
 
-		auto udt_begin = state.plc.data.udt_types.begin();
-		auto udt_end = state.plc.data.udt_types.end();
-
-
 		for (u32 tag_id = 0; tag_id < (u32)tags.size(); ++tag_id)
 		{
 			auto& tag = tags[tag_id];
@@ -641,18 +526,17 @@ namespace
 			case T::UDT:
 			{
 				// get udt type
-				auto const pred = [&](auto const& t) { return t.type_id == tag.type_id; };
-				auto it = std::find_if(udt_begin, udt_end, pred);
+				auto udt = plcscan::find_udt_type(tag.type_id, state.plc.data);
 
-				if (it != udt_end)
+				if (udt)
 				{
 					if (tag.is_array())
 					{
-						state.udt_array_tags.push_back(create_ui_array_tag_udt(tag, *it, UI_UDT_BYTES_PER_VALUE));
+						state.udt_array_tags.push_back(create_ui_array_tag_udt(tag, *udt, UI_UDT_BYTES_PER_VALUE));
 					}
 					else
 					{
-						state.udt_tags.push_back(create_ui_tag_udt(tag, *it, UI_UDT_BYTES_PER_VALUE));
+						state.udt_tags.push_back(create_ui_tag_udt(tag, *udt, UI_UDT_BYTES_PER_VALUE));
 					}
 				}
 				else
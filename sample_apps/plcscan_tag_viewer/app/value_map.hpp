@@ -0,0 +1,126 @@
+#pragma once
+
+#include "../../../src/plcscan/plcscan.hpp"
+#include "../../../src/util/qsprintf.hpp"
+#include "../../../src/util/memory_helper.hpp"
+
+
+/* map bytes */
+
+namespace value_map
+{
+	namespace mh = memory_helper;
+
+
+	inline void map_string(ByteView const& src, StringView const& dst)
+	{
+		auto len = src.length < dst.length ? src.length : dst.length;
+
+		mh::copy_bytes(src.data, (u8*)dst.char_data, len);
+	}
+
+
+	inline void map_hex(ByteView const& src, StringView const& dst)
+	{
+		auto dst_len = dst.length - 2;
+		auto src_len = src.length;
+
+		if (src_len > dst_len / 2)
+		{
+			src_len = dst_len / 2;
+		}
+
+		auto dst_data = dst.char_data;
+
+		qsnprintf(dst_data, 3, "0x");
+		dst_data += 2;
+
+		for (u32 i = 0; i < src_len; i++)
+		{
+			auto s = *(int*)(src.data + i);
+			auto d = dst_data + i * 2;
+			qsnprintf(d, 3, "%02x", s);
+		}
+
+		dst.char_data[2 * src_len] = NULL;
+	}
+
+
+	inline void map_number(ByteView const& src, StringView const& dst, plcscan::TagType type)
+	{
+		using T = plcscan::TagType;
+
+		switch (type)
+		{
+		case T::BOOL:
+		case T::USINT:
+			qsnprintf(dst.char_data, dst.length, "%hhu", mh::cast_numeric_bytes<u8>(src.data, src.length));
+			break;
+
+		case T::SINT:
+			qsnprintf(dst.char_data, dst.length, "%hhd", mh::cast_numeric_bytes<i8>(src.data, src.length));
+			break;
+
+		case T::UINT:
+			qsnprintf(dst.char_data, dst.length, "%hu", mh::cast_numeric_bytes<u16>(src.data, src.length));
+			break;
+
+		case T::INT:
+			qsnprintf(dst.char_data, dst.length, "%hd", mh::cast_numeric_bytes<i16>(src.data, src.length));
+			break;
+
+		case T::UDINT:
+			qsnprintf(dst.char_data, dst.length, "%u", mh::cast_numeric_bytes<u32>(src.data, src.length));
+			break;
+
+		case T::DINT:
+			qsnprintf(dst.char_data, dst.length, "%d", mh::cast_numeric_bytes<i32>(src.data, src.length));
+			break;
+
+		case T::ULINT:
+			qsnprintf(dst.char_data, dst.length, "%llu", mh::cast_numeric_bytes<u64>(src.data, src.length));
+			break;
+
+		case T::LINT:
+			qsnprintf(dst.char_data, dst.length, "%lld", mh::cast_numeric_bytes<i64>(src.data, src.length));
+			break;
+
+		case T::REAL:
+			qsnprintf(dst.char_data, dst.length, "%f", mh::cast_numeric_bytes<f32>(src.data, src.length));
+			break;
+
+		case T::LREAL:
+			qsnprintf(dst.char_data, dst.length, "%lf", mh::cast_numeric_bytes<f64>(src.data, src.length));
+			break;
+
+		default:
+			qsnprintf(dst.char_data, dst.length, "error");
+			break;
+		}
+	}
+
+
+	inline void map_value(ByteView const& src, StringView const& dst, plcscan::TagType type)
+	{
+		using T = plcscan::TagType;
+
+		switch (type)
+		{
+		case T::STRING:
+			map_string(src, dst);
+			break;
+
+		case T::UDT:
+			map_hex(src, dst);
+			break;
+
+		case T::MISC:
+			map_hex(src, dst);
+			break;
+
+		default:
+			map_number(src, dst, type);
+			break;
+		}
+	}
+}
@@ -0,0 +1,2602 @@
+/* LICENSE: See end of file for license information. */
+
+#include "cipsim.hpp"
+#include "../util/mh_types.hpp"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <unordered_map>
+
+#ifdef _WIN32
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#pragma comment(lib, "ws2_32.lib")
+
+using socket_t = SOCKET;
+
+#else
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+
+using socket_t = int;
+
+#endif
+
+
+/* protocol constants */
+
+namespace /* private */
+{
+    namespace eip
+    {
+        constexpr u16 NOP                = 0x0000;
+        constexpr u16 REGISTER_SESSION   = 0x0065;
+        constexpr u16 UNREGISTER_SESSION = 0x0066;
+        constexpr u16 SEND_RR_DATA       = 0x006F;
+        constexpr u16 SEND_UNIT_DATA     = 0x0070;
+
+        constexpr u32 STATUS_OK              = 0x0000;
+        constexpr u32 STATUS_INVALID_COMMAND = 0x0001;
+        constexpr u32 STATUS_BAD_DATA        = 0x0003;
+        constexpr u32 STATUS_INVALID_SESSION = 0x0064;
+
+        constexpr u16 ITEM_NAI = 0x0000;
+        constexpr u16 ITEM_CAI = 0x00A1;
+        constexpr u16 ITEM_CDI = 0x00B1;
+        constexpr u16 ITEM_UDI = 0x00B2;
+
+        constexpr u32 HEADER_SIZE = 24;
+        constexpr u32 MAX_PACKET_SIZE = HEADER_SIZE + 0xFFFF;
+    }
+
+
+    namespace cip
+    {
+        constexpr u8 GET_ATTR_LIST     = 0x03;
+        constexpr u8 MULTI_SERVICE     = 0x0A;
+        constexpr u8 READ_TAG          = 0x4C;
+        constexpr u8 WRITE_TAG         = 0x4D;
+        constexpr u8 FORWARD_CLOSE     = 0x4E;
+        constexpr u8 READ_TAG_FRAG     = 0x52;
+        constexpr u8 UNCONNECTED_SEND  = 0x52;
+        constexpr u8 WRITE_TAG_FRAG    = 0x53;
+        constexpr u8 FORWARD_OPEN      = 0x54;
+        constexpr u8 LARGE_FORWARD_OPEN = 0x5B;
+        constexpr u8 LIST_TAGS         = 0x55;
+
+        constexpr u8 REPLY = 0x80;
+
+        constexpr u8 STATUS_OK                = 0x00;
+        constexpr u8 STATUS_CONNECTION_FAILED = 0x01;
+        constexpr u8 STATUS_PATH_SEGMENT      = 0x04;
+        constexpr u8 STATUS_PATH_UNKNOWN      = 0x05;
+        constexpr u8 STATUS_PARTIAL           = 0x06;
+        constexpr u8 STATUS_UNSUPPORTED       = 0x08;
+        constexpr u8 STATUS_REPLY_TOO_LARGE   = 0x11;
+        constexpr u8 STATUS_NOT_ENOUGH_DATA   = 0x13;
+        constexpr u8 STATUS_ATTR_UNSUPPORTED  = 0x14;
+        constexpr u8 STATUS_EMBEDDED_ERROR    = 0x1E;
+        constexpr u8 STATUS_GENERAL           = 0xFF;
+
+        constexpr u16 EXT_CONNECTION_NOT_FOUND = 0x0107;
+        constexpr u16 EXT_INVALID_SIZE         = 0x0109;
+        constexpr u16 EXT_OUT_OF_RANGE         = 0x2105;
+
+        constexpr u8 SEGMENT_SYMBOLIC  = 0x91;
+        constexpr u8 SEGMENT_ELEMENT8  = 0x28;
+        constexpr u8 SEGMENT_ELEMENT16 = 0x29;
+        constexpr u8 SEGMENT_ELEMENT32 = 0x2A;
+        constexpr u8 SEGMENT_CLASS     = 0x20;
+        constexpr u8 SEGMENT_INSTANCE8 = 0x24;
+        constexpr u8 SEGMENT_INSTANCE16 = 0x25;
+
+        constexpr u8 CLASS_SYMBOL   = 0x6B;
+        constexpr u8 CLASS_TEMPLATE = 0x6C;
+
+        constexpr u8 TYPE_ABBREV_STRUCT = 0xA0;
+
+        // Forward Open size limit without the large variant
+        constexpr u32 MAX_SMALL_CONNECTION_SIZE = 0x01FF;
+
+        // reply header without data, every embedded service gets at least this
+        constexpr u32 MIN_EMBEDDED_REPLY_SIZE = 4;
+    }
+
+
+    namespace symbol
+    {
+        constexpr u16 TYPE_IS_STRUCT     = 0x8000;
+        constexpr u16 FIELD_IS_ARRAY     = 0x2000;
+        constexpr u16 ONE_DIMENSION      = 0x2000;
+        constexpr u16 UDT_ID_MASK        = 0x0FFF;
+    }
+}
+
+
+/* fixed types */
+
+namespace /* private */
+{
+    constexpr u8 TYPE_CODE_BOOL   = 0xC1;
+    constexpr u8 TYPE_CODE_SINT   = 0xC2;
+    constexpr u8 TYPE_CODE_STRING = 0xD0;
+
+    constexpr u32 NO_UDT = (u32)-1;
+
+
+    class FixedTypeInfo
+    {
+    public:
+        cstr type_name = 0;
+        u8 type_code = 0;
+        u16 size = 0;
+    };
+
+
+    constexpr std::array<FixedTypeInfo, 12> FIXED_TYPES =
+    {
+        FixedTypeInfo{ "BOOL",   0xC1, 1 },
+        FixedTypeInfo{ "SINT",   0xC2, 1 },
+        FixedTypeInfo{ "INT",    0xC3, 2 },
+        FixedTypeInfo{ "DINT",   0xC4, 4 },
+        FixedTypeInfo{ "LINT",   0xC5, 8 },
+        FixedTypeInfo{ "USINT",  0xC6, 1 },
+        FixedTypeInfo{ "UINT",   0xC7, 2 },
+        FixedTypeInfo{ "UDINT",  0xC8, 4 },
+        FixedTypeInfo{ "ULINT",  0xC9, 8 },
+        FixedTypeInfo{ "REAL",   0xCA, 4 },
+        FixedTypeInfo{ "LREAL",  0xCB, 8 },
+        FixedTypeInfo{ "STRING", 0xD0, 88 },
+    };
+
+
+    static FixedTypeInfo const* find_fixed_type(std::string const& type_name)
+    {
+        for (auto const& t : FIXED_TYPES)
+        {
+            if (type_name == t.type_name)
+            {
+                return &t;
+            }
+        }
+
+        return nullptr;
+    }
+
+
+    static u32 get_fixed_alignment(FixedTypeInfo const& t)
+    {
+        return t.size == 1 || t.size == 2 || t.size == 8 ? t.size : 4;
+    }
+}
+
+
+/* tag database */
+
+namespace /* private */
+{
+    class SimField
+    {
+    public:
+        std::string field_name;
+
+        u8 type_code = 0;
+        u32 udt_index = NO_UDT;
+
+        u32 elem_size = 0;
+        u32 array_count = 1;
+        i32 bit_number = -1;
+
+        u32 offset = 0;
+    };
+
+
+    class SimUdt
+    {
+    public:
+        u16 udt_id = 0;
+        u16 handle = 0;
+
+        std::string udt_name;
+
+        u32 size = 0;
+        u32 alignment = 4;
+
+        cipsim::List<SimField> fields;
+
+        cipsim::List<u8> template_bytes;
+        u32 template_words = 0;
+
+        // template reads answer with an error, see set_template_fault()
+        bool is_faulted = false;
+    };
+
+
+    class SimTag
+    {
+    public:
+        u32 instance_id = 0;
+        std::string tag_name;
+
+        u16 symbol_type = 0;
+
+        u8 type_code = 0;
+        u32 udt_index = NO_UDT;
+
+        u32 elem_size = 0;
+        u32 elem_count = 1;
+
+        ByteView value_bytes;
+
+        // reads answer with an error, see set_tag_fault()
+        bool is_faulted = false;
+    };
+
+
+    class SimDatabase
+    {
+    public:
+        cipsim::List<SimUdt> udts;
+        cipsim::List<SimTag> tags;
+
+        std::unordered_map<std::string, u32> tag_index;
+
+        ByteBuffer value_data;
+    };
+
+
+    static std::string to_lower(std::string str)
+    {
+        for (auto& c : str)
+        {
+            if (c >= 'A' && c <= 'Z')
+            {
+                c = (char)(c - 'A' + 'a');
+            }
+        }
+
+        return str;
+    }
+
+
+    static bool name_equals(std::string const& name, u8 const* segment, u32 segment_len)
+    {
+        if (name.length() != segment_len)
+        {
+            return false;
+        }
+
+        for (u32 i = 0; i < segment_len; ++i)
+        {
+            auto a = name[i];
+            auto b = (char)segment[i];
+
+            a = (a >= 'A' && a <= 'Z') ? (char)(a - 'A' + 'a') : a;
+            b = (b >= 'A' && b <= 'Z') ? (char)(b - 'A' + 'a') : b;
+
+            if (a != b)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    static u32 find_udt(SimDatabase const& db, std::string const& udt_name)
+    {
+        for (u32 i = 0; i < (u32)db.udts.size(); ++i)
+        {
+            if (db.udts[i].udt_name == udt_name)
+            {
+                return i;
+            }
+        }
+
+        return NO_UDT;
+    }
+
+
+    static void put16(cipsim::List<u8>& bytes, u16 value)
+    {
+        bytes.push_back((u8)(value & 0xFF));
+        bytes.push_back((u8)(value >> 8));
+    }
+
+
+    static void put32(cipsim::List<u8>& bytes, u32 value)
+    {
+        put16(bytes, (u16)(value & 0xFFFF));
+        put16(bytes, (u16)(value >> 16));
+    }
+
+
+    static void put_cstr(cipsim::List<u8>& bytes, std::string const& str)
+    {
+        bytes.insert(bytes.end(), str.begin(), str.end());
+        bytes.push_back(0);
+    }
+
+
+    static u16 get_field_type(SimField const& field, SimDatabase const& db)
+    {
+        u16 type = field.type_code;
+
+        if (field.udt_index != NO_UDT)
+        {
+            type = symbol::TYPE_IS_STRUCT | db.udts[field.udt_index].udt_id;
+        }
+
+        if (field.array_count > 1)
+        {
+            type |= symbol::FIELD_IS_ARRAY;
+        }
+
+        return type;
+    }
+
+
+    static void build_udt_template(SimUdt& udt, SimDatabase const& db)
+    {
+        /*
+
+        Template read response data:
+
+        N x member info
+            uint16_t metadata - array element count or bit number
+            uint16_t type
+            uint32_t offset
+
+        zero-terminated "Name;n" string
+
+        N x zero-terminated member names
+
+        */
+
+        auto& bytes = udt.template_bytes;
+        bytes.clear();
+
+        for (auto const& f : udt.fields)
+        {
+            u16 metadata = 0;
+            if (f.bit_number >= 0)
+            {
+                metadata = (u16)f.bit_number;
+            }
+            else if (f.array_count > 1)
+            {
+                metadata = (u16)f.array_count;
+            }
+
+            put16(bytes, metadata);
+            put16(bytes, get_field_type(f, db));
+            put32(bytes, f.offset);
+        }
+
+        put_cstr(bytes, udt.udt_name + ";n");
+
+        for (auto const& f : udt.fields)
+        {
+            put_cstr(bytes, f.field_name);
+        }
+
+        // libplctag reads (4 * words - 23) bytes
+        udt.template_words = ((u32)bytes.size() + 23 + 3) / 4;
+
+        // stand-in for the structure CRC
+        u32 hash = 2166136261u;
+        for (auto b : bytes)
+        {
+            hash = (hash ^ b) * 16777619u;
+        }
+
+        udt.handle = (u16)((hash >> 16) ^ (hash & 0xFFFF));
+    }
+
+
+    static bool add_udt(cipsim::UdtConfig const& config, SimDatabase& db)
+    {
+        if (config.udt_name.empty() || config.fields.empty() || find_udt(db, config.udt_name) != NO_UDT)
+        {
+            return false;
+        }
+
+        SimUdt udt{};
+        udt.udt_id = (u16)(100 + db.udts.size());
+        udt.udt_name = config.udt_name;
+
+        if (udt.udt_id > symbol::UDT_ID_MASK)
+        {
+            return false;
+        }
+
+        u32 offset = 0;
+        u32 max_alignment = 4;
+
+        // BOOL members are bits packed into hidden SINT members
+        u32 bit_host = NO_UDT;
+        u32 n_bits = 0;
+        u32 n_hosts = 0;
+
+        for (auto const& fc : config.fields)
+        {
+            SimField field{};
+            field.field_name = fc.field_name;
+            field.array_count = fc.array_count ? fc.array_count : 1;
+
+            u32 alignment = 1;
+
+            auto fixed = find_fixed_type(fc.type_name);
+            if (fixed)
+            {
+                field.type_code = fixed->type_code;
+                field.elem_size = fixed->size;
+                alignment = get_fixed_alignment(*fixed);
+            }
+            else
+            {
+                field.udt_index = find_udt(db, fc.type_name);
+                if (field.udt_index == NO_UDT)
+                {
+                    return false;
+                }
+
+                auto const& nested = db.udts[field.udt_index];
+                field.elem_size = nested.size;
+                alignment = nested.alignment;
+            }
+
+            if (field.type_code == TYPE_CODE_BOOL)
+            {
+                if (field.array_count > 1)
+                {
+                    return false;
+                }
+
+                auto& fields = udt.fields;
+
+                if (bit_host == NO_UDT || n_bits == 8)
+                {
+                    SimField host{};
+                    host.field_name = "ZZZZZZZZZZ" + udt.udt_name + std::to_string(n_hosts++);
+                    host.type_code = TYPE_CODE_SINT;
+                    host.elem_size = 1;
+                    host.offset = offset;
+
+                    offset += 1;
+
+                    bit_host = (u32)fields.size();
+                    n_bits = 0;
+                    fields.push_back(host);
+                }
+
+                field.bit_number = (i32)n_bits++;
+                field.offset = fields[bit_host].offset;
+                field.array_count = 1;
+
+                fields.push_back(field);
+                continue;
+            }
+
+            bit_host = NO_UDT;
+
+            offset = (offset + alignment - 1) / alignment * alignment;
+            field.offset = offset;
+            offset += field.elem_size * field.array_count;
+
+            max_alignment = alignment > max_alignment ? alignment : max_alignment;
+
+            udt.fields.push_back(field);
+        }
+
+        udt.alignment = max_alignment;
+        udt.size = (offset + max_alignment - 1) / max_alignment * max_alignment;
+
+        build_udt_template(udt, db);
+
+        db.udts.push_back(std::move(udt));
+
+        return true;
+    }
+
+
+    static bool add_tag(cipsim::TagConfig const& config, SimDatabase& db)
+    {
+        auto key = to_lower(config.tag_name);
+
+        if (config.tag_name.empty() || db.tag_index.count(key))
+        {
+            return false;
+        }
+
+        SimTag tag{};
+        tag.instance_id = (u32)db.tags.size() + 1;
+        tag.tag_name = config.tag_name;
+        tag.elem_count = config.array_count ? config.array_count : 1;
+
+        auto fixed = find_fixed_type(config.type_name);
+        if (fixed)
+        {
+            tag.type_code = fixed->type_code;
+            tag.elem_size = fixed->size;
+            tag.symbol_type = fixed->type_code;
+        }
+        else
+        {
+            tag.udt_index = find_udt(db, config.type_name);
+            if (tag.udt_index == NO_UDT)
+            {
+                return false;
+            }
+
+            auto const& udt = db.udts[tag.udt_index];
+            tag.elem_size = udt.size;
+            tag.symbol_type = symbol::TYPE_IS_STRUCT | udt.udt_id;
+        }
+
+        if (tag.elem_count > 1)
+        {
+            tag.symbol_type |= symbol::ONE_DIMENSION;
+        }
+
+        db.tag_index[key] = (u32)db.tags.size();
+        db.tags.push_back(std::move(tag));
+
+        return true;
+    }
+
+
+    static void destroy_database(SimDatabase& db)
+    {
+        mb::destroy_buffer(db.value_data);
+        db.udts.clear();
+        db.tags.clear();
+        db.tag_index.clear();
+    }
+
+
+    static bool create_database(cipsim::SimConfig const& config, SimDatabase& db)
+    {
+        destroy_database(db);
+
+        for (auto const& udt : config.udts)
+        {
+            if (!add_udt(udt, db))
+            {
+                return false;
+            }
+        }
+
+        for (auto const& tag : config.tags)
+        {
+            if (!add_tag(tag, db))
+            {
+                return false;
+            }
+        }
+
+        if (db.tags.empty())
+        {
+            return false;
+        }
+
+        u64 value_bytes = 0;
+        for (auto const& tag : db.tags)
+        {
+            value_bytes += (u64)tag.elem_size * tag.elem_count;
+        }
+
+        if (value_bytes == 0 || value_bytes > 0xFFFFFFFF || !mb::create_buffer(db.value_data, (u32)value_bytes))
+        {
+            return false;
+        }
+
+        for (auto& tag : db.tags)
+        {
+            tag.value_bytes = mb::push_view(db.value_data, tag.elem_size * tag.elem_count);
+        }
+
+        return true;
+    }
+}
+
+
+/* tag values */
+
+namespace /* private */
+{
+    class ValueGenerator
+    {
+    public:
+        u32 state = 0x9E3779B9;
+
+        u32 next()
+        {
+            // xorshift32
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+
+        bool chance(u32 percent) { return percent && (next() % 100) < percent; }
+    };
+
+
+    static void generate_values(SimTag const& tag, ValueGenerator& gen)
+    {
+        auto& bytes = tag.value_bytes;
+
+        for (u32 i = 0; i < bytes.length; ++i)
+        {
+            auto r = gen.next();
+
+            switch (tag.type_code)
+            {
+            case TYPE_CODE_BOOL:
+                bytes.data[i] = (u8)(r & 1);
+                break;
+
+            case TYPE_CODE_STRING:
+                bytes.data[i] = (u8)(32 + r % 95);
+                break;
+
+            default:
+                bytes.data[i] = (u8)r;
+                break;
+            }
+        }
+    }
+}
+
+
+/* byte reader */
+
+namespace /* private */
+{
+    class ByteReader
+    {
+    public:
+        u8 const* data = nullptr;
+        u32 length = 0;
+        u32 pos = 0;
+
+        bool ok = true;
+
+        u32 remaining() const { return ok ? length - pos : 0; }
+
+        u8 const* current() const { return data + pos; }
+    };
+
+
+    static ByteReader make_reader(u8 const* data, u32 length)
+    {
+        ByteReader r{};
+        r.data = data;
+        r.length = length;
+
+        return r;
+    }
+
+
+    static u8 const* take(ByteReader& r, u32 n_bytes)
+    {
+        if (!r.ok || r.length - r.pos < n_bytes)
+        {
+            r.ok = false;
+            return nullptr;
+        }
+
+        auto p = r.data + r.pos;
+        r.pos += n_bytes;
+
+        return p;
+    }
+
+
+    static ByteReader take_reader(ByteReader& r, u32 n_bytes)
+    {
+        auto p = take(r, n_bytes);
+
+        auto sub = make_reader(p, p ? n_bytes : 0);
+        sub.ok = p != nullptr;
+
+        return sub;
+    }
+
+
+    static u8 get8(ByteReader& r)
+    {
+        auto p = take(r, 1);
+        return p ? p[0] : 0;
+    }
+
+
+    static u16 get16(ByteReader& r)
+    {
+        auto p = take(r, 2);
+        return p ? (u16)(p[0] | (p[1] << 8)) : 0;
+    }
+
+
+    static u32 get32(ByteReader& r)
+    {
+        auto p = take(r, 4);
+        return p ? (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24) : 0;
+    }
+
+
+    static void set16(cipsim::List<u8>& bytes, u32 pos, u16 value)
+    {
+        bytes[pos] = (u8)(value & 0xFF);
+        bytes[pos + 1] = (u8)(value >> 8);
+    }
+
+
+}
+
+
+/* cip services */
+
+namespace /* private */
+{
+    using Bytes = cipsim::List<u8>;
+
+
+    class SimState
+    {
+    public:
+        SimDatabase db;
+
+        u32 max_connection_size = 4002;
+        bool large_forward_open = true;
+        u32 value_change_percent = 1;
+
+        ValueGenerator gen;
+
+        u32 next_session_handle = 1;
+        u32 next_connection_id = 0x10000;
+
+        std::mutex lock;
+    };
+
+
+    class CipStatus
+    {
+    public:
+        u8 general = cip::STATUS_OK;
+        u16 extended = 0;
+    };
+
+
+    class CipRequest
+    {
+    public:
+        u8 service = 0;
+        ByteReader path;
+        ByteReader data;
+    };
+
+
+    static CipStatus cip_error(u8 general, u16 extended = 0)
+    {
+        CipStatus status{};
+        status.general = general;
+        status.extended = extended;
+
+        return status;
+    }
+
+
+    static bool parse_request(ByteReader req, CipRequest& out)
+    {
+        out.service = get8(req);
+
+        auto path_words = get8(req);
+        out.path = take_reader(req, 2u * path_words);
+
+        out.data = take_reader(req, req.remaining());
+
+        return req.ok && out.path.ok;
+    }
+
+
+    static void put_reply_header(Bytes& reply, u8 service, CipStatus status)
+    {
+        reply.push_back((u8)(service | cip::REPLY));
+        reply.push_back(0);
+        reply.push_back(status.general);
+
+        if (status.extended)
+        {
+            reply.push_back(1);
+            put16(reply, status.extended);
+        }
+        else
+        {
+            reply.push_back(0);
+        }
+    }
+
+
+    static bool get_class_instance(ByteReader& path, u8 class_id, u32& instance_id)
+    {
+        if (get8(path) != cip::SEGMENT_CLASS || get8(path) != class_id)
+        {
+            return false;
+        }
+
+        auto segment = get8(path);
+        if (segment == cip::SEGMENT_INSTANCE8)
+        {
+            instance_id = get8(path);
+        }
+        else if (segment == cip::SEGMENT_INSTANCE16)
+        {
+            get8(path); // pad
+            instance_id = get16(path);
+        }
+        else
+        {
+            return false;
+        }
+
+        return path.ok;
+    }
+}
+
+
+/* read tag */
+
+namespace /* private */
+{
+    class ItemRef
+    {
+    public:
+        SimTag* tag = nullptr;
+
+        u8 type_code = 0;
+        u32 udt_index = NO_UDT;
+        i32 bit_number = -1;
+
+        u32 byte_offset = 0;
+        u32 elem_size = 0;
+        u32 elem_available = 0;
+    };
+
+
+    static CipStatus resolve_item(SimDatabase& db, ByteReader path, ItemRef& item)
+    {
+        bool has_tag = false;
+        bool has_index = false;
+
+        while (path.remaining())
+        {
+            auto segment = get8(path);
+
+            if (segment == cip::SEGMENT_SYMBOLIC)
+            {
+                auto len = get8(path);
+                auto name = take(path, len);
+                if (!name)
+                {
+                    return cip_error(cip::STATUS_PATH_SEGMENT);
+                }
+
+                if (len & 1)
+                {
+                    get8(path); // pad
+                }
+
+                if (!has_tag)
+                {
+                    auto it = db.tag_index.find(to_lower(std::string((cstr)name, len)));
+                    if (it == db.tag_index.end())
+                    {
+                        return cip_error(cip::STATUS_PATH_UNKNOWN);
+                    }
+
+                    auto& tag = db.tags[it->second];
+
+                    item.tag = &tag;
+                    item.type_code = tag.type_code;
+                    item.udt_index = tag.udt_index;
+                    item.elem_size = tag.elem_size;
+                    item.elem_available = tag.elem_count;
+
+                    has_tag = true;
+                    has_index = false;
+                    continue;
+                }
+
+                // member of the current structure
+                if (item.udt_index == NO_UDT || item.bit_number >= 0)
+                {
+                    return cip_error(cip::STATUS_PATH_SEGMENT);
+                }
+
+                auto const& udt = db.udts[item.udt_index];
+
+                SimField const* field = nullptr;
+                for (auto const& f : udt.fields)
+                {
+                    if (name_equals(f.field_name, name, len))
+                    {
+                        field = &f;
+                        break;
+                    }
+                }
+
+                if (!field)
+                {
+                    return cip_error(cip::STATUS_PATH_UNKNOWN);
+                }
+
+                item.byte_offset += field->offset;
+                item.type_code = field->type_code;
+                item.udt_index = field->udt_index;
+                item.bit_number = field->bit_number;
+                item.elem_size = field->elem_size;
+                item.elem_available = field->array_count;
+
+                has_index = false;
+                continue;
+            }
+
+            u32 index = 0;
+
+            switch (segment)
+            {
+            case cip::SEGMENT_ELEMENT8:
+                index = get8(path);
+                break;
+
+            case cip::SEGMENT_ELEMENT16:
+                get8(path);
+                index = get16(path);
+                break;
+
+            case cip::SEGMENT_ELEMENT32:
+                get8(path);
+                index = get32(path);
+                break;
+
+            default:
+                return cip_error(cip::STATUS_PATH_SEGMENT);
+            }
+
+            // one dimensional arrays only
+            if (!has_tag || has_index || !path.ok)
+            {
+                return cip_error(cip::STATUS_PATH_SEGMENT);
+            }
+
+            if (index >= item.elem_available)
+            {
+                return cip_error(cip::STATUS_GENERAL, cip::EXT_OUT_OF_RANGE);
+            }
+
+            item.byte_offset += index * item.elem_size;
+            item.elem_available -= index;
+
+            has_index = true;
+        }
+
+        if (!has_tag || !path.ok)
+        {
+            return cip_error(cip::STATUS_PATH_SEGMENT);
+        }
+
+        return cip_error(cip::STATUS_OK);
+    }
+
+
+    static void put_type_info(Bytes& reply, ItemRef const& item, SimDatabase const& db)
+    {
+        if (item.udt_index != NO_UDT)
+        {
+            reply.push_back(cip::TYPE_ABBREV_STRUCT);
+            reply.push_back(2);
+            put16(reply, db.udts[item.udt_index].handle);
+        }
+        else
+        {
+            reply.push_back(item.bit_number >= 0 ? TYPE_CODE_BOOL : item.type_code);
+            reply.push_back(0);
+        }
+    }
+
+
+    static void read_tag(SimState& sim, CipRequest& req, u32 max_reply, Bytes& reply)
+    {
+        ItemRef item{};
+
+        auto status = resolve_item(sim.db, req.path, item);
+        if (status.general != cip::STATUS_OK)
+        {
+            put_reply_header(reply, req.service, status);
+            return;
+        }
+
+        if (item.tag->is_faulted)
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_UNSUPPORTED));
+            return;
+        }
+
+        auto elem_count = (u32)get16(req.data);
+        auto offset = req.service == cip::READ_TAG_FRAG ? get32(req.data) : 0u;
+
+        if (!req.data.ok)
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_NOT_ENOUGH_DATA));
+            return;
+        }
+
+        if (item.bit_number >= 0)
+        {
+            // a single BOOL member reads as one byte
+            item.elem_size = 1;
+        }
+
+        auto total = elem_count * item.elem_size;
+
+        if (elem_count == 0 || elem_count > item.elem_available || offset > total)
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_GENERAL, cip::EXT_OUT_OF_RANGE));
+            return;
+        }
+
+        if (offset == 0 && sim.gen.chance(sim.value_change_percent))
+        {
+            generate_values(*item.tag, sim.gen);
+        }
+
+        auto start = reply.size();
+
+        put_reply_header(reply, req.service, cip_error(cip::STATUS_OK));
+        put_type_info(reply, item, sim.db);
+
+        auto header_size = (u32)(reply.size() - start);
+        auto available = max_reply > header_size ? max_reply - header_size : 0u;
+
+        auto want = total - offset;
+        auto n_bytes = want < available ? want : available;
+
+        if (n_bytes < want)
+        {
+            reply[start + 2] = cip::STATUS_PARTIAL;
+        }
+
+        auto src = item.tag->value_bytes.data + item.byte_offset + offset;
+
+        if (item.bit_number >= 0)
+        {
+            reply.push_back((u8)((src[0] >> item.bit_number) & 1));
+            return;
+        }
+
+        reply.insert(reply.end(), src, src + n_bytes);
+    }
+}
+
+
+/* write tag */
+
+namespace /* private */
+{
+    static bool type_matches(u8 const* type_info, u32 type_size, ItemRef const& item, SimDatabase const& db)
+    {
+        if (item.udt_index != NO_UDT)
+        {
+            return type_size == 4 && type_info[0] == cip::TYPE_ABBREV_STRUCT && (type_info[2] | (type_info[3] << 8)) == db.udts[item.udt_index].handle;
+        }
+
+        return type_size == 2 && type_info[0] == item.type_code;
+    }
+
+
+    static void write_tag(SimState& sim, CipRequest& req, Bytes& reply)
+    {
+        ItemRef item{};
+
+        auto status = resolve_item(sim.db, req.path, item);
+        if (status.general != cip::STATUS_OK)
+        {
+            put_reply_header(reply, req.service, status);
+            return;
+        }
+
+        // abbreviated type, a structure handle follows 0xA0
+        auto type_size = req.data.remaining() && req.data.current()[0] == cip::TYPE_ABBREV_STRUCT ? 4u : 2u;
+        auto type_info = take(req.data, type_size);
+
+        auto elem_count = (u32)get16(req.data);
+        auto offset = req.service == cip::WRITE_TAG_FRAG ? get32(req.data) : 0u;
+
+        if (!type_info || !req.data.ok)
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_NOT_ENOUGH_DATA));
+            return;
+        }
+
+        // bit members are written with Read Modify Write, not supported
+        if (item.bit_number >= 0 || !type_matches(type_info, type_size, item, sim.db))
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_GENERAL, cip::EXT_INVALID_SIZE));
+            return;
+        }
+
+        auto total = elem_count * item.elem_size;
+        auto n_bytes = req.data.remaining();
+
+        if (elem_count == 0 || elem_count > item.elem_available || offset + n_bytes > total)
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_GENERAL, cip::EXT_OUT_OF_RANGE));
+            return;
+        }
+
+        auto src = take(req.data, n_bytes);
+        auto dst = item.tag->value_bytes.data + item.byte_offset + offset;
+
+        std::copy(src, src + n_bytes, dst);
+
+        put_reply_header(reply, req.service, cip_error(cip::STATUS_OK));
+    }
+}
+
+
+/* tag listing and templates */
+
+namespace /* private */
+{
+    static void list_tags(SimState& sim, CipRequest& req, u32 max_reply, Bytes& reply)
+    {
+        auto path = req.path;
+
+        auto program_scope = path.remaining() && path.current()[0] == cip::SEGMENT_SYMBOLIC;
+        if (program_scope)
+        {
+            get8(path);
+            auto len = get8(path);
+            take(path, len + (len & 1));
+        }
+
+        u32 start_id = 0;
+        if (!get_class_instance(path, cip::CLASS_SYMBOL, start_id))
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_PATH_SEGMENT));
+            return;
+        }
+
+        auto n_attrs = get16(req.data);
+
+        cipsim::List<u16> attrs;
+        for (u32 i = 0; i < n_attrs; ++i)
+        {
+            auto attr = get16(req.data);
+            if (attr != 1 && attr != 2 && attr != 7 && attr != 8)
+            {
+                put_reply_header(reply, req.service, cip_error(cip::STATUS_ATTR_UNSUPPORTED));
+                return;
+            }
+
+            attrs.push_back(attr);
+        }
+
+        if (!req.data.ok)
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_NOT_ENOUGH_DATA));
+            return;
+        }
+
+        auto start = reply.size();
+
+        put_reply_header(reply, req.service, cip_error(cip::STATUS_OK));
+
+        // no program tags
+        if (program_scope)
+        {
+            return;
+        }
+
+        Bytes entry;
+
+        for (auto const& tag : sim.db.tags)
+        {
+            if (tag.instance_id < start_id)
+            {
+                continue;
+            }
+
+            entry.clear();
+            put32(entry, tag.instance_id);
+
+            for (auto attr : attrs)
+            {
+                switch (attr)
+                {
+                case 1:
+                    put16(entry, (u16)tag.tag_name.length());
+                    entry.insert(entry.end(), tag.tag_name.begin(), tag.tag_name.end());
+                    break;
+
+                case 2:
+                    put16(entry, tag.symbol_type);
+                    break;
+
+                case 7:
+                    put16(entry, (u16)tag.elem_size);
+                    break;
+
+                case 8:
+                    put32(entry, tag.elem_count > 1 ? tag.elem_count : 0);
+                    put32(entry, 0);
+                    put32(entry, 0);
+                    break;
+                }
+            }
+
+            if (reply.size() - start + entry.size() > max_reply)
+            {
+                reply[start + 2] = cip::STATUS_PARTIAL;
+                return;
+            }
+
+            reply.insert(reply.end(), entry.begin(), entry.end());
+        }
+    }
+
+
+    static SimUdt const* find_template(SimDatabase const& db, u32 instance_id)
+    {
+        for (auto const& udt : db.udts)
+        {
+            if (udt.udt_id == instance_id)
+            {
+                return &udt;
+            }
+        }
+
+        return nullptr;
+    }
+
+
+    static void get_template_attributes(SimState& sim, CipRequest& req, Bytes& reply)
+    {
+        u32 instance_id = 0;
+        if (!get_class_instance(req.path, cip::CLASS_TEMPLATE, instance_id))
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_PATH_SEGMENT));
+            return;
+        }
+
+        auto udt = find_template(sim.db, instance_id);
+        if (!udt)
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_PATH_UNKNOWN));
+            return;
+        }
+
+        auto n_attrs = get16(req.data);
+
+        put_reply_header(reply, req.service, cip_error(cip::STATUS_OK));
+        put16(reply, n_attrs);
+
+        for (u32 i = 0; i < n_attrs && req.data.ok; ++i)
+        {
+            auto attr = get16(req.data);
+
+            put16(reply, attr);
+
+            switch (attr)
+            {
+            case 1: // structure handle
+                put16(reply, 0);
+                put16(reply, udt->handle);
+                break;
+
+            case 2: // member count
+                put16(reply, 0);
+                put16(reply, (u16)udt->fields.size());
+                break;
+
+            case 4: // template size in 32-bit words
+                put16(reply, 0);
+                put32(reply, udt->template_words);
+                break;
+
+            case 5: // structure size in bytes
+                put16(reply, 0);
+                put32(reply, udt->size);
+                break;
+
+            default:
+                put16(reply, cip::STATUS_ATTR_UNSUPPORTED);
+                break;
+            }
+        }
+    }
+
+
+    static void read_template(SimState& sim, CipRequest& req, u32 max_reply, Bytes& reply)
+    {
+        u32 instance_id = 0;
+        if (!get_class_instance(req.path, cip::CLASS_TEMPLATE, instance_id))
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_PATH_SEGMENT));
+            return;
+        }
+
+        auto udt = find_template(sim.db, instance_id);
+        if (!udt)
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_PATH_UNKNOWN));
+            return;
+        }
+
+        if (udt->is_faulted)
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_UNSUPPORTED));
+            return;
+        }
+
+        auto offset = get32(req.data);
+        auto size = (u32)get16(req.data);
+
+        auto& bytes = udt->template_bytes;
+        auto length = (u32)bytes.size();
+
+        if (!req.data.ok || offset > length)
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_GENERAL, cip::EXT_OUT_OF_RANGE));
+            return;
+        }
+
+        auto start = reply.size();
+
+        put_reply_header(reply, req.service, cip_error(cip::STATUS_OK));
+
+        auto available = max_reply > 4 ? max_reply - 4 : 0u;
+
+        auto want = length - offset < size ? length - offset : size;
+        auto n_bytes = want < available ? want : available;
+
+        if (n_bytes < want)
+        {
+            reply[start + 2] = cip::STATUS_PARTIAL;
+        }
+
+        reply.insert(reply.end(), bytes.begin() + offset, bytes.begin() + offset + n_bytes);
+    }
+}
+
+
+/* service dispatch */
+
+namespace /* private */
+{
+    static void process_service(SimState& sim, ByteReader request, u32 max_reply, Bytes& reply, bool is_embedded);
+
+
+    static void multi_service(SimState& sim, CipRequest& req, u32 max_reply, Bytes& reply)
+    {
+        auto& data = req.data;
+
+        auto n_services = (u32)get16(data);
+
+        cipsim::List<u16> offsets;
+        for (u32 i = 0; i < n_services; ++i)
+        {
+            offsets.push_back(get16(data));
+        }
+
+        if (!data.ok || n_services == 0)
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_NOT_ENOUGH_DATA));
+            return;
+        }
+
+        auto start = (u32)reply.size();
+
+        put_reply_header(reply, req.service, cip_error(cip::STATUS_OK));
+
+        auto count_pos = (u32)reply.size();
+
+        put16(reply, (u16)n_services);
+        for (u32 i = 0; i < n_services; ++i)
+        {
+            put16(reply, 0);
+        }
+
+        bool all_ok = true;
+
+        for (u32 i = 0; i < n_services; ++i)
+        {
+            u32 begin = offsets[i];
+            u32 end = i + 1 < n_services ? offsets[i + 1] : data.length;
+
+            auto reply_pos = (u32)reply.size();
+
+            set16(reply, count_pos + 2 + 2 * i, (u16)(reply_pos - count_pos));
+
+            // the reply is filled in order, later services are only sure of an error reply
+            auto used = reply_pos - start;
+            auto reserved = (n_services - i - 1) * cip::MIN_EMBEDDED_REPLY_SIZE;
+            auto budget = max_reply > used + reserved ? max_reply - used - reserved : 0u;
+
+            auto is_valid = begin < end && end <= data.length;
+
+            if (!is_valid)
+            {
+                put_reply_header(reply, 0, cip_error(cip::STATUS_NOT_ENOUGH_DATA));
+            }
+            else
+            {
+                process_service(sim, make_reader(data.data + begin, end - begin), budget, reply, true);
+            }
+
+            // reads are cut to the budget, other replies fit whole or not at all
+            if (is_valid && (u32)reply.size() - reply_pos > budget)
+            {
+                reply.resize(reply_pos);
+                put_reply_header(reply, data.data[begin], cip_error(cip::STATUS_REPLY_TOO_LARGE));
+            }
+
+            all_ok = all_ok && reply[reply_pos + 2] == cip::STATUS_OK;
+        }
+
+        if (!all_ok)
+        {
+            reply[start + 2] = cip::STATUS_EMBEDDED_ERROR;
+        }
+    }
+
+
+    static void process_service(SimState& sim, ByteReader request, u32 max_reply, Bytes& reply, bool is_embedded)
+    {
+        CipRequest req{};
+
+        if (!parse_request(request, req))
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_NOT_ENOUGH_DATA));
+            return;
+        }
+
+        auto is_template = req.path.remaining() >= 2 && req.path.current()[0] == cip::SEGMENT_CLASS && req.path.current()[1] == cip::CLASS_TEMPLATE;
+
+        switch (req.service)
+        {
+        case cip::MULTI_SERVICE:
+            if (is_embedded)
+            {
+                break;
+            }
+
+            multi_service(sim, req, max_reply, reply);
+            return;
+
+        case cip::READ_TAG:
+            if (is_template)
+            {
+                read_template(sim, req, max_reply, reply);
+            }
+            else
+            {
+                read_tag(sim, req, max_reply, reply);
+            }
+            return;
+
+        case cip::READ_TAG_FRAG:
+            read_tag(sim, req, max_reply, reply);
+            return;
+
+        case cip::WRITE_TAG:
+        case cip::WRITE_TAG_FRAG:
+            write_tag(sim, req, reply);
+            return;
+
+        case cip::LIST_TAGS:
+            list_tags(sim, req, max_reply, reply);
+            return;
+
+        case cip::GET_ATTR_LIST:
+            if (is_template)
+            {
+                get_template_attributes(sim, req, reply);
+                return;
+            }
+            break;
+
+        default:
+            break;
+        }
+
+        put_reply_header(reply, req.service, cip_error(cip::STATUS_UNSUPPORTED));
+    }
+}
+
+
+/* connection manager */
+
+namespace /* private */
+{
+    class ClientState
+    {
+    public:
+        u32 session_handle = 0;
+
+        bool is_connected = false;
+
+        u32 o_t_connection_id = 0; // ours
+        u32 t_o_connection_id = 0; // client's
+        u16 connection_serial = 0;
+
+        u32 connection_size = 0;
+    };
+
+
+    static void forward_open(SimState& sim, ClientState& client, CipRequest& req, Bytes& reply)
+    {
+        auto is_large = req.service == cip::LARGE_FORWARD_OPEN;
+
+        if (is_large && !sim.large_forward_open)
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_UNSUPPORTED));
+            return;
+        }
+
+        auto& data = req.data;
+
+        get8(data); // secs per tick
+        get8(data); // timeout ticks
+        get32(data); // O->T connection id, ours to pick
+        auto t_o_id = get32(data);
+        auto serial = get16(data);
+        auto vendor = get16(data);
+        auto orig_serial = get32(data);
+        get8(data); // timeout multiplier
+        take(data, 3);
+        auto o_t_rpi = get32(data);
+        auto o_t_params = is_large ? get32(data) : (u32)get16(data);
+        auto t_o_rpi = get32(data);
+        is_large ? get32(data) : (u32)get16(data);
+
+        if (!data.ok)
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_NOT_ENOUGH_DATA));
+            return;
+        }
+
+        auto size = is_large ? (o_t_params & 0xFFFF) : (o_t_params & cip::MAX_SMALL_CONNECTION_SIZE);
+        auto max_size = is_large ? sim.max_connection_size : std::min(sim.max_connection_size, cip::MAX_SMALL_CONNECTION_SIZE);
+
+        if (size > max_size)
+        {
+            // tells libplctag which size to retry with
+            reply.push_back((u8)(req.service | cip::REPLY));
+            reply.push_back(0);
+            reply.push_back(cip::STATUS_CONNECTION_FAILED);
+            reply.push_back(2);
+            put16(reply, cip::EXT_INVALID_SIZE);
+            put16(reply, (u16)max_size);
+            return;
+        }
+
+        client.is_connected = true;
+        client.o_t_connection_id = sim.next_connection_id++;
+        client.t_o_connection_id = t_o_id;
+        client.connection_serial = serial;
+        client.connection_size = size;
+
+        put_reply_header(reply, req.service, cip_error(cip::STATUS_OK));
+        put32(reply, client.o_t_connection_id);
+        put32(reply, client.t_o_connection_id);
+        put16(reply, serial);
+        put16(reply, vendor);
+        put32(reply, orig_serial);
+        put32(reply, o_t_rpi);
+        put32(reply, t_o_rpi);
+        reply.push_back(0); // application reply size
+        reply.push_back(0);
+    }
+
+
+    static void forward_close(ClientState& client, CipRequest& req, Bytes& reply)
+    {
+        auto& data = req.data;
+
+        get8(data);
+        get8(data);
+        auto serial = get16(data);
+        auto vendor = get16(data);
+        auto orig_serial = get32(data);
+
+        if (!data.ok)
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_NOT_ENOUGH_DATA));
+            return;
+        }
+
+        client.is_connected = false;
+
+        put_reply_header(reply, req.service, cip_error(cip::STATUS_OK));
+        put16(reply, serial);
+        put16(reply, vendor);
+        put32(reply, orig_serial);
+        reply.push_back(0);
+        reply.push_back(0);
+    }
+
+
+    static void unconnected_send(SimState& sim, CipRequest& req, Bytes& reply)
+    {
+        auto& data = req.data;
+
+        get8(data);
+        get8(data);
+        auto len = get16(data);
+        auto embedded = take_reader(data, len);
+
+        if (!embedded.ok)
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_NOT_ENOUGH_DATA));
+            return;
+        }
+
+        // the route path that follows is ignored, every request lands on this controller
+        process_service(sim, embedded, cip::MAX_SMALL_CONNECTION_SIZE, reply, false);
+    }
+
+
+    static void connection_manager(SimState& sim, ClientState& client, ByteReader request, Bytes& reply)
+    {
+        CipRequest req{};
+
+        if (!parse_request(request, req))
+        {
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_NOT_ENOUGH_DATA));
+            return;
+        }
+
+        switch (req.service)
+        {
+        case cip::FORWARD_OPEN:
+        case cip::LARGE_FORWARD_OPEN:
+            forward_open(sim, client, req, reply);
+            return;
+
+        case cip::FORWARD_CLOSE:
+            forward_close(client, req, reply);
+            return;
+
+        case cip::UNCONNECTED_SEND:
+            unconnected_send(sim, req, reply);
+            return;
+
+        default:
+            break;
+        }
+
+        // anything else sent unconnected goes straight to the message router
+        process_service(sim, request, cip::MAX_SMALL_CONNECTION_SIZE, reply, false);
+    }
+}
+
+
+/* encapsulation */
+
+namespace /* private */
+{
+    class EncapHeader
+    {
+    public:
+        u16 command = 0;
+        u16 length = 0;
+        u32 session_handle = 0;
+        u32 status = 0;
+        u8 sender_context[8] = { 0 };
+        u32 options = 0;
+    };
+
+
+    static EncapHeader parse_encap_header(u8 const* data)
+    {
+        auto r = make_reader(data, eip::HEADER_SIZE);
+
+        EncapHeader h{};
+        h.command = get16(r);
+        h.length = get16(r);
+        h.session_handle = get32(r);
+        h.status = get32(r);
+        std::memcpy(h.sender_context, take(r, 8), 8);
+        h.options = get32(r);
+
+        return h;
+    }
+
+
+    static void put_encap_header(Bytes& reply, EncapHeader const& request, u32 session_handle, u32 status)
+    {
+        put16(reply, request.command);
+        put16(reply, 0); // length
+        put32(reply, session_handle);
+        put32(reply, status);
+        reply.insert(reply.end(), request.sender_context, request.sender_context + 8);
+        put32(reply, 0);
+    }
+
+
+    static void finish_encap(Bytes& reply)
+    {
+        set16(reply, 2, (u16)(reply.size() - eip::HEADER_SIZE));
+    }
+
+
+    static bool send_rr_data(SimState& sim, ClientState& client, ByteReader body, Bytes& reply)
+    {
+        get32(body); // interface handle
+        get16(body); // timeout
+
+        auto n_items = get16(body);
+
+        ByteReader request{};
+        request.ok = false;
+
+        for (u32 i = 0; i < n_items && body.ok; ++i)
+        {
+            auto type = get16(body);
+            auto len = get16(body);
+            auto item = take_reader(body, len);
+
+            if (type == eip::ITEM_UDI)
+            {
+                request = item;
+            }
+        }
+
+        if (!body.ok || !request.ok)
+        {
+            return false;
+        }
+
+        put32(reply, 0);
+        put16(reply, 0);
+        put16(reply, 2);
+        put16(reply, eip::ITEM_NAI);
+        put16(reply, 0);
+        put16(reply, eip::ITEM_UDI);
+
+        auto len_pos = (u32)reply.size();
+        put16(reply, 0);
+
+        connection_manager(sim, client, request, reply);
+
+        set16(reply, len_pos, (u16)(reply.size() - len_pos - 2));
+
+        return true;
+    }
+
+
+    static bool send_unit_data(SimState& sim, ClientState& client, ByteReader body, Bytes& reply)
+    {
+        get32(body); // interface handle
+        get16(body); // timeout
+
+        auto n_items = get16(body);
+
+        u32 connection_id = 0;
+        ByteReader data{};
+        data.ok = false;
+
+        for (u32 i = 0; i < n_items && body.ok; ++i)
+        {
+            auto type = get16(body);
+            auto len = get16(body);
+            auto item = take_reader(body, len);
+
+            if (type == eip::ITEM_CAI)
+            {
+                connection_id = get32(item);
+            }
+            else if (type == eip::ITEM_CDI)
+            {
+                data = item;
+            }
+        }
+
+        if (!body.ok || !data.ok)
+        {
+            return false;
+        }
+
+        auto sequence = get16(data);
+        auto request = take_reader(data, data.remaining());
+
+        put32(reply, 0);
+        put16(reply, 0);
+        put16(reply, 2);
+        put16(reply, eip::ITEM_CAI);
+        put16(reply, 4);
+        put32(reply, client.t_o_connection_id);
+        put16(reply, eip::ITEM_CDI);
+
+        auto len_pos = (u32)reply.size();
+        put16(reply, 0);
+        put16(reply, sequence);
+
+        if (!client.is_connected || connection_id != client.o_t_connection_id)
+        {
+            CipRequest req{};
+            parse_request(request, req);
+            put_reply_header(reply, req.service, cip_error(cip::STATUS_CONNECTION_FAILED, cip::EXT_CONNECTION_NOT_FOUND));
+        }
+        else
+        {
+            // the sequence count is part of the connection size
+            process_service(sim, request, client.connection_size - 2, reply, false);
+        }
+
+        set16(reply, len_pos, (u16)(reply.size() - len_pos - 2));
+
+        return true;
+    }
+
+
+    // returns false when the client connection should be closed
+    static bool process_packet(SimState& sim, ClientState& client, u8 const* packet, u32 size, Bytes& reply)
+    {
+        auto header = parse_encap_header(packet);
+        auto body = make_reader(packet + eip::HEADER_SIZE, size - eip::HEADER_SIZE);
+
+        reply.clear();
+
+        switch (header.command)
+        {
+        case eip::NOP:
+            return true;
+
+        case eip::REGISTER_SESSION:
+        {
+            auto version = get16(body);
+            auto flags = get16(body);
+
+            if (!body.ok)
+            {
+                put_encap_header(reply, header, 0, eip::STATUS_BAD_DATA);
+                break;
+            }
+
+            client.session_handle = sim.next_session_handle++;
+
+            put_encap_header(reply, header, client.session_handle, eip::STATUS_OK);
+            put16(reply, version);
+            put16(reply, flags);
+        } break;
+
+        case eip::UNREGISTER_SESSION:
+            return false;
+
+        case eip::SEND_RR_DATA:
+        case eip::SEND_UNIT_DATA:
+        {
+            if (!client.session_handle || header.session_handle != client.session_handle)
+            {
+                put_encap_header(reply, header, header.session_handle, eip::STATUS_INVALID_SESSION);
+                break;
+            }
+
+            put_encap_header(reply, header, client.session_handle, eip::STATUS_OK);
+
+            auto ok = header.command == eip::SEND_RR_DATA ?
+                send_rr_data(sim, client, body, reply) :
+                send_unit_data(sim, client, body, reply);
+
+            if (!ok)
+            {
+                reply.clear();
+                put_encap_header(reply, header, client.session_handle, eip::STATUS_BAD_DATA);
+            }
+        } break;
+
+        default:
+            put_encap_header(reply, header, header.session_handle, eip::STATUS_INVALID_COMMAND);
+            break;
+        }
+
+        finish_encap(reply);
+
+        return true;
+    }
+}
+
+
+/* sockets */
+
+namespace /* private */
+{
+#ifdef _WIN32
+
+    constexpr socket_t INVALID_SOCKET_VALUE = INVALID_SOCKET;
+
+
+    static bool socket_startup()
+    {
+        WSADATA wsa_data;
+        return WSAStartup(MAKEWORD(2, 2), &wsa_data) == 0;
+    }
+
+
+    static void socket_cleanup() { WSACleanup(); }
+
+
+    static void close_socket(socket_t sock) { closesocket(sock); }
+
+
+    static void set_recv_timeout(socket_t sock, int timeout_ms)
+    {
+        DWORD timeout = (DWORD)timeout_ms;
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (char const*)&timeout, sizeof(timeout));
+    }
+
+
+    static bool wait_readable(socket_t sock, int timeout_ms)
+    {
+        WSAPOLLFD pfd{};
+        pfd.fd = sock;
+        pfd.events = POLLRDNORM;
+
+        return WSAPoll(&pfd, 1, timeout_ms) > 0;
+    }
+
+
+    static bool is_timeout_error()
+    {
+        auto err = WSAGetLastError();
+        return err == WSAETIMEDOUT || err == WSAEWOULDBLOCK;
+    }
+
+#else
+
+    constexpr socket_t INVALID_SOCKET_VALUE = -1;
+
+
+    static bool socket_startup() { return true; }
+
+
+    static void socket_cleanup() { }
+
+
+    static void close_socket(socket_t sock) { close(sock); }
+
+
+    static void set_recv_timeout(socket_t sock, int timeout_ms)
+    {
+        timeval timeout{};
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_usec = (timeout_ms % 1000) * 1000;
+
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+
+
+    static bool wait_readable(socket_t sock, int timeout_ms)
+    {
+        pollfd pfd{};
+        pfd.fd = sock;
+        pfd.events = POLLIN;
+
+        return poll(&pfd, 1, timeout_ms) > 0;
+    }
+
+
+    static bool is_timeout_error()
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+
+#endif
+
+
+    static bool recv_bytes(socket_t sock, u8* dst, u32 n_bytes, std::atomic<bool> const& is_running)
+    {
+        u32 received = 0;
+
+        while (received < n_bytes)
+        {
+            auto rc = recv(sock, (char*)(dst + received), (int)(n_bytes - received), 0);
+            if (rc > 0)
+            {
+                received += (u32)rc;
+            }
+            else if (rc < 0 && is_timeout_error() && is_running)
+            {
+                continue;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    static bool send_bytes(socket_t sock, u8 const* src, u32 n_bytes)
+    {
+        u32 sent = 0;
+
+        while (sent < n_bytes)
+        {
+            auto rc = send(sock, (char const*)(src + sent), (int)(n_bytes - sent), 0);
+            if (rc <= 0)
+            {
+                return false;
+            }
+
+            sent += (u32)rc;
+        }
+
+        return true;
+    }
+
+
+    static socket_t open_listen_socket(u16 port)
+    {
+        auto sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (sock == INVALID_SOCKET_VALUE)
+        {
+            return INVALID_SOCKET_VALUE;
+        }
+
+        int on = 1;
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (char const*)&on, sizeof(on));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        if (bind(sock, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(sock, 8) != 0)
+        {
+            close_socket(sock);
+            return INVALID_SOCKET_VALUE;
+        }
+
+        return sock;
+    }
+}
+
+
+/* server */
+
+namespace /* private */
+{
+    class SimServer
+    {
+    public:
+        SimState sim;
+
+        socket_t listen_socket = INVALID_SOCKET_VALUE;
+
+        std::atomic<bool> is_running = false;
+
+        std::thread accept_thread;
+
+        std::mutex client_lock;
+        cipsim::List<std::thread> client_threads;
+    };
+
+
+    static SimServer g_server;
+
+
+    static void serve_client(SimServer& server, socket_t sock)
+    {
+        auto& sim = server.sim;
+
+        int on = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (char const*)&on, sizeof(on));
+
+        set_recv_timeout(sock, 100);
+
+        ClientState client{};
+
+        Bytes packet(eip::MAX_PACKET_SIZE);
+        Bytes reply;
+        reply.reserve(eip::MAX_PACKET_SIZE);
+
+        while (server.is_running)
+        {
+            if (!recv_bytes(sock, packet.data(), eip::HEADER_SIZE, server.is_running))
+            {
+                break;
+            }
+
+            auto length = (u32)packet[2] | ((u32)packet[3] << 8);
+
+            if (!recv_bytes(sock, packet.data() + eip::HEADER_SIZE, length, server.is_running))
+            {
+                break;
+            }
+
+            bool keep_open = false;
+            {
+                std::lock_guard<std::mutex> guard(sim.lock);
+                keep_open = process_packet(sim, client, packet.data(), eip::HEADER_SIZE + length, reply);
+            }
+
+            if (!keep_open)
+            {
+                break;
+            }
+
+            if (!reply.empty() && !send_bytes(sock, reply.data(), (u32)reply.size()))
+            {
+                break;
+            }
+        }
+
+        close_socket(sock);
+    }
+
+
+    static void accept_clients(SimServer& server)
+    {
+        while (server.is_running)
+        {
+            if (!wait_readable(server.listen_socket, 100))
+            {
+                continue;
+            }
+
+            auto sock = accept(server.listen_socket, nullptr, nullptr);
+            if (sock == INVALID_SOCKET_VALUE)
+            {
+                continue;
+            }
+
+            std::lock_guard<std::mutex> guard(server.client_lock);
+            server.client_threads.emplace_back([&server, sock]() { serve_client(server, sock); });
+        }
+    }
+}
+
+
+/* config */
+
+namespace /* private */
+{
+    static cipsim::TagConfig to_tag_config(cstr type_name, cstr tag_name, u32 array_count)
+    {
+        cipsim::TagConfig tag{};
+        tag.type_name = type_name;
+        tag.tag_name = tag_name;
+        tag.array_count = array_count;
+
+        return tag;
+    }
+
+
+    static cipsim::FieldConfig to_field_config(cstr type_name, cstr field_name, u32 array_count = 1)
+    {
+        cipsim::FieldConfig field{};
+        field.type_name = type_name;
+        field.field_name = field_name;
+        field.array_count = array_count;
+
+        return field;
+    }
+
+
+    static std::string trim(std::string const& str)
+    {
+        auto begin = str.find_first_not_of(" \t\r\n");
+        if (begin == std::string::npos)
+        {
+            return "";
+        }
+
+        auto end = str.find_last_not_of(" \t\r\n");
+
+        return str.substr(begin, end - begin + 1);
+    }
+
+
+    // "Name" or "Name[count]"
+    static bool parse_declaration_name(std::string const& token, std::string& name, u32& array_count)
+    {
+        array_count = 1;
+
+        auto open = token.find('[');
+        if (open == std::string::npos)
+        {
+            name = token;
+            return !name.empty();
+        }
+
+        auto close = token.find(']', open);
+        if (close == std::string::npos || close != token.length() - 1 || close == open + 1)
+        {
+            return false;
+        }
+
+        name = token.substr(0, open);
+
+        auto count = token.substr(open + 1, close - open - 1);
+        if (count.find_first_not_of("0123456789") != std::string::npos)
+        {
+            return false;
+        }
+
+        array_count = (u32)std::stoul(count);
+
+        return !name.empty() && array_count > 0;
+    }
+
+
+    static bool parse_setting(std::string const& key, std::string const& value, cipsim::SimConfig& config)
+    {
+        if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+        {
+            return false;
+        }
+
+        auto number = (u32)std::stoul(value);
+
+        if (key == "port")
+        {
+            config.port = (u16)number;
+        }
+        else if (key == "max_connection_size")
+        {
+            config.max_connection_size = number;
+        }
+        else if (key == "large_forward_open")
+        {
+            config.large_forward_open = number != 0;
+        }
+        else if (key == "value_change_percent")
+        {
+            config.value_change_percent = number;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+}
+
+
+/* api */
+
+namespace cipsim
+{
+    SimConfig default_config()
+    {
+        SimConfig config{};
+
+        UdtConfig udt_a{};
+        udt_a.udt_name = "UDTA";
+        udt_a.fields = { to_field_config("INT", "INT_field"), to_field_config("SINT", "SINT_field") };
+
+        UdtConfig udt_b{};
+        udt_b.udt_name = "UDTB";
+        udt_b.fields = { to_field_config("DINT", "DINT_field"), to_field_config("REAL", "REAL_field") };
+
+        UdtConfig udt_c{};
+        udt_c.udt_name = "UDTC";
+        udt_c.fields = { to_field_config("LREAL", "LREAL_field"), to_field_config("ULINT", "ULINT_field") };
+
+        UdtConfig udt_d{};
+        udt_d.udt_name = "UDTD";
+        udt_d.fields =
+        {
+            to_field_config("BOOL", "BOOL_field_A"),
+            to_field_config("BOOL", "BOOL_field_B"),
+            to_field_config("UDTB", "UDTB_field"),
+            to_field_config("REAL", "REAL_array_field", 10),
+        };
+
+        config.udts = { udt_a, udt_b, udt_c, udt_d };
+
+        cstr fixed_types[] = { "BOOL", "SINT", "INT", "DINT", "LINT", "USINT", "UINT", "ULINT", "REAL", "LREAL", "STRING" };
+        cstr udt_types[] = { "UDTA", "UDTB", "UDTC", "UDTD" };
+        cstr suffixes[] = { "A", "B", "C" };
+
+        auto const add_tags = [&](cstr type_name)
+        {
+            for (auto s : suffixes)
+            {
+                config.tags.push_back(to_tag_config(type_name, (std::string(type_name) + "_tag_" + s).c_str(), 1));
+            }
+
+            for (auto s : suffixes)
+            {
+                config.tags.push_back(to_tag_config(type_name, (std::string(type_name) + "_array_tag_" + s).c_str(), 5));
+            }
+        };
+
+        for (auto t : fixed_types)
+        {
+            add_tags(t);
+        }
+
+        for (auto t : udt_types)
+        {
+            add_tags(t);
+        }
+
+        // large enough to need fragmented reads
+        config.tags.push_back(to_tag_config("REAL", "REAL_large_array", 2000));
+        config.tags.push_back(to_tag_config("UDTD", "UDTD_large_array", 200));
+
+        return config;
+    }
+
+
+    bool load_config(cstr file_path, SimConfig& config)
+    {
+        /*
+
+        # comment
+        port 44818
+        max_connection_size 4002
+        large_forward_open 1
+        value_change_percent 1
+
+        udt MotorData
+            REAL Speed
+            BOOL Running
+            DINT History[10]
+        end
+
+        DINT Counter
+        MotorData Motors[20]
+
+        */
+
+        auto file = std::fopen(file_path, "r");
+        if (!file)
+        {
+            return false;
+        }
+
+        config.udts.clear();
+        config.tags.clear();
+
+        UdtConfig* udt = nullptr;
+
+        char buffer[256];
+        bool ok = true;
+
+        while (ok && std::fgets(buffer, sizeof(buffer), file))
+        {
+            auto line = trim(buffer);
+
+            if (line.empty() || line[0] == '#')
+            {
+                continue;
+            }
+
+            auto split = line.find_first_of(" \t");
+            auto first = line.substr(0, split);
+            auto second = split == std::string::npos ? std::string() : trim(line.substr(split));
+
+            if (second.find_first_of(" \t") != std::string::npos)
+            {
+                ok = false;
+                break;
+            }
+
+            if (first == "end")
+            {
+                ok = udt && second.empty();
+                udt = nullptr;
+                continue;
+            }
+
+            if (first == "udt")
+            {
+                ok = !udt && !second.empty();
+                config.udts.push_back(UdtConfig{ second, {} });
+                udt = &config.udts.back();
+                continue;
+            }
+
+            if (!udt && parse_setting(first, second, config))
+            {
+                continue;
+            }
+
+            std::string name;
+            u32 array_count = 1;
+
+            if (!parse_declaration_name(second, name, array_count))
+            {
+                ok = false;
+                break;
+            }
+
+            if (udt)
+            {
+                udt->fields.push_back(to_field_config(first.c_str(), name.c_str(), array_count));
+            }
+            else
+            {
+                config.tags.push_back(to_tag_config(first.c_str(), name.c_str(), array_count));
+            }
+        }
+
+        std::fclose(file);
+
+        return ok && !udt && !config.tags.empty();
+    }
+
+
+    bool start(SimConfig const& config)
+    {
+        auto& server = g_server;
+
+        if (server.is_running)
+        {
+            return false;
+        }
+
+        auto& sim = server.sim;
+
+        if (!create_database(config, sim.db))
+        {
+            destroy_database(sim.db);
+            return false;
+        }
+
+        for (auto const& tag : sim.db.tags)
+        {
+            generate_values(tag, sim.gen);
+        }
+
+        sim.max_connection_size = config.max_connection_size;
+        sim.large_forward_open = config.large_forward_open;
+        sim.value_change_percent = config.value_change_percent;
+
+        if (!socket_startup())
+        {
+            destroy_database(sim.db);
+            return false;
+        }
+
+        server.listen_socket = open_listen_socket(config.port);
+        if (server.listen_socket == INVALID_SOCKET_VALUE)
+        {
+            socket_cleanup();
+            destroy_database(sim.db);
+            return false;
+        }
+
+        server.is_running = true;
+        server.accept_thread = std::thread([&server]() { accept_clients(server); });
+
+        return true;
+    }
+
+
+    void stop()
+    {
+        auto& server = g_server;
+
+        if (!server.is_running)
+        {
+            return;
+        }
+
+        server.is_running = false;
+
+        server.accept_thread.join();
+
+        close_socket(server.listen_socket);
+        server.listen_socket = INVALID_SOCKET_VALUE;
+
+        for (auto& t : server.client_threads)
+        {
+            t.join();
+        }
+
+        server.client_threads.clear();
+
+        socket_cleanup();
+        destroy_database(server.sim.db);
+    }
+
+
+    bool is_running()
+    {
+        return g_server.is_running;
+    }
+
+
+    bool set_tag_fault(cstr tag_name, bool is_faulted)
+    {
+        auto& sim = g_server.sim;
+
+        std::lock_guard<std::mutex> guard(sim.lock);
+
+        auto it = sim.db.tag_index.find(to_lower(tag_name));
+        if (!g_server.is_running || it == sim.db.tag_index.end())
+        {
+            return false;
+        }
+
+        sim.db.tags[it->second].is_faulted = is_faulted;
+
+        return true;
+    }
+
+
+    bool set_template_fault(cstr udt_name, bool is_faulted)
+    {
+        auto& sim = g_server.sim;
+
+        std::lock_guard<std::mutex> guard(sim.lock);
+
+        if (!g_server.is_running)
+        {
+            return false;
+        }
+
+        auto name = to_lower(udt_name);
+
+        for (auto& udt : sim.db.udts)
+        {
+            if (to_lower(udt.udt_name) == name)
+            {
+                udt.is_faulted = is_faulted;
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+
+/*
+MIT License
+
+Copyright (c) 2023 Adam Lafontaine
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
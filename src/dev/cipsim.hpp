@@ -0,0 +1,128 @@
+#pragma once
+/* LICENSE: See end of file for license information. */
+
+#include "../util/types.hpp"
+
+#include <vector>
+#include <string>
+
+
+/*
+
+Loopback EtherNet/IP controller simulator.
+
+Listens on a local TCP port and answers the subset of EtherNet/IP and CIP
+that libplctag uses against a ControlLogix: RegisterSession, Forward Open (normal and large),
+Forward Close, Multiple Service Packet, Read Tag, Read Tag Fragmented,
+Write Tag, Write Tag Fragmented, the @tags symbol listing and UDT template reads.
+
+Point plcscan at it with gateway "127.0.0.1:<port>" and any path.
+
+*/
+
+
+/* config */
+
+namespace cipsim
+{
+    template <typename T>
+    using List = std::vector<T>;
+
+
+    class FieldConfig
+    {
+    public:
+        std::string field_name;
+        std::string type_name; // fixed type or UDT name
+
+        u32 array_count = 1;
+    };
+
+
+    class UdtConfig
+    {
+    public:
+        std::string udt_name;
+
+        List<FieldConfig> fields;
+    };
+
+
+    class TagConfig
+    {
+    public:
+        std::string tag_name;
+        std::string type_name; // fixed type or UDT name
+
+        u32 array_count = 1;
+    };
+
+
+    class SimConfig
+    {
+    public:
+        u16 port = 44818;
+
+        // largest connection size granted by Forward Open
+        u32 max_connection_size = 4002;
+
+        // reject Large Forward Open like older controllers
+        bool large_forward_open = true;
+
+        // chance that a read at offset 0 sees new tag values
+        u32 value_change_percent = 1;
+
+        List<UdtConfig> udts;
+        List<TagConfig> tags;
+    };
+}
+
+
+/* api */
+
+namespace cipsim
+{
+    // the same tags and UDTs as the DEVPLCTAG sample database
+    SimConfig default_config();
+
+    // text tag database, see sample_apps/plcscan_cip_sim/sample_tags.txt
+    bool load_config(cstr file_path, SimConfig& config);
+
+    // serves on a background thread until stop()
+    bool start(SimConfig const& config);
+
+    void stop();
+
+    bool is_running();
+
+    // reads of the tag fail until the fault is cleared
+    bool set_tag_fault(cstr tag_name, bool is_faulted);
+
+    // reads of the UDT template fail until the fault is cleared
+    bool set_template_fault(cstr udt_name, bool is_faulted);
+}
+
+
+/*
+MIT License
+
+Copyright (c) 2023 Adam Lafontaine
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
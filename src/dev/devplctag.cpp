@@ -6,7 +6,12 @@
 #include <array>
 #include <random>
 #include <string>
+#include <string_view>
+#include <chrono>
+#include <thread>
 #include <algorithm>
+#include <unordered_map>
+#include <deque>
 
 template <typename T>
 using List = std::vector<T>;
@@ -97,6 +102,16 @@ namespace dev
 
         return sb;
     }
+
+
+    static SymbolType to_udt_field_udt_symbol(u12 udt_id)
+    {
+        SymbolType sb{};
+        sb.udt_id = udt_id;
+        sb.is_struct = 1;
+
+        return sb;
+    }
 }
 
 
@@ -121,6 +136,10 @@ namespace dev
         u32 tag_id = 0;
         SymbolType symbol_type;
         ByteView value_bytes;
+
+        bool is_listing = false;
+
+        std::chrono::steady_clock::time_point ready_time;
     };
 
 
@@ -171,7 +190,7 @@ namespace dev
     }
 
 
-    static TagEntry to_tag_entry(u8 type_code, u8 array_count, cstr name)
+    static TagEntry to_tag_entry(u8 type_code, u32 array_count, cstr name)
     {
         static u32 tag_id = 0;
 
@@ -201,6 +220,10 @@ namespace dev
 
         u16 array_count = 0;
         u16 bit_number = 0;
+
+        // nested UDT
+        u12 udt_id = 0;
+        u16 udt_size = 0;
     };
 
 
@@ -213,22 +236,31 @@ namespace dev
     };
 
 
+    static u16 get_field_size(UdtField const& f)
+    {
+        if (!f.array_count)
+        {
+            assert(f.type_code == TYPE_CODE_BOOL);
+            // TODO: how are BOOL/bits handled
+            return 1;
+        }
+        
+        if (f.udt_id)
+        {
+            return f.udt_size * f.array_count;
+        }
+
+        return get_type_size(f.type_code) * f.array_count;
+    }
+
+
     static u16 get_udt_tag_size(UdtType const& udt)
     {
         u16 size = 0;
 
         for (auto const& f : udt.fields)
         {
-            if (!f.array_count)
-            {
-                assert(f.type_code == TYPE_CODE_BOOL);
-                // TODO: how are BOOL/bits handled
-                size++;
-            }
-            else
-            {
-                size += get_type_size(f.type_code) * f.array_count;
-            }            
+            size += get_field_size(f);
         }
 
         return size;
@@ -417,6 +449,172 @@ namespace dev
 }
 
 
+/* generated tags */
+
+namespace dev
+{
+    constexpr u12 MAX_GENERATED_UDT_ID = TYPE_CODE_BOOL - 1; // see to_udt_entry
+    constexpr u32 MAX_GENERATED_UDT_SIZE = 2048;
+
+    constexpr std::array<u8, 10> GENERATED_FIELD_TYPES = 
+    {
+        TYPE_CODE_SINT, TYPE_CODE_INT, TYPE_CODE_DINT, TYPE_CODE_LINT, 
+        TYPE_CODE_USINT, TYPE_CODE_UINT, TYPE_CODE_UDINT, TYPE_CODE_ULINT, 
+        TYPE_CODE_REAL, TYPE_CODE_LREAL
+    };
+
+    constexpr std::array<u8, 12> GENERATED_TAG_TYPES = 
+    {
+        TYPE_CODE_BOOL, TYPE_CODE_SINT, TYPE_CODE_INT, TYPE_CODE_DINT, TYPE_CODE_LINT, 
+        TYPE_CODE_USINT, TYPE_CODE_UINT, TYPE_CODE_UDINT, TYPE_CODE_ULINT, 
+        TYPE_CODE_REAL, TYPE_CODE_LREAL, TYPE_CODE_CHAR_STRING
+    };
+
+
+    class TagGenerator
+    {
+    public:
+        std::mt19937 rng;
+
+        // names must outlive the tag entries
+        std::deque<std::string> names;
+
+        List<cstr> field_names;
+
+        // nesting level of each udt in udt_types
+        List<u32> udt_depths;
+
+        u32 pick(u32 min, u32 max) { return std::uniform_int_distribution<u32>(min, max)(rng); }
+
+        bool chance(u32 percent) { return pick(1, 100) <= percent; }
+    };
+
+
+    static cstr push_name(TagGenerator& tg, std::string name)
+    {
+        tg.names.push_back(std::move(name));
+
+        return tg.names.back().c_str();
+    }
+
+
+    static cstr get_field_name(TagGenerator& tg, u32 field_id)
+    {
+        while (tg.field_names.size() <= field_id)
+        {
+            auto id = (u32)tg.field_names.size();
+            tg.field_names.push_back(push_name(tg, "Field_" + std::to_string(id)));
+        }
+
+        return tg.field_names[field_id];
+    }
+
+
+    static UdtField to_nested_field(UdtType const& nested, u16 array_count, cstr name)
+    {
+        UdtField field{};
+        field.field_name = name;
+        field.array_count = array_count;
+        field.udt_id = nested.udt_id;
+        field.udt_size = get_udt_tag_size(nested);
+
+        return field;
+    }
+
+
+    static void append_generated_udt_types(DevConfig const& config, TagGenerator& tg, List<UdtType>& udt_types)
+    {
+        tg.udt_depths.assign(udt_types.size(), 1);
+
+        auto max_depth = std::max(config.max_udt_depth, 1u);
+        auto n_base = (u32)udt_types.size();
+
+        auto next_id = (u12)(udt_types.back().udt_id + 1);
+
+        for (u32 i = 0; i < config.n_generated_udts && next_id <= MAX_GENERATED_UDT_ID; ++i, ++next_id)
+        {
+            UdtType udt{};
+            udt.udt_id = next_id;
+            udt.udt_name = push_name(tg, "GenUDT_" + std::to_string(i));
+
+            u32 depth = 1;
+            u32 size = 0;
+
+            auto const add_field = [&](UdtField const& field, u32 field_depth)
+            {
+                udt.fields.push_back(field);
+                size += get_field_size(field);
+                depth = std::max(depth, field_depth + 1);
+            };
+
+            // chains of udts nest the previous one
+            auto prev = (u32)udt_types.size() - 1;
+            if (prev >= n_base && tg.udt_depths[prev] < max_depth)
+            {
+                add_field(to_nested_field(udt_types[prev], 1, get_field_name(tg, 0)), tg.udt_depths[prev]);
+            }
+
+            auto n_fields = tg.pick(2, 8);
+            for (auto f = (u32)udt.fields.size(); f < n_fields; ++f)
+            {
+                auto name = get_field_name(tg, f);
+
+                auto nested_id = tg.pick(0, (u32)udt_types.size() - 1);
+                auto& nested = udt_types[nested_id];
+                auto nested_depth = tg.udt_depths[nested_id];
+
+                auto nested_count = (u16)(tg.chance(75) ? 1 : tg.pick(2, 4));
+                auto nested_size = get_udt_tag_size(nested) * nested_count;
+
+                if (tg.chance(25) && nested_depth < max_depth && size + nested_size <= MAX_GENERATED_UDT_SIZE)
+                {
+                    add_field(to_nested_field(nested, nested_count, name), nested_depth);
+                    continue;
+                }
+
+                auto type_code = GENERATED_FIELD_TYPES[tg.pick(0, (u32)GENERATED_FIELD_TYPES.size() - 1)];
+                auto array_count = (u16)(tg.chance(75) ? 1 : tg.pick(2, std::max(config.max_array_count, 2u)));
+
+                if (size + get_type_size(type_code) * array_count > MAX_GENERATED_UDT_SIZE)
+                {
+                    array_count = 1;
+                }
+
+                add_field({ name, type_code, array_count, 0 }, 0);
+            }
+
+            udt_types.push_back(udt);
+            tg.udt_depths.push_back(depth);
+        }
+    }
+
+
+    static void append_generated_tag_entries(DevConfig const& config, TagGenerator& tg, List<UdtType> const& udt_types, List<TagEntry>& entries)
+    {
+        entries.reserve(entries.size() + config.n_generated_tags);
+
+        auto max_array_count = std::max(config.max_array_count, 2u);
+
+        for (u32 i = 0; i < config.n_generated_tags; ++i)
+        {
+            auto name = push_name(tg, "GenTag_" + std::to_string(i));
+            auto array_count = tg.chance(75) ? 1 : tg.pick(2, max_array_count);
+
+            if (tg.chance(20))
+            {
+                auto& udt = udt_types[tg.pick(0, (u32)udt_types.size() - 1)];
+                entries.push_back(to_udt_entry(udt, array_count, name));
+            }
+            else
+            {
+                auto type_code = GENERATED_TAG_TYPES[tg.pick(0, (u32)GENERATED_TAG_TYPES.size() - 1)];
+                entries.push_back(to_tag_entry(type_code, array_count, name));
+            }
+        }
+    }
+}
+
+
 namespace dev
 {
     class TagValueGenerator
@@ -435,7 +633,7 @@ namespace dev
         TagValueGenerator()
         {
             gen = std::mt19937(rd());
-            new_tag_value_dist = std::uniform_int_distribution<int>(1, 100); // 1% chance of generating a new value
+            new_tag_value_dist = std::uniform_int_distribution<int>(1, 100);
 
             bool_byte_dist = std::uniform_int_distribution<int>(0, 1);
             numeric_byte_dist = std::uniform_int_distribution<int>(0, 255);
@@ -458,25 +656,117 @@ namespace dev
             }
         }
 
-        bool new_tag_value() { return new_tag_value_dist(gen) == 1; }
+        void seed(unsigned value) { gen.seed(value ? value : rd()); }
+
+        bool new_tag_value(unsigned percent) { return new_tag_value_dist(gen) <= (int)percent; }
+    };
+
+
+    class ReadTiming
+    {
+    public:
+        std::mt19937 jitter_gen;
+
+        // the packet currently accepting reads
+        std::chrono::steady_clock::time_point send_time;
+        std::chrono::steady_clock::time_point reply_time;
+        u32 bytes_available = 0;
     };
 
 
     class TagDatabase
     {
     public:
+        DevConfig config;
 
         List<UdtType> udt_types;
         List<TagEntry> tag_entries;
         List<TagValue> tag_values;
 
-        List<int> listing_tag_ids;
+        std::unordered_map<std::string, u32> tag_index;
 
-        ByteBuffer tag_value_data;
+        List<ByteBuffer> value_chunks;
 
+        TagGenerator tag_gen;
         TagValueGenerator gen;
+        ReadTiming timing;
     };
 
+
+    static ByteView push_value_view(TagDatabase& tagdb, u32 n_bytes)
+    {
+        constexpr u32 CHUNK_SIZE = 1024 * 1024;
+
+        auto& chunks = tagdb.value_chunks;
+
+        if (chunks.empty() || chunks.back().capacity_ - chunks.back().size_ < n_bytes)
+        {
+            ByteBuffer chunk{};
+            if (!mb::create_buffer(chunk, std::max(n_bytes, CHUNK_SIZE)))
+            {
+                return ByteView{};
+            }
+
+            chunks.push_back(chunk);
+        }
+
+        return mb::push_view(chunks.back(), n_bytes);
+    }
+
+
+    static std::chrono::steady_clock::time_point schedule_read(TagDatabase& tagdb, u32 n_bytes)
+    {
+        /*
+
+        One packet is in flight at a time. Reads issued before the next packet is sent
+        share it, the same way libplctag packs queued requests into a Multiple Service Packet.
+        A packet is sent batch_window_us after its first read, or when the previous reply arrives.
+        Data larger than a packet takes one round trip per fragment.
+
+        */
+
+        using clock = std::chrono::steady_clock;
+        using us = std::chrono::microseconds;
+
+        // reply header, type and offset in a Multiple Service Packet
+        constexpr u32 REPLY_OVERHEAD = 8;
+
+        auto& config = tagdb.config;
+        auto& timing = tagdb.timing;
+
+        auto now = clock::now();
+
+        if (!config.packet_latency_us && !config.packet_jitter_us && !config.batch_window_us)
+        {
+            return now;
+        }
+
+        auto reply_bytes = n_bytes + REPLY_OVERHEAD;
+
+        if (now < timing.send_time && reply_bytes <= timing.bytes_available)
+        {
+            timing.bytes_available -= reply_bytes;
+            return timing.reply_time;
+        }
+
+        auto packet_size = std::max(config.packet_size, 64u);
+        auto n_packets = (reply_bytes + packet_size - 1) / packet_size;
+
+        std::uniform_int_distribution<u32> jitter(0, config.packet_jitter_us);
+
+        u64 round_trip_us = 0;
+        for (u32 i = 0; i < n_packets; ++i)
+        {
+            round_trip_us += config.packet_latency_us + jitter(timing.jitter_gen);
+        }
+
+        timing.send_time = std::max(now + us(config.batch_window_us), timing.reply_time);
+        timing.reply_time = timing.send_time + us(round_trip_us);
+        timing.bytes_available = n_packets * packet_size - reply_bytes;
+
+        return timing.reply_time;
+    }
+
 }
 
 
@@ -529,28 +819,24 @@ namespace dev
     static int generate_entry_listing_tag_buffer(TagDatabase& tagdb)
     {
         u32 listing_bytes = 0;
-        u32 value_bytes = 0;
-
-        auto& value_data = tagdb.tag_value_data;
 
         for (auto const& entry : tagdb.tag_entries)
         {
             listing_bytes += entry_size(entry);
-
-            value_bytes += listing_bytes;
-            value_bytes += value_size(entry);
-        }
-
-        if (!mb::create_buffer(value_data, value_bytes))
-        {
-            return false;
         }
 
-        tagdb.tag_values.reserve(tagdb.tag_entries.size());
+        tagdb.tag_values.reserve(tagdb.tag_values.size() + tagdb.tag_entries.size() + 1);
 
         TagValue listing_tag{};
         listing_tag.tag_id = (u32)tagdb.tag_values.size();
-        listing_tag.value_bytes = mb::push_view(value_data, listing_bytes);
+        listing_tag.is_listing = true;
+        listing_tag.value_bytes = push_value_view(tagdb, listing_bytes);
+
+        if (!listing_tag.value_bytes.data)
+        {
+            return -1;
+        }
+
         tagdb.tag_values.push_back(listing_tag);
 
         int offset = 0;
@@ -559,11 +845,7 @@ namespace dev
             offset = push_tag_listing(entry, listing_tag.value_bytes, offset);
         }
 
-        auto handle = (int)listing_tag.tag_id;
-
-        tagdb.listing_tag_ids.push_back(handle);
-
-        return handle;
+        return (int)listing_tag.tag_id;
     }
 
 
@@ -641,7 +923,7 @@ namespace dev
         for (auto const& f : udt.fields)
         {
             u32 field_size = 0;
-            auto type = to_udt_field_symbol(f.type_code);
+            auto type = f.udt_id ? to_udt_field_udt_symbol(f.udt_id) : to_udt_field_symbol(f.type_code);
             if (f.type_code == TYPE_CODE_BOOL)
             {
                 set16(f.bit_number); // metadata
@@ -650,7 +932,7 @@ namespace dev
             else
             {
                 set16(f.array_count); // metadata
-                field_size = get_type_size(f.type_code) * f.array_count;
+                field_size = (f.udt_id ? f.udt_size : get_type_size(f.type_code)) * f.array_count;
                 if (f.array_count > 1)
                 {
                     type.field_is_array = 1;
@@ -714,20 +996,23 @@ namespace dev
         TagValue listing_tag{};
 
         listing_tag.tag_id = (u32)tagdb.tag_values.size();
-        listing_tag.symbol_type = to_udt_symbol(udt_id);        
+        listing_tag.symbol_type = to_udt_symbol(udt_id);
+        listing_tag.is_listing = true;
 
         auto listing_size = get_udt_listing_size(udt);
 
-        listing_tag.value_bytes = mb::push_view(tagdb.tag_value_data, listing_size);
-        tagdb.tag_values.push_back(listing_tag);
+        listing_tag.value_bytes = push_value_view(tagdb, listing_size);
 
-        push_udt_listing(udt, listing_tag.value_bytes);
+        if (!listing_tag.value_bytes.data)
+        {
+            return -1;
+        }
 
-        auto handle = (int)listing_tag.tag_id;
+        tagdb.tag_values.push_back(listing_tag);
 
-        tagdb.listing_tag_ids.push_back(handle);
+        push_udt_listing(udt, listing_tag.value_bytes);
 
-        return handle;
+        return (int)listing_tag.tag_id;
     }
 
 
@@ -737,7 +1022,12 @@ namespace dev
 
         tag.tag_id = (u32)tagdb.tag_values.size();
         tag.symbol_type = entry.symbol_type;
-        tag.value_bytes = mb::push_view(tagdb.tag_value_data, value_size(entry));
+        tag.value_bytes = push_value_view(tagdb, value_size(entry));
+
+        if (!tag.value_bytes.data)
+        {
+            return -1;
+        }
 
         // initial value
         for (u32 i = 0; i < tag.value_bytes.length; ++i)
@@ -759,38 +1049,53 @@ static dev::TagDatabase g_tag_db{};
 
 namespace dev
 {
-    int plc_tag_create(const char* attr, int timeout)
+    static TagEntry const* find_tag_entry(TagDatabase& tagdb, std::string const& name)
     {
-        auto& tagdb = g_tag_db;
-
-        int handle = -1;
-
-        if (tagdb.tag_entries.empty())
+        auto it = tagdb.tag_index.find(name);
+        if (it == tagdb.tag_index.end())
         {
-            tagdb.udt_types = create_udt_types();
-            tagdb.tag_entries = create_tag_entries();
-            append_udt_entries(tagdb.udt_types, tagdb.tag_entries);
+            return nullptr;
         }
 
-        std::string str(attr);
+        return &tagdb.tag_entries[it->second];
+    }
 
-        auto not_found = std::string::npos;
 
-        auto pos = str.find("name=");
-        if (pos == not_found)
+    static void create_tag_database(TagDatabase& tagdb)
+    {
+        auto& config = tagdb.config;
+
+        tagdb.tag_gen.rng.seed(config.seed ? config.seed : std::random_device{}());
+        tagdb.timing.jitter_gen.seed(config.seed ? config.seed : std::random_device{}());
+        tagdb.gen.seed(config.seed);
+
+        tagdb.udt_types = create_udt_types();
+        tagdb.tag_entries = create_tag_entries();
+        append_udt_entries(tagdb.udt_types, tagdb.tag_entries);
+
+        append_generated_udt_types(config, tagdb.tag_gen, tagdb.udt_types);
+        append_generated_tag_entries(config, tagdb.tag_gen, tagdb.udt_types, tagdb.tag_entries);
+
+        tagdb.tag_index.reserve(tagdb.tag_entries.size());
+        for (u32 i = 0; i < (u32)tagdb.tag_entries.size(); ++i)
         {
-            return -1;
+            tagdb.tag_index[tagdb.tag_entries[i].tag_name] = i;
         }
+    }
 
-        pos += strlen("name=");
 
-        auto pos2 = str.find('&', pos);
-        if (pos2 == not_found)
+    static int create_tag_by_name(std::string const& name)
+    {
+        auto& tagdb = g_tag_db;
+
+        int handle = -1;
+
+        if (tagdb.tag_entries.empty())
         {
-            return -1;
+            create_tag_database(tagdb);
         }
 
-        auto name = str.substr(pos, (pos2 - pos));
+        auto not_found = std::string::npos;
 
         if (name == "@tags")
         {
@@ -814,18 +1119,13 @@ namespace dev
             return handle;
         }
 
-        auto begin = tagdb.tag_entries.begin();
-        auto end = tagdb.tag_entries.end();
-
-        auto it = std::find_if(begin, end, [&name](auto& e) { return name == e.tag_name; });
-        if (it == end)
+        auto entry = find_tag_entry(tagdb, name);
+        if (!entry)
         {
             return -1;
         }
 
-        auto& entry = *it;
-
-        handle = generate_tag_value_buffer(tagdb, entry);
+        handle = generate_tag_value_buffer(tagdb, *entry);
 
         if (handle < 0)
         {
@@ -836,8 +1136,130 @@ namespace dev
     }
 
 
+    void set_config(DevConfig const& config)
+    {
+        g_tag_db.config = config;
+    }
+
+
+    int plc_tag_create(const char* attr, int timeout)
+    {
+        std::string str(attr);
+
+        auto not_found = std::string::npos;
+
+        auto pos = str.find("name=");
+        if (pos == not_found)
+        {
+            return -1;
+        }
+
+        pos += strlen("name=");
+
+        auto pos2 = str.find('&', pos);
+        if (pos2 == not_found)
+        {
+            return -1;
+        }
+
+        return create_tag_by_name(str.substr(pos, (pos2 - pos)));
+    }
+
+
+    class plc_tag_conn_t
+    {
+    public:
+        std::string attr;
+    };
+
+
+    int plc_tag_conn_create(const char* attr, plc_tag_conn_p* conn)
+    {
+        if (!attr || !conn)
+        {
+            return -1;
+        }
+
+        *conn = new plc_tag_conn_t{ attr };
+
+        return PLCTAG_STATUS_OK;
+    }
+
+
+    int plc_tag_create_in_conn(plc_tag_conn_p conn, const char* name, int elem_size, int elem_count, int timeout)
+    {
+        if (!conn || !name)
+        {
+            return -1;
+        }
+
+        std::string str(name);
+
+        auto pos = str.find_first_of(".[");
+        if (pos == std::string::npos || str[0] == '@')
+        {
+            return create_tag_by_name(str);
+        }
+
+        // member or array slice, random bytes of the requested size
+        auto& tagdb = g_tag_db;
+
+        auto entry = find_tag_entry(tagdb, str.substr(0, pos));
+        if (!entry || elem_size <= 0 || elem_count <= 0)
+        {
+            return -1;
+        }
+
+        TagValue tag{};
+        tag.tag_id = (u32)tagdb.tag_values.size();
+        tag.symbol_type = entry->symbol_type;
+        tag.value_bytes = push_value_view(tagdb, (u32)(elem_size * elem_count));
+
+        if (!tag.value_bytes.data)
+        {
+            return -1;
+        }
+
+        tagdb.tag_values.push_back(tag);
+
+        return (int)tag.tag_id;
+    }
+
+
+    void plc_tag_conn_destroy(plc_tag_conn_p conn)
+    {
+        delete conn;
+    }
+
+
+    int plc_tag_conn_reconnect(plc_tag_conn_p conn)
+    {
+        // no session to lose
+        return conn ? PLCTAG_STATUS_OK : -1;
+    }
+
+
+    int plc_tag_destroy(int handle)
+    {
+        auto& tags = g_tag_db.tag_values;
+
+        if (handle < 0 || (u64)handle >= tags.size())
+        {
+            return -1;
+        }
+
+        // handles are indexes, the slot is not reused
+        tags[handle].value_bytes = {};
+        tags[handle].is_listing = false;
+
+        return PLCTAG_STATUS_OK;
+    }
+
+
     int plc_tag_read(int handle, int timeout)
     {
+        using clock = std::chrono::steady_clock;
+
         auto& tags = g_tag_db.tag_values;
         auto& gen = g_tag_db.gen;
 
@@ -846,33 +1268,59 @@ namespace dev
             return -1;
         }
 
-        auto begin = g_tag_db.listing_tag_ids.begin();
-        auto end = g_tag_db.listing_tag_ids.end();
-
-        auto is_listing_tag = std::find(begin, end, handle) != end;
+        auto& tag = tags[handle];
         
-        if (is_listing_tag)
+        if (tag.is_listing)
         {
             return PLCTAG_STATUS_OK;
         }
 
-        if (!gen.new_tag_value())
+        tag.ready_time = schedule_read(g_tag_db, tag.value_bytes.length);
+
+        if (gen.new_tag_value(g_tag_db.config.value_change_percent))
         {
-            return PLCTAG_STATUS_OK;
-        }        
+            auto& bytes = tag.value_bytes;
 
-        auto& tag = tags[handle];
-        auto& bytes = tag.value_bytes;
+            for (u32 i = 0; i < bytes.length; ++i)
+            {
+                bytes.data[i] = gen.generate_byte(tag.symbol_type);
+            }
+        }
 
-        for (u32 i = 0; i < bytes.length; ++i)
+        if (timeout == 0)
         {
-            bytes.data[i] = gen.generate_byte(tag.symbol_type);
+            return clock::now() < tag.ready_time ? PLCTAG_STATUS_PENDING : PLCTAG_STATUS_OK;
         }
 
+        auto timeout_time = clock::now() + std::chrono::milliseconds(timeout);
+
+        if (tag.ready_time > timeout_time)
+        {
+            std::this_thread::sleep_until(timeout_time);
+            return PLCTAG_ERR_TIMEOUT;
+        }
+
+        std::this_thread::sleep_until(tag.ready_time);
+
         return PLCTAG_STATUS_OK;
     }
 
 
+    int plc_tag_status(int handle)
+    {
+        auto& tags = g_tag_db.tag_values;
+
+        if (handle < 0 || (u64)handle >= tags.size())
+        {
+            return -1;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+
+        return now < tags[handle].ready_time ? PLCTAG_STATUS_PENDING : PLCTAG_STATUS_OK;
+    }
+
+
     int plc_tag_get_size(int handle)
     {
         auto& tags = g_tag_db.tag_values;
@@ -899,9 +1347,16 @@ namespace dev
 
         auto& value = tags[handle].value_bytes;
 
-        auto len = (u32)length < value.length ? (u32)length : value.length;
+        if (offset < 0 || (u32)offset > value.length)
+        {
+            return -1;
+        }
+
+        auto n_left = value.length - (u32)offset;
 
-        auto src = value.data;
+        auto len = (u32)length < n_left ? (u32)length : n_left;
+
+        auto src = value.data + offset;
 
         mh::copy_bytes(src, dst, len);
 
@@ -909,9 +1364,120 @@ namespace dev
     }
 
 
+    int plc_tag_write(int handle, int timeout)
+    {
+        using clock = std::chrono::steady_clock;
+
+        auto& tags = g_tag_db.tag_values;
+
+        if (handle < 0 || (u64)handle >= tags.size())
+        {
+            return -1;
+        }
+
+        auto& tag = tags[handle];
+
+        if (tag.is_listing)
+        {
+            return PLCTAG_ERR_BAD_DATA;
+        }
+
+        // the value travels in the request instead of the reply
+        tag.ready_time = schedule_read(g_tag_db, tag.value_bytes.length);
+
+        if (timeout == 0)
+        {
+            return clock::now() < tag.ready_time ? PLCTAG_STATUS_PENDING : PLCTAG_STATUS_OK;
+        }
+
+        auto timeout_time = clock::now() + std::chrono::milliseconds(timeout);
+
+        if (tag.ready_time > timeout_time)
+        {
+            std::this_thread::sleep_until(timeout_time);
+            return PLCTAG_ERR_TIMEOUT;
+        }
+
+        std::this_thread::sleep_until(tag.ready_time);
+
+        return PLCTAG_STATUS_OK;
+    }
+
+
+    int plc_tag_abort(int handle)
+    {
+        auto& tags = g_tag_db.tag_values;
+
+        if (handle < 0 || (u64)handle >= tags.size())
+        {
+            return -1;
+        }
+
+        // the pending request is dropped
+        tags[handle].ready_time = std::chrono::steady_clock::now();
+
+        return PLCTAG_STATUS_OK;
+    }
+
+
+    int plc_tag_set_raw_bytes(int handle, int offset, unsigned char* src, int length)
+    {
+        auto& tags = g_tag_db.tag_values;
+
+        if (handle < 0 || (u64)handle >= tags.size())
+        {
+            return -1;
+        }
+
+        auto& value = tags[handle].value_bytes;
+
+        if (offset < 0 || length < 0 || (u32)offset + (u32)length > value.length)
+        {
+            return -1;
+        }
+
+        mh::copy_bytes(src, value.data + offset, (u32)length);
+
+        return PLCTAG_STATUS_OK;
+    }
+
+
+    int plc_tag_get_int_attribute(int handle, const char* attrib_name, int default_value)
+    {
+        auto& tags = g_tag_db.tag_values;
+
+        if (handle < 0 || (u64)handle >= tags.size())
+        {
+            return default_value;
+        }
+
+        // reads finish in plc_tag_read(), every byte has arrived
+        if (std::string_view(attrib_name) == "bytes_received")
+        {
+            return (int)tags[handle].value_bytes.length;
+        }
+
+        return default_value;
+    }
+
+
     void plc_tag_shutdown()
     {
-        mb::destroy_buffer(g_tag_db.tag_value_data);
+        auto& tagdb = g_tag_db;
+
+        for (auto& chunk : tagdb.value_chunks)
+        {
+            mb::destroy_buffer(chunk);
+        }
+
+        tagdb.value_chunks.clear();
+        tagdb.tag_values.clear();
+        tagdb.tag_index.clear();
+        tagdb.tag_entries.clear();
+        tagdb.udt_types.clear();
+
+        tagdb.tag_gen.names.clear();
+        tagdb.tag_gen.field_names.clear();
     }
 }
 
@@ -4,14 +4,70 @@
 namespace dev
 {
     constexpr int PLCTAG_STATUS_OK = 0;
+    constexpr int PLCTAG_STATUS_PENDING = 1;
+    constexpr int PLCTAG_ERR_BAD_DATA = -4;
+    constexpr int PLCTAG_ERR_TIMEOUT = -32;
+
+
+    class DevConfig
+    {
+    public:
+        // 0 seeds from std::random_device
+        unsigned seed = 0;
+
+        // generated in addition to the sample tags
+        unsigned n_generated_tags = 0;
+        unsigned n_generated_udts = 0;
+        unsigned max_udt_depth = 4;
+        unsigned max_array_count = 16;
+
+        // chance that a read sees new tag values
+        unsigned value_change_percent = 1;
+
+        // read timing, all zero answers instantly
+        unsigned packet_latency_us = 0;
+        unsigned packet_jitter_us = 0;
+        unsigned packet_size = 4002;
+
+        // reads issued this long after a packet opens share it
+        unsigned batch_window_us = 0;
+    };
+
+
+    // call before the first tag is created
+    void set_config(DevConfig const& config);
 
     int plc_tag_create(const char* attr, int timeout);
 
+    class plc_tag_conn_t;
+
+    using plc_tag_conn_p = plc_tag_conn_t*;
+
+    int plc_tag_conn_create(const char* attr, plc_tag_conn_p* conn);
+
+    int plc_tag_create_in_conn(plc_tag_conn_p conn, const char* name, int elem_size, int elem_count, int timeout);
+
+    void plc_tag_conn_destroy(plc_tag_conn_p conn);
+
+    int plc_tag_conn_reconnect(plc_tag_conn_p conn);
+
+    int plc_tag_destroy(int handle);
+
     int plc_tag_read(int handle, int timeout);
 
+    int plc_tag_status(int handle);
+
     int plc_tag_get_size(int handle);
 
     int plc_tag_get_raw_bytes(int handle, int offset, unsigned char* dst, int length);
 
+    int plc_tag_write(int handle, int timeout);
+
+    int plc_tag_abort(int handle);
+
+    int plc_tag_set_raw_bytes(int handle, int offset, unsigned char* src, int length);
+
+    int plc_tag_get_int_attribute(int handle, const char* attrib_name, int default_value);
+
     void plc_tag_shutdown();
-}
\ No newline at end of file
+}
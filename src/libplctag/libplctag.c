@@ -75,6 +75,18 @@ static cond_p tag_tickler_wait = NULL;
 #define TAG_TICKLER_TIMEOUT_MIN_MS (10)
 static int64_t tag_tickler_wait_timeout_end = 0;
 
+/* reusable connection descriptors, see plc_tag_conn_create() */
+struct plc_tag_conn_t {
+    struct plc_tag_conn_t *next;
+    attr attribs;
+    tag_create_function tag_constructor;
+    lock_t lock;
+    ab_session_p session;
+};
+
+static plc_tag_conn_p conn_list = NULL;
+static lock_t conn_list_lock = LOCK_INIT;
+
 //static mutex_p global_library_mutex = NULL;
 
 
@@ -85,6 +97,9 @@ static int add_tag_lookup(plc_tag_p tag);
 static int tag_id_inc(int id);
 static THREAD_FUNC(tag_tickler_func);
 static int set_tag_byte_order(plc_tag_p tag, attr attribs);
+static int32_t create_tag_finish(plc_tag_p tag, attr attribs, int timeout);
+static void release_conn_sessions(void);
+static void tag_finish_operations(plc_tag_p tag);
 static int check_byte_order_str(const char *byte_order, int length);
 // static int get_string_count_size_unsafe(plc_tag_p tag, int offset);
 static int get_string_length_unsafe(plc_tag_p tag, int offset);
@@ -504,6 +519,38 @@ int plc_tag_generic_init_tag(plc_tag_p tag, attr attribs, void (*tag_callback_fu
 
 
 
+/*
+ * Clear the in flight flags of operations the tag tickler reported complete.
+ * Must be called with the tag API mutex held.
+ */
+static void tag_finish_operations(plc_tag_p tag)
+{
+    if(tag->read_complete) {
+        tag->read_complete = 0;
+        tag->read_in_flight = 0;
+
+        //tag->event_read_complete = 1;
+        tag_raise_event(tag, PLCTAG_EVENT_READ_COMPLETED, tag->status);
+
+        /* wake immediately */
+        plc_tag_tickler_wake();
+        cond_signal(tag->tag_cond_wait);
+    }
+
+    if(tag->write_complete) {
+        tag->write_complete = 0;
+        tag->write_in_flight = 0;
+        tag->auto_sync_next_write = 0;
+
+        // tag->event_write_complete = 1;
+        tag_raise_event(tag, PLCTAG_EVENT_WRITE_COMPLETED, tag->status);
+
+        /* wake immediately */
+        plc_tag_tickler_wake();
+        cond_signal(tag->tag_cond_wait);
+    }
+}
+
 
 
 THREAD_FUNC(tag_tickler_func)
@@ -560,30 +607,7 @@ THREAD_FUNC(tag_tickler_func)
                             /* call the tickler on the tag. */
                             tag->vtable->tickler(tag);
 
-                            if(tag->read_complete) {
-                                tag->read_complete = 0;
-                                tag->read_in_flight = 0;
-
-                                //tag->event_read_complete = 1;
-                                tag_raise_event(tag, PLCTAG_EVENT_READ_COMPLETED, tag->status);
-
-                                /* wake immediately */
-                                plc_tag_tickler_wake();
-                                cond_signal(tag->tag_cond_wait);
-                            }
-
-                            if(tag->write_complete) {
-                                tag->write_complete = 0;
-                                tag->write_in_flight = 0;
-                                tag->auto_sync_next_write = 0;
-
-                                // tag->event_write_complete = 1;
-                                tag_raise_event(tag, PLCTAG_EVENT_WRITE_COMPLETED, tag->status);
-
-                                /* wake immediately */
-                                plc_tag_tickler_wake();
-                                cond_signal(tag->tag_cond_wait);
-                            }
+                            tag_finish_operations(tag);
                         }
 
                         /* wake up earlier if the time until the next write wake up is sooner. */
@@ -782,6 +806,21 @@ LIB_EXPORT void plc_tag_set_debug_level(int debug_level)
 
 
 
+/*
+ * Enable or disable asynchronous debug output.
+ *
+ * Messages are queued in a lock-free ring and written by a background
+ * thread so that logging does not stall the session and tickler threads.
+ */
+
+LIB_EXPORT int plc_tag_set_debug_async(int enable)
+{
+    return debug_set_async(enable);
+}
+
+
+
+
 /*
  * Check that the library supports the required API version.
  *
@@ -827,10 +866,8 @@ LIB_EXPORT int32_t plc_tag_create(const char *attrib_str, int timeout)
 LIB_EXPORT int32_t plc_tag_create_ex(const char *attrib_str, void (*tag_callback_func)(int32_t tag_id, int event, int status, void *userdata), void *userdata, int timeout)
 {
     plc_tag_p tag = PLC_TAG_P_NULL;
-    int id = PLCTAG_ERR_OUT_OF_BOUNDS;
     attr attribs = NULL;
     int rc = PLCTAG_STATUS_OK;
-    int read_cache_ms = 0;
     tag_create_function tag_constructor;
 	int debug_level = -1;
 
@@ -891,6 +928,332 @@ LIB_EXPORT int32_t plc_tag_create_ex(const char *attrib_str, void (*tag_callback
 
     tag = tag_constructor(attribs, tag_callback_func, userdata);
 
+    return create_tag_finish(tag, attribs, timeout);
+}
+
+
+
+/*
+ * plc_tag_conn_create
+ *
+ * Parse a connection attribute string once and keep the result for
+ * creating many tags against the same PLC.  Tags created from the
+ * descriptor share the parsed attributes, the protocol constructor and,
+ * for AB tags, the resolved session.
+ */
+
+LIB_EXPORT int plc_tag_conn_create(const char *attrib_str, plc_tag_conn_p *conn)
+{
+    plc_tag_conn_p new_conn = NULL;
+    attr attribs = NULL;
+    tag_create_function tag_constructor;
+    int debug_level = -1;
+    int rc = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(!conn) {
+        pdebug(DEBUG_WARN, "Connection pointer is null!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    *conn = NULL;
+
+    if(atomic_get(&library_terminating)) {
+        pdebug(DEBUG_WARN, "The plctag library is in the process of shutting down!");
+        return PLCTAG_ERR_NOT_ALLOWED;
+    }
+
+    if((rc = initialize_modules()) != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR,"Unable to initialize the internal library state!");
+        return rc;
+    }
+
+    if(!attrib_str || str_length(attrib_str) == 0) {
+        pdebug(DEBUG_WARN,"Connection attribute string is null or zero length!");
+        return PLCTAG_ERR_TOO_SMALL;
+    }
+
+    attribs = attr_create_from_str(attrib_str);
+    if(!attribs) {
+        pdebug(DEBUG_WARN,"Unable to parse attribute string!");
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    debug_level = attr_get_int(attribs, "debug", -1);
+    if (debug_level > DEBUG_NONE) {
+        set_debug_level(debug_level);
+    }
+
+    tag_constructor = find_tag_create_func(attribs);
+    if(!tag_constructor) {
+        pdebug(DEBUG_WARN,"No tag constructor found for connection attributes!");
+        attr_destroy(attribs);
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    new_conn = (plc_tag_conn_p)mem_alloc((int)sizeof(struct plc_tag_conn_t));
+    if(!new_conn) {
+        pdebug(DEBUG_ERROR, "Unable to allocate connection descriptor!");
+        attr_destroy(attribs);
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    new_conn->attribs = attribs;
+    new_conn->tag_constructor = tag_constructor;
+    new_conn->session = AB_SESSION_NULL;
+    new_conn->lock = LOCK_INIT;
+
+    spin_block(&conn_list_lock) {
+        new_conn->next = conn_list;
+        conn_list = new_conn;
+    }
+
+    *conn = new_conn;
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+/*
+ * plc_tag_create_in_conn
+ *
+ * Create a tag using a connection descriptor from plc_tag_conn_create().
+ * Only the tag name and sizes are per-tag.  elem_size and elem_count are
+ * ignored when zero or less.
+ *
+ * The first AB tag created resolves the session and the descriptor keeps
+ * it.  Later tags reuse it directly without the gateway/path lookup.
+ *
+ * Returns the tag handle or a PLCTAG_ERR_xyz error as plc_tag_create().
+ */
+
+LIB_EXPORT int32_t plc_tag_create_in_conn(plc_tag_conn_p conn, const char *name, int elem_size, int elem_count, int timeout)
+{
+    plc_tag_p tag = PLC_TAG_P_NULL;
+    attr attribs = NULL;
+    ab_session_p session = AB_SESSION_NULL;
+
+    debug_set_tag_id(0);
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(atomic_get(&library_terminating)) {
+        pdebug(DEBUG_WARN, "The plctag library is in the process of shutting down!");
+        return PLCTAG_ERR_NOT_ALLOWED;
+    }
+
+    if(!conn) {
+        pdebug(DEBUG_WARN, "Connection descriptor is null!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    if(timeout < 0) {
+        pdebug(DEBUG_WARN, "Timeout must not be negative!");
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    if(!name || str_length(name) == 0) {
+        pdebug(DEBUG_WARN, "Tag name is null or zero length!");
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    /* the constructors modify their attributes so each tag gets a copy. */
+    attribs = attr_dup(conn->attribs);
+    if(!attribs) {
+        pdebug(DEBUG_WARN, "Unable to copy connection attributes!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    if(attr_set_str(attribs, "name", name)
+       || (elem_size > 0 && attr_set_int(attribs, "elem_size", elem_size))
+       || (elem_count > 0 && attr_set_int(attribs, "elem_count", elem_count))) {
+        pdebug(DEBUG_WARN, "Unable to set tag attributes!");
+        attr_destroy(attribs);
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    if(conn->tag_constructor == ab_tag_create) {
+        spin_block(&conn->lock) {
+            if(conn->session) {
+                session = (ab_session_p)rc_inc(conn->session);
+            }
+        }
+
+        tag = ab_tag_create_in_session(attribs, session, NULL, NULL);
+
+        if(session) {
+            rc_dec(session);
+        } else if(tag && ((ab_tag_p)tag)->session) {
+            /* first tag found the session, keep it for the rest. */
+            spin_block(&conn->lock) {
+                if(!conn->session) {
+                    conn->session = (ab_session_p)rc_inc(((ab_tag_p)tag)->session);
+                }
+            }
+        }
+    } else {
+        tag = conn->tag_constructor(attribs, NULL, NULL);
+    }
+
+    return create_tag_finish(tag, attribs, timeout);
+}
+
+
+
+/*
+ * plc_tag_conn_destroy
+ *
+ * Release a connection descriptor.  Tags created from it are not affected.
+ */
+
+LIB_EXPORT void plc_tag_conn_destroy(plc_tag_conn_p conn)
+{
+    plc_tag_conn_p *walker = NULL;
+    ab_session_p session = AB_SESSION_NULL;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(!conn) {
+        return;
+    }
+
+    spin_block(&conn_list_lock) {
+        for(walker = &conn_list; *walker; walker = &(*walker)->next) {
+            if(*walker == conn) {
+                *walker = conn->next;
+                break;
+            }
+        }
+    }
+
+    /* a tag being created from the descriptor may be setting the session. */
+    spin_block(&conn->lock) {
+        session = conn->session;
+        conn->session = AB_SESSION_NULL;
+    }
+
+    if(session) {
+        rc_dec(session);
+    }
+
+    attr_destroy(conn->attribs);
+    mem_free(conn);
+
+    pdebug(DEBUG_INFO, "Done.");
+}
+
+
+
+/*
+ * plc_tag_conn_get_stats
+ *
+ * Copy the wire statistics of the session the descriptor resolved.
+ */
+
+LIB_EXPORT int plc_tag_conn_get_stats(plc_tag_conn_p conn, plc_tag_session_stats_t *stats)
+{
+    ab_session_p session = AB_SESSION_NULL;
+    int rc = PLCTAG_STATUS_OK;
+
+    if(!conn || !stats) {
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    mem_set(stats, 0, (int)sizeof(*stats));
+
+    spin_block(&conn->lock) {
+        if(conn->session) {
+            session = (ab_session_p)rc_inc(conn->session);
+        }
+    }
+
+    if(!session) {
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = session_get_stats(session, stats);
+
+    rc_dec(session);
+
+    return rc;
+}
+
+
+
+/*
+ * plc_tag_conn_reconnect
+ *
+ * Drop the session behind the descriptor and connect again right away.
+ */
+
+LIB_EXPORT int plc_tag_conn_reconnect(plc_tag_conn_p conn)
+{
+    ab_session_p session = AB_SESSION_NULL;
+
+    if(!conn) {
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    spin_block(&conn->lock) {
+        if(conn->session) {
+            session = (ab_session_p)rc_inc(conn->session);
+        }
+    }
+
+    if(!session) {
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    session_request_reconnect(session);
+
+    rc_dec(session);
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+/*
+ * release_conn_sessions
+ *
+ * Sessions cannot terminate while a descriptor holds them.  Called from
+ * plc_tag_shutdown() so that forgotten descriptors do not block teardown.
+ */
+
+void release_conn_sessions(void)
+{
+    spin_block(&conn_list_lock) {
+        for(plc_tag_conn_p conn = conn_list; conn; conn = conn->next) {
+            spin_block(&conn->lock) {
+                if(conn->session) {
+                    rc_dec(conn->session);
+                    conn->session = AB_SESSION_NULL;
+                }
+            }
+        }
+    }
+}
+
+
+
+/*
+ * create_tag_finish
+ *
+ * Common tail of tag creation once the protocol constructor has run.  Sets
+ * up the generic tag options, maps the tag to an ID and optionally waits for
+ * creation to complete.  Takes ownership of the attributes.
+ */
+
+int32_t create_tag_finish(plc_tag_p tag, attr attribs, int timeout)
+{
+    int id = PLCTAG_ERR_OUT_OF_BOUNDS;
+    int rc = PLCTAG_STATUS_OK;
+    int read_cache_ms = 0;
+
     if(!tag) {
         pdebug(DEBUG_WARN, "Tag creation failed, skipping mutex creation and other generic setup.");
         attr_destroy(attribs);
@@ -1134,6 +1497,8 @@ LIB_EXPORT void plc_tag_shutdown(void)
 
     pdebug(DEBUG_DETAIL, "All tags closed.");
 
+    release_conn_sessions();
+
     pdebug(DEBUG_DETAIL, "Cleaning up library resources.");
 
     destroy_modules();
@@ -1776,6 +2141,9 @@ LIB_EXPORT int plc_tag_status(int32_t id)
     critical_block(tag->api_mutex) {
         if(tag && tag->vtable->tickler) {
             tag->vtable->tickler(tag);
+
+            /* do not leave a finished operation in flight until the tickler thread comes around. */
+            tag_finish_operations(tag);
         }
 
         rc = tag->vtable->status(tag);
@@ -1787,6 +2155,8 @@ LIB_EXPORT int plc_tag_status(int32_t id)
         }
     }
 
+    plc_tag_generic_handle_event_callbacks(tag);
+
     rc_dec(tag);
 
     pdebug(DEBUG_SPEW, "Done with rc=%s.", plc_tag_decode_error(rc));
@@ -4562,6 +4932,9 @@ void destroy_modules(void)
         }
     }
 
+    /* flush queued debug output while the logger is still registered. */
+    debug_set_async(0);
+
     plc_tag_unregister_logger();
 
     library_initialized = 0;
@@ -4907,6 +5280,59 @@ extern attr attr_create_from_str(const char* attr_str)
 
 
 
+/*
+ * attr_dup
+ *
+ * Make a deep copy of an attribute list.  This is much cheaper than
+ * re-parsing the original string and keeps the entry order.
+ */
+extern attr attr_dup(attr attrs)
+{
+    attr res = NULL;
+    attr_entry *tail = NULL;
+
+    if (!attrs) {
+        return NULL;
+    }
+
+    res = attr_create();
+    if (!res) {
+        pdebug(DEBUG_ERROR, "Unable to allocate memory for attribute list!");
+        return NULL;
+    }
+
+    tail = &res->head;
+
+    for (attr_entry e = attrs->head; e; e = e->next) {
+        attr_entry copy = (attr_entry)mem_alloc(sizeof(struct attr_entry_t));
+
+        if (!copy) {
+            pdebug(DEBUG_ERROR, "Unable to allocate memory for attribute entry!");
+            attr_destroy(res);
+            return NULL;
+        }
+
+        /* link it first so that attr_destroy() cleans up a partial entry. */
+        *tail = copy;
+        tail = &copy->next;
+
+        copy->name = str_dup(e->name);
+        copy->val = str_dup(e->val);
+
+        if (!copy->name || !copy->val) {
+            pdebug(DEBUG_ERROR, "Unable to copy attribute entry \"%s\"!", e->name);
+            attr_destroy(res);
+            return NULL;
+        }
+    }
+
+    return res;
+}
+
+
+
+
+
 /*
  * attr_set
  *
@@ -5180,6 +5606,51 @@ static THREAD_LOCAL uint32_t this_thread_num = 0;
 static THREAD_LOCAL int32_t tag_id = 0;
 
 
+/*
+ * Asynchronous logging.
+ *
+ * When enabled, pdebug_impl() only formats the message body into a slot of a
+ * fixed size ring and returns.  The timestamp prefix, the logger callback and
+ * the write to stderr are all done by a background thread.  The ring is a
+ * bounded multi-producer/single-consumer queue.  Each slot carries a sequence
+ * number that tells producers and the consumer whose turn it is, so the hot
+ * path never takes a lock.  A record is published with a release store of its
+ * sequence number and read after an acquire load of it.  If the ring is full
+ * the record is dropped and counted rather than blocking the caller.
+ */
+
+#define DEBUG_ASYNC_RING_SIZE (1024) /* MAGIC, must be a power of two */
+#define DEBUG_ASYNC_RING_MASK (DEBUG_ASYNC_RING_SIZE - 1)
+#define DEBUG_ASYNC_MSG_SIZE (256) /* MAGIC */
+#define DEBUG_ASYNC_IDLE_MS (10) /* MAGIC */
+
+typedef struct {
+    lock_t seq;
+    int debug_level;
+    int32_t tag_id;
+    uint32_t thread_id;
+    int line_num;
+    const char *func;
+    int64_t epoch_ms;
+    char msg[DEBUG_ASYNC_MSG_SIZE];
+} debug_record_t;
+
+static debug_record_t debug_ring[DEBUG_ASYNC_RING_SIZE];
+static lock_t debug_ring_head = 0;
+static int debug_ring_tail = 0; /* only touched by the logging thread */
+static lock_t debug_ring_dropped = 0;
+
+static lock_t debug_async_enabled = 0;
+static lock_t debug_async_terminating = 0;
+static lock_t debug_async_producers = 0; /* callers between the enabled check and the publish */
+static lock_t debug_async_lock = LOCK_INIT;
+static thread_p debug_async_thread = NULL;
+
+static THREAD_FUNC(debug_async_func);
+static void debug_async_publish(const char* func, int line_num, int debug_level, const char* templ, va_list va);
+static void debug_emit(int debug_level, int32_t t_id, uint32_t thread_id, const char *func, int line_num, int64_t epoch_ms, const char *msg);
+
+
 // /* only output the version once */
 // static lock_t printed_version = LOCK_INIT;
 
@@ -5261,43 +5732,100 @@ static uint32_t get_thread_id()
 
 static const char* debug_level_name[DEBUG_END] = { "NONE", "ERROR", "WARN", "INFO", "DETAIL", "SPEW" };
 
+/*
+ * Claim a ring slot and publish the record, or count it as dropped when
+ * the ring is full.  The caller is counted in debug_async_producers.
+ */
+
+static void debug_async_publish(const char* func, int line_num, int debug_level, const char* templ, va_list va)
+{
+    int pos = lock_load_acquire(&debug_ring_head);
+
+    /* claim a slot, the slot is free when its sequence matches the position. */
+    for(;;) {
+        debug_record_t *rec = &debug_ring[pos & DEBUG_ASYNC_RING_MASK];
+        int diff = (int)((unsigned int)lock_load_acquire(&rec->seq) - (unsigned int)pos);
+
+        if(diff == 0) {
+            int prev = lock_compare_and_swap(&debug_ring_head, pos, pos + 1);
+
+            if(prev == pos) {
+                rec->debug_level = debug_level;
+                rec->tag_id = tag_id;
+                rec->thread_id = get_thread_id();
+                rec->line_num = line_num;
+                rec->func = func;
+                rec->epoch_ms = time_ms();
+
+                vsnprintf(rec->msg, sizeof(rec->msg), templ, va);
+
+                /* publish, the consumer waits for pos + 1. */
+                lock_store_release(&rec->seq, pos + 1);
+
+                return;
+            }
+
+            pos = prev;
+        } else if(diff < 0) {
+            /* ring is full, the logging thread is behind. */
+            lock_fetch_add(&debug_ring_dropped, 1);
+
+            return;
+        } else {
+            pos = lock_load_acquire(&debug_ring_head);
+        }
+    }
+}
+
+
 extern void pdebug_impl(const char* func, int line_num, int debug_level, const char* templ, ...)
 {
     va_list va;
+    char output[1000]; /* MAGIC */
+
+    va_start(va, templ);
+
+    if(lock_load_acquire(&debug_async_enabled)) {
+        /* count this caller before checking again, debug_set_async(0) waits for counted callers before the final drain. */
+        lock_fetch_add(&debug_async_producers, 1);
+
+        if(lock_load_acquire(&debug_async_enabled)) {
+            debug_async_publish(func, line_num, debug_level, templ, va);
+
+            lock_fetch_add(&debug_async_producers, -1);
+
+            va_end(va);
+            return;
+        }
+
+        lock_fetch_add(&debug_async_producers, -1);
+    }
+
+    /* FIXME - check the output size */
+    vsnprintf(output, sizeof(output), templ, va);
+
+    va_end(va);
+
+    debug_emit(debug_level, tag_id, get_thread_id(), func, line_num, time_ms(), output);
+}
+
+
+static void debug_emit(int debug_level, int32_t t_id, uint32_t thread_id, const char *func, int line_num, int64_t epoch_ms, const char *msg)
+{
     struct tm t;
     time_t epoch;
-    int64_t epoch_ms;
     int remainder_ms;
-    char prefix[1000]; /* MAGIC */
-    int prefix_size = 0;
-    char output[1000];
-    //int output_size = 0;
-
-    /* build the prefix */
-    // prefix_size = make_prefix(prefix,(int)sizeof(prefix));  /* don't exceed a size that int can express! */
-    // if(prefix_size <= 0) {
-    //     return;
-    // }
+    char output[1000]; /* MAGIC */
 
     /* get the time parts */
-    epoch_ms = time_ms();
     epoch = (time_t)(epoch_ms / 1000);
     remainder_ms = (int)(epoch_ms % 1000);
 
     /* FIXME - should capture error return! */
     localtime_r(&epoch, &t);
 
-    /* print only once */
-    /* FIXME - this may not be safe. */
-    // if(!printed_version && debug_level >= DEBUG_INFO) {
-    //     if(lock_acquire_try((lock_t*)&printed_version)) {
-    //         /* create the output string template */
-    //         fprintf(stderr,"%s INFO libplctag version %s, debug level %d.\n",prefix, VERSION, get_debug_level());
-    //     }
-    // }
-
-    /* build the output string template */
-    prefix_size += snprintf(prefix, sizeof(prefix), "%04d-%02d-%02d %02d:%02d:%02d.%03d thread(%u) tag(%" PRId32 ") %s %s:%d %s\n",
+    /* build the output string */
+    snprintf(output, sizeof(output), "%04d-%02d-%02d %02d:%02d:%02d.%03d thread(%u) tag(%" PRId32 ") %s %s:%d %s\n",
         t.tm_year + 1900,
         t.tm_mon + 1, /* month is 0-11? */
         t.tm_mday,
@@ -5305,29 +5833,124 @@ extern void pdebug_impl(const char* func, int line_num, int debug_level, const c
         t.tm_min,
         t.tm_sec,
         remainder_ms,
-        get_thread_id(),
-        tag_id,
+        thread_id,
+        t_id,
         debug_level_name[debug_level],
         func,
         line_num,
-        templ);
+        msg);
 
     /* make sure it is zero terminated */
-    prefix[sizeof(prefix) - 1] = 0;
-
-    /* print it out. */
-    va_start(va, templ);
+    output[sizeof(output) - 1] = 0;
 
-    /* FIXME - check the output size */
-    /*output_size = */vsnprintf(output, sizeof(output), prefix, va);
     if (log_callback_func) {
-        log_callback_func(tag_id, debug_level, output);
+        log_callback_func(t_id, debug_level, output);
     }
     else {
         fputs(output, stderr);
     }
+}
 
-    va_end(va);
+
+/*
+ * Drain everything that has been published to the ring.  Only called from
+ * the logging thread, or after it has been joined.
+ */
+
+static void debug_async_drain(void)
+{
+    int dropped = 0;
+
+    for(;;) {
+        int pos = debug_ring_tail;
+        debug_record_t *rec = &debug_ring[pos & DEBUG_ASYNC_RING_MASK];
+
+        if(lock_load_acquire(&rec->seq) != pos + 1) {
+            break;
+        }
+
+        debug_emit(rec->debug_level, rec->tag_id, rec->thread_id, rec->func, rec->line_num, rec->epoch_ms, rec->msg);
+
+        /* hand the slot back to the producers for the next lap. */
+        lock_store_release(&rec->seq, pos + DEBUG_ASYNC_RING_SIZE);
+
+        debug_ring_tail = pos + 1;
+    }
+
+    dropped = lock_fetch_add(&debug_ring_dropped, 0);
+    if(dropped) {
+        char msg[64]; /* MAGIC */
+
+        lock_fetch_add(&debug_ring_dropped, -dropped);
+
+        snprintf(msg, sizeof(msg), "%d log messages dropped, ring full.", dropped);
+        debug_emit(DEBUG_WARN, 0, get_thread_id(), __func__, __LINE__, time_ms(), msg);
+    }
+}
+
+
+THREAD_FUNC(debug_async_func)
+{
+    (void)arg;
+
+    while(!lock_load_acquire(&debug_async_terminating)) {
+        debug_async_drain();
+
+        sleep_ms(DEBUG_ASYNC_IDLE_MS);
+    }
+
+    /* catch anything published while we were stopping. */
+    debug_async_drain();
+
+    THREAD_RETURN(0);
+}
+
+
+int debug_set_async(int enable)
+{
+    int rc = PLCTAG_STATUS_OK;
+
+    spin_block(&debug_async_lock) {
+        if(enable && !debug_async_thread) {
+            for(int i = 0; i < DEBUG_ASYNC_RING_SIZE; i++) {
+                debug_ring[i].seq = i;
+            }
+
+            debug_ring_head = 0;
+            debug_ring_tail = 0;
+            debug_ring_dropped = 0;
+            debug_async_terminating = 0;
+
+            rc = thread_create(&debug_async_thread, debug_async_func, 32*1024, NULL);
+            if(rc == PLCTAG_STATUS_OK) {
+                lock_store_release(&debug_async_enabled, 1);
+            } else {
+                debug_async_thread = NULL;
+            }
+        } else if(!enable && debug_async_thread) {
+            /* new messages go out synchronously, the thread flushes the rest. */
+            lock_compare_and_swap(&debug_async_enabled, 1, 0);
+
+            /* callers that saw it enabled may still publish, wait for them before the final drain. */
+            while(lock_load_acquire(&debug_async_producers)) {
+                sleep_ms(1);
+            }
+
+            lock_store_release(&debug_async_terminating, 1);
+
+            thread_join(debug_async_thread);
+            thread_destroy(&debug_async_thread);
+            debug_async_thread = NULL;
+        }
+    }
+
+    return rc;
+}
+
+
+int debug_get_async(void)
+{
+    return lock_load_acquire(&debug_async_enabled);
 }
 
 
@@ -143,6 +143,24 @@ LIB_EXPORT void plc_tag_set_debug_level(int debug_level);
 
 
 
+/*
+ * Enable or disable asynchronous debug output.
+ *
+ * When enabled, library threads only format the message body into a lock-free
+ * ring and return.  A background thread adds the timestamp prefix and passes
+ * the message to stderr or to the registered logger.  If the ring fills up,
+ * messages are dropped and a count of the dropped messages is logged instead.
+ *
+ * Disabling flushes any queued messages.  Asynchronous output is turned off
+ * by plc_tag_shutdown().
+ *
+ * Returns PLCTAG_STATUS_OK or PLCTAG_ERR_THREAD_CREATE.
+ */
+
+LIB_EXPORT int plc_tag_set_debug_async(int enable);
+
+
+
 /*
  * Check that the library supports the required API version.
  *
@@ -215,6 +233,112 @@ LIB_EXPORT int32_t plc_tag_create_ex(const char *attrib_str, void (*tag_callback
 
 
 
+/*
+ * plc_tag_conn_create
+ *
+ * Parse a connection attribute string (protocol, gateway, path, plc etc.)
+ * once into a reusable descriptor.  Use plc_tag_create_in_conn() to create
+ * tags on it without re-parsing the string or looking up the session for
+ * every tag.
+ *
+ * Returns PLCTAG_STATUS_OK and sets conn on success.
+ */
+
+typedef struct plc_tag_conn_t *plc_tag_conn_p;
+
+LIB_EXPORT int plc_tag_conn_create(const char *attrib_str, plc_tag_conn_p *conn);
+
+
+
+/*
+ * plc_tag_create_in_conn
+ *
+ * As for plc_tag_create but the connection attributes come from the
+ * descriptor.  elem_size and elem_count are only set when greater than zero.
+ */
+
+LIB_EXPORT int32_t plc_tag_create_in_conn(plc_tag_conn_p conn, const char *name, int elem_size, int elem_count, int timeout);
+
+
+
+/*
+ * plc_tag_conn_destroy
+ *
+ * Free a connection descriptor.  Tags created from it remain valid.
+ */
+
+LIB_EXPORT void plc_tag_conn_destroy(plc_tag_conn_p conn);
+
+
+
+
+/*
+ * plc_tag_conn_get_stats
+ *
+ * Copy the wire counters of the session behind a connection descriptor.
+ * Counters are totals since the session was created.  Take the difference
+ * between two calls for rates.
+ *
+ * requests_per_packet[i] counts packets that carried 2^i to 2^(i+1)-1
+ * requests.  The last bucket also counts anything larger.
+ *
+ * Round trip times run from sending a request packet to receiving its
+ * response.  Percentiles are accurate to about 20%.
+ *
+ * Returns PLCTAG_ERR_NOT_FOUND until the first AB tag has been created in
+ * the descriptor, since only then is there a session to report on.
+ */
+
+#define PLCTAG_STATS_BUNDLE_BUCKETS (8)
+
+typedef struct {
+    uint64_t packets_sent;
+    uint64_t packets_received;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+
+    uint64_t requests_sent;
+    uint64_t requests_per_packet[PLCTAG_STATS_BUNDLE_BUCKETS];
+
+    uint64_t fragment_reads;        /* Read Tag Fragmented requests after the first piece */
+    uint64_t failed_requests;       /* requests failed by a packet send/receive error */
+    uint64_t session_retries;       /* reconnects after a session error */
+    uint64_t forward_opens;         /* Forward Open requests sent */
+    uint64_t forward_open_retries;  /* Forward Opens re-sent with a new size, id or command */
+
+    uint64_t rtt_count;
+    int64_t rtt_min_us;
+    int64_t rtt_mean_us;
+    int64_t rtt_p50_us;
+    int64_t rtt_p90_us;
+    int64_t rtt_p99_us;
+    int64_t rtt_max_us;
+} plc_tag_session_stats_t;
+
+LIB_EXPORT int plc_tag_conn_get_stats(plc_tag_conn_p conn, plc_tag_session_stats_t *stats);
+
+
+
+/*
+ * plc_tag_conn_reconnect
+ *
+ * Close the session behind a connection descriptor and connect again without
+ * waiting out the retry time.  Tag handles stay valid and their reads resume
+ * once the session and Forward Open are re-established.  Use this when reads
+ * time out because the PLC or the network went away.
+ *
+ * The connection attributes retry_wait_ms (default 5000) and
+ * connect_timeout_ms (default none) control how quickly a session that keeps
+ * failing tries again.
+ *
+ * Returns PLCTAG_ERR_NOT_FOUND if no AB tag has been created in the
+ * descriptor yet.
+ */
+
+LIB_EXPORT int plc_tag_conn_reconnect(plc_tag_conn_p conn);
+
+
+
 /*
  * plc_tag_shutdown
  *
@@ -457,6 +581,12 @@ LIB_EXPORT int plc_tag_write(int32_t tag, int timeout);
 
 /*
  * Tag data accessors.
+ *
+ * AB tags have the int attribute "bytes_received".  While a read is in
+ * progress it is the number of bytes at the start of the tag data that
+ * have already arrived, e.g. the fragments of an @tags listing.  These
+ * can be copied with plc_tag_get_raw_bytes() before the read completes.
+ * Otherwise it is the tag size.
  */
 
 
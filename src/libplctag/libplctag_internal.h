@@ -241,6 +241,14 @@ int lock_acquire_try(lock_t *lock);
 int lock_acquire(lock_t *lock);
 void lock_release(lock_t *lock);
 
+/* lock-free counters, both return the value held before the operation */
+int lock_fetch_add(lock_t *val, int inc);
+int lock_compare_and_swap(lock_t *val, int old_val, int new_val);
+
+/* atomic load and store for values shared with the counters above */
+int lock_load_acquire(lock_t *val);
+void lock_store_release(lock_t *val, int new_val);
+
 
 /* condition variables */
 typedef struct cond_t* cond_p;
@@ -291,6 +299,7 @@ int plc_lib_serial_port_write(serial_port_p serial_port, uint8_t *data, int size
 /* time functions */
 int sleep_ms(int ms);
 int64_t time_ms(void);
+int64_t time_us(void);
 struct tm *localtime_r(const time_t *timep, struct tm *result);
 
 /* some functions can be simply replaced */
@@ -438,6 +447,14 @@ int lock_acquire_try(lock_t *lock);
 int lock_acquire(lock_t *lock);
 void lock_release(lock_t *lock);
 
+/* lock-free counters, both return the value held before the operation */
+int lock_fetch_add(lock_t *val, int inc);
+int lock_compare_and_swap(lock_t *val, int old_val, int new_val);
+
+/* atomic load and store for values shared with the counters above */
+int lock_load_acquire(lock_t *val);
+void lock_store_release(lock_t *val, int new_val);
+
 
 /* condition variables */
 typedef struct cond_t *cond_p;
@@ -488,6 +505,7 @@ int plc_lib_serial_port_write(serial_port_p serial_port, uint8_t *data, int size
 /* misc functions */
 int sleep_ms(int ms);
 int64_t time_ms(void);
+int64_t time_us(void);
 
 #define snprintf_platform snprintf
 
@@ -519,6 +537,7 @@ typedef struct attr_t *attr;
 attr_entry find_entry(attr a, const char *name);
 attr attr_create(void);
 attr attr_create_from_str(const char *attr_str);
+attr attr_dup(attr attrs);
 int attr_set_str(attr attrs, const char *name, const char *val);
 int attr_set_int(attr attrs, const char *name, int val);
 int attr_set_float(attr attrs, const char *name, float val);
@@ -710,6 +729,9 @@ void pdebug_dump_bytes_impl(const char *func, int line_num, int debug_level, uin
 int debug_register_logger(void (*log_callback_func)(int32_t tag_id, int debug_level, const char *message));
 int debug_unregister_logger(void);
 
+int debug_set_async(int enable);
+int debug_get_async(void);
+
 #endif // __UTIL_DEBUG_H__
 
 
@@ -2268,6 +2290,7 @@ int check_write_request_status(ab_tag_p tag, ab_request_p request);
 void ab_teardown(void);
 int ab_init();
 plc_tag_p ab_tag_create(attr attribs, void (*tag_callback_func)(int32_t tag_id, int event, int status, void *userdata), void *userdata);
+plc_tag_p ab_tag_create_in_session(attr attribs, ab_session_p session, void (*tag_callback_func)(int32_t tag_id, int event, int status, void *userdata), void *userdata);
 
 #endif // __PROTOCOLS_AB_AB_H__
 
@@ -2357,6 +2380,11 @@ int pccc_encode_dt_byte(uint8_t *data,int buf_size, uint32_t data_type, uint32_t
 #define SESSION_INC_REQUESTS    (10)
 
 
+/* RTT histogram, exact below SESSION_RTT_LINEAR us then 4 buckets per power of two */
+#define SESSION_RTT_SUB_BUCKETS (4)
+#define SESSION_RTT_LINEAR (2 * SESSION_RTT_SUB_BUCKETS)
+#define SESSION_RTT_BUCKETS (SESSION_RTT_LINEAR + 32 * SESSION_RTT_SUB_BUCKETS)
+
 struct ab_session_t {
 //    int status;
     int failed;
@@ -2413,6 +2441,17 @@ struct ab_session_t {
     /* disconnect handling */
     int auto_disconnect_enabled;
     int auto_disconnect_timeout_ms;
+
+    /* reconnect handling, see plc_tag_conn_reconnect() */
+    int retry_wait_ms;
+    int connect_timeout_ms;
+    volatile int reconnect_requested;
+
+    /* wire statistics, see plc_tag_conn_get_stats().  rtt_* fields are filled in on request. */
+    lock_t stats_lock;
+    plc_tag_session_stats_t stats;
+    uint64_t rtt_total_us;
+    uint32_t rtt_hist[SESSION_RTT_BUCKETS];
 };
 
 
@@ -2433,6 +2472,9 @@ struct ab_request_t {
     int allow_packing;
     int packing_num;
 
+    /* allow the session to send more requests before this one is answered */
+    int allow_pipelining;
+
     /* time stamp for debugging output */
     int64_t time_sent;
 
@@ -2455,6 +2497,10 @@ int session_get_max_payload(ab_session_p session);
 int session_create_request(ab_session_p session, int tag_id, ab_request_p *request);
 int session_add_request(ab_session_p sess, ab_request_p req);
 
+void session_count_fragment_read(ab_session_p session);
+void session_request_reconnect(ab_session_p session);
+int session_get_stats(ab_session_p session, plc_tag_session_stats_t *stats);
+
 #endif // __PROTOCOLS_AB_SESSION_H__
 
 
@@ -2532,6 +2578,19 @@ struct ab_tag_t {
     ab_request_p req;
     int offset;
 
+    /* cached connected read request, only the byte offset changes. */
+    uint8_t *read_req_template;
+    int read_req_template_size;
+    int read_req_template_elem_count;
+    int read_req_offset_pos;
+
+    /* parallel fragmented reads, frag_size is learned from the first read. */
+    int parallel_frag_read;
+    int frag_size;
+    int frag_count;
+    int frag_req_capacity;
+    ab_request_p *frag_reqs;
+
     int allow_packing;
 
     /* flags for operations */
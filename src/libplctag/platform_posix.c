@@ -972,6 +972,56 @@ extern void lock_release(lock_t *lock)
 }
 
 
+/*
+ * lock_fetch_add
+ *
+ * Atomically adds inc to the value and returns the previous value.
+ */
+
+extern int lock_fetch_add(lock_t *val, int inc)
+{
+    return __sync_fetch_and_add((int*)val, inc);
+}
+
+
+/*
+ * lock_compare_and_swap
+ *
+ * Atomically replaces the value with new_val if it still holds old_val.
+ * Returns the value held before the operation.  Acts as a full barrier.
+ */
+
+extern int lock_compare_and_swap(lock_t *val, int old_val, int new_val)
+{
+    return __sync_val_compare_and_swap((int*)val, old_val, new_val);
+}
+
+
+/*
+ * lock_load_acquire
+ *
+ * Atomically reads the value.  Nothing after it is read before it.
+ */
+
+extern int lock_load_acquire(lock_t *val)
+{
+    return __atomic_load_n((int*)val, __ATOMIC_ACQUIRE);
+}
+
+
+/*
+ * lock_store_release
+ *
+ * Atomically writes the value.  Everything written before it is visible
+ * to a thread that reads new_val with lock_load_acquire().
+ */
+
+extern void lock_store_release(lock_t *val, int new_val)
+{
+    __atomic_store_n((int*)val, new_val, __ATOMIC_RELEASE);
+}
+
+
 /***************************************************************************
  ************************* Condition Variables *****************************
  ***************************************************************************/
@@ -2288,3 +2338,19 @@ int64_t time_ms(void)
 
     return  ((int64_t)tv.tv_sec*1000)+ ((int64_t)tv.tv_usec/1000);
 }
+
+
+/*
+ * time_us
+ *
+ * Microseconds from a monotonic clock.  Only useful for measuring
+ * intervals, it does not follow changes to the system time.
+ */
+int64_t time_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((int64_t)ts.tv_sec * 1000000) + ((int64_t)ts.tv_nsec / 1000);
+}
@@ -1065,6 +1065,62 @@ extern void lock_release(lock_t *lock)
 }
 
 
+/***************************************************************************
+ * lock_fetch_add
+ *
+ * Atomically adds inc to the value and returns the previous value.
+ */
+
+extern int lock_fetch_add(lock_t *val, int inc)
+{
+    return (int)InterlockedExchangeAdd(val, (LONG)inc);
+}
+
+
+/***************************************************************************
+ * lock_compare_and_swap
+ *
+ * Atomically replaces the value with new_val if it still holds old_val.
+ * Returns the value held before the operation.  Acts as a full barrier.
+ */
+
+extern int lock_compare_and_swap(lock_t *val, int old_val, int new_val)
+{
+    return (int)InterlockedCompareExchange(val, (LONG)new_val, (LONG)old_val);
+}
+
+
+/***************************************************************************
+ * lock_load_acquire
+ *
+ * Atomically reads the value.  Nothing after it is read before it.
+ */
+
+extern int lock_load_acquire(lock_t *val)
+{
+    int result = (int)*val;
+
+    MemoryBarrier();
+
+    return result;
+}
+
+
+/***************************************************************************
+ * lock_store_release
+ *
+ * Atomically writes the value.  Everything written before it is visible
+ * to a thread that reads new_val with lock_load_acquire().
+ */
+
+extern void lock_store_release(lock_t *val, int new_val)
+{
+    MemoryBarrier();
+
+    *val = (long)new_val;
+}
+
+
 
 
 
@@ -2622,6 +2678,27 @@ int64_t time_ms(void)
 }
 
 
+/*
+ * time_us
+ *
+ * Microseconds from a monotonic clock.  Only useful for measuring
+ * intervals, it does not follow changes to the system time.
+ */
+int64_t time_us(void)
+{
+    static LARGE_INTEGER freq = {0};
+    LARGE_INTEGER count;
+
+    if(freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+
+    QueryPerformanceCounter(&count);
+
+    return (int64_t)((count.QuadPart / freq.QuadPart) * 1000000 + ((count.QuadPart % freq.QuadPart) * 1000000) / freq.QuadPart);
+}
+
+
 struct tm *localtime_r(const time_t *timep, struct tm *result)
 {
     time_t t = *timep;
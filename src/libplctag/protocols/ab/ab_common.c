@@ -152,6 +152,20 @@ void ab_teardown(void)
 
 
 plc_tag_p ab_tag_create(attr attribs, void (*tag_callback_func)(int32_t tag_id, int event, int status, void *userdata), void *userdata)
+{
+    return ab_tag_create_in_session(attribs, AB_SESSION_NULL, tag_callback_func, userdata);
+}
+
+
+/*
+ * ab_tag_create_in_session
+ *
+ * Same as ab_tag_create() but if a session is passed it is used directly
+ * instead of looking one up by gateway and path.  The tag takes its own
+ * reference to the session.
+ */
+
+plc_tag_p ab_tag_create_in_session(attr attribs, ab_session_p session, void (*tag_callback_func)(int32_t tag_id, int event, int status, void *userdata), void *userdata)
 {
     ab_tag_p tag = AB_TAG_NULL;
     const char *path = NULL;
@@ -265,7 +279,14 @@ plc_tag_p ab_tag_create(attr attribs, void (*tag_callback_func)(int32_t tag_id,
      *
      * All tags need sessions.  They are the TCP connection to the gateway PLC.
      */
-    if(session_find_or_create(&tag->session, attribs) != PLCTAG_STATUS_OK) {
+    if(session) {
+        tag->session = (ab_session_p)rc_inc(session);
+        if(!tag->session) {
+            pdebug(DEBUG_WARN, "Passed session is being destroyed!");
+            tag->status = PLCTAG_ERR_BAD_GATEWAY;
+            return (plc_tag_p)tag;
+        }
+    } else if(session_find_or_create(&tag->session, attribs) != PLCTAG_STATUS_OK) {
         pdebug(DEBUG_INFO,"Unable to create session!");
         tag->status = PLCTAG_ERR_BAD_GATEWAY;
         return (plc_tag_p)tag;
@@ -372,6 +393,9 @@ plc_tag_p ab_tag_create(attr attribs, void (*tag_callback_func)(int32_t tag_id,
         tag->use_connected_msg = attr_get_int(attribs,"use_connected_msg", 1);
         tag->allow_packing = attr_get_int(attribs, "allow_packing", 1);
 
+        /* large tags can request all fragments at once. */
+        tag->parallel_frag_read = attr_get_int(attribs, "parallel_frag_read", 0);
+
         break;
 
     case AB_PLC_MICRO800:
@@ -738,10 +762,21 @@ int ab_tag_abort(ab_tag_p tag)
         }
 
         tag->req = (ab_request_p)rc_dec(tag->req);
-    } else {
+    } else if(!tag->frag_count) {
         pdebug(DEBUG_DETAIL, "Called without a request in flight.");
     }
 
+    /* parallel fragment reads have one request per fragment. */
+    for(int i = 0; i < tag->frag_count; i++) {
+        spin_block(&tag->frag_reqs[i]->lock) {
+            tag->frag_reqs[i]->abort_request = 1;
+        }
+
+        tag->frag_reqs[i] = (ab_request_p)rc_dec(tag->frag_reqs[i]);
+    }
+
+    tag->frag_count = 0;
+
     tag->read_in_progress = 0;
     tag->write_in_progress = 0;
     tag->offset = 0;
@@ -847,6 +882,16 @@ void ab_tag_destroy(ab_tag_p tag)
         tag->data = NULL;
     }
 
+    if (tag->read_req_template) {
+        mem_free(tag->read_req_template);
+        tag->read_req_template = NULL;
+    }
+
+    if (tag->frag_reqs) {
+        mem_free(tag->frag_reqs);
+        tag->frag_reqs = NULL;
+    }
+
     pdebug(DEBUG_INFO,"Finished releasing all tag resources.");
 
     pdebug(DEBUG_INFO, "done");
@@ -868,6 +913,9 @@ int ab_get_int_attrib(plc_tag_p raw_tag, const char *attrib_name, int default_va
         res = tag->elem_size;
     } else if(str_cmp_i(attrib_name, "elem_count") == 0) {
         res = tag->elem_count;
+    } else if(str_cmp_i(attrib_name, "bytes_received") == 0) {
+        /* data from the first byte up to here is valid while a fragmented read is in flight. */
+        res = tag->read_in_progress ? tag->offset : tag->size;
     } else if(str_cmp_i(attrib_name, "elem_type") == 0) {
         switch(tag->plc_type) {
             case AB_PLC_PLC5: /* fall through */
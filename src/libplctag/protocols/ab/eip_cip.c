@@ -121,7 +121,10 @@ START_PACK typedef struct {
 
 
 
+static int build_read_request_template(ab_tag_p tag);
 static int build_read_request_connected(ab_tag_p tag, int byte_offset);
+static int queue_read_request_connected(ab_tag_p tag, int byte_offset, int allow_packing, int allow_pipelining, ab_request_p *req_out);
+static int build_read_requests_parallel(ab_tag_p tag);
 //static int build_tag_list_request_connected(ab_tag_p tag);
 static int build_read_request_unconnected(ab_tag_p tag, int byte_offset);
 static int build_write_request_connected(ab_tag_p tag, int byte_offset);
@@ -129,6 +132,7 @@ static int build_write_request_unconnected(ab_tag_p tag, int byte_offset);
 static int build_write_bit_request_connected(ab_tag_p tag);
 static int build_write_bit_request_unconnected(ab_tag_p tag);
 static int check_read_status_connected(ab_tag_p tag);
+static int check_read_status_parallel(ab_tag_p tag);
 static int check_read_status_unconnected(ab_tag_p tag);
 static int check_write_status_connected(ab_tag_p tag);
 static int check_write_status_unconnected(ab_tag_p tag);
@@ -419,7 +423,12 @@ int tag_read_start(ab_tag_p tag)
         // if(tag->tag_list) {
         //     rc = build_tag_list_request_connected(tag);
         // } else {
-            rc = build_read_request_connected(tag, tag->offset);
+            if(tag->parallel_frag_read && tag->frag_size > 0 && tag->offset == 0
+               && !tag->first_read && !tag->pre_write_read && tag->size > tag->frag_size) {
+                rc = build_read_requests_parallel(tag);
+            } else {
+                rc = build_read_request_connected(tag, tag->offset);
+            }
         // }
     } else {
         rc = build_read_request_unconnected(tag, tag->offset);
@@ -428,6 +437,11 @@ int tag_read_start(ab_tag_p tag)
     if (rc != PLCTAG_STATUS_OK) {
         pdebug(DEBUG_WARN,"Unable to build read request!");
 
+        /* drop any fragment requests that were already queued. */
+        if(tag->frag_count > 0) {
+            ab_tag_abort(tag);
+        }
+
         tag->read_in_progress = 0;
 
         return rc;
@@ -507,28 +521,41 @@ int tag_write_start(ab_tag_p tag)
 
 
 
-int build_read_request_connected(ab_tag_p tag, int byte_offset)
+/*
+ * build_read_request_template
+ *
+ * The connected read request only changes in the byte offset between
+ * cycles.  Build it once per tag, with everything but the offset and the
+ * session-owned connection fields filled in.
+ */
+
+int build_read_request_template(ab_tag_p tag)
 {
     eip_cip_co_req* cip = NULL;
     uint8_t* data = NULL;
-    ab_request_p req = NULL;
-    int rc = PLCTAG_STATUS_OK;
     uint8_t read_cmd = AB_EIP_CMD_CIP_READ_FRAG;
+    int template_size = 0;
 
-    pdebug(DEBUG_INFO, "Starting.");
+    pdebug(DEBUG_DETAIL, "Starting.");
 
-    /* get a request buffer */
-    rc = session_create_request(tag->session, tag->tag_id, &req);
-    if (rc != PLCTAG_STATUS_OK) {
-        pdebug(DEBUG_ERROR, "Unable to get new request.  rc=%d", rc);
-        return rc;
+    if(tag->read_req_template) {
+        mem_free(tag->read_req_template);
+        tag->read_req_template = NULL;
+    }
+
+    template_size = (int)sizeof(eip_cip_co_req) + 1 + tag->encoded_name_size + (int)sizeof(uint16_le) + (int)sizeof(uint32_le);
+
+    tag->read_req_template = (uint8_t*)mem_alloc(template_size);
+    if(!tag->read_req_template) {
+        pdebug(DEBUG_ERROR, "Unable to allocate read request template!");
+        return PLCTAG_ERR_NO_MEM;
     }
 
     /* point the request struct at the buffer */
-    cip = (eip_cip_co_req*)(req->data);
+    cip = (eip_cip_co_req*)(tag->read_req_template);
 
     /* point to the end of the struct */
-    data = (req->data) + sizeof(eip_cip_co_req);
+    data = tag->read_req_template + sizeof(eip_cip_co_req);
 
     /*
      * set up the embedded CIP read packet
@@ -539,8 +566,6 @@ int build_read_request_connected(ab_tag_p tag, int byte_offset)
      * uint16_t # of elements to read
      */
 
-    //embed_start = data;
-
     /* set up the CIP Read request */
     if(tag->plc_type == AB_PLC_OMRON_NJNX) {
         read_cmd = AB_EIP_CMD_CIP_READ;
@@ -560,9 +585,11 @@ int build_read_request_connected(ab_tag_p tag, int byte_offset)
     data += sizeof(uint16_le);
 
     if (read_cmd == AB_EIP_CMD_CIP_READ_FRAG) {
-        /* add the byte offset for this request */
-        *((uint32_le*)data) = h2le32((uint32_t)byte_offset);
+        /* the byte offset is patched in for each request */
+        tag->read_req_offset_pos = (int)(data - tag->read_req_template);
         data += sizeof(uint32_le);
+    } else {
+        tag->read_req_offset_pos = -1;
     }
 
     /* now we go back and fill in the fields of the static part */
@@ -580,27 +607,150 @@ int build_read_request_connected(ab_tag_p tag, int byte_offset)
     cip->cpf_cdi_item_type = h2le16(AB_EIP_ITEM_CDI);/* ALWAYS 0x00B1 - connected Data Item */
     cip->cpf_cdi_item_length = h2le16((uint16_t)(data - (uint8_t*)(&cip->cpf_conn_seq_num))); /* REQ: fill in with length of remaining data. */
 
-    /* set the size of the request */
-    req->request_size = (int)(data - (req->data));
+    tag->read_req_template_size = (int)(data - tag->read_req_template);
+    tag->read_req_template_elem_count = tag->elem_count;
 
-    /* set the session so that we know what session the request is aiming at */
-    //req->session = tag->session;
+    pdebug(DEBUG_DETAIL, "Done.");
 
-    req->allow_packing = tag->allow_packing;
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+int build_read_request_connected(ab_tag_p tag, int byte_offset)
+{
+    ab_request_p req = NULL;
+    int rc = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    rc = queue_read_request_connected(tag, byte_offset, tag->allow_packing, 0, &req);
+
+    /* save the request for later */
+    tag->req = req;
+
+    pdebug(DEBUG_INFO, "Done");
+
+    return rc;
+}
+
+
+
+/*
+ * queue_read_request_connected
+ *
+ * Fill in a new request from the tag's read template and hand it to the
+ * session.  On success the caller owns the returned request reference.
+ */
+
+int queue_read_request_connected(ab_tag_p tag, int byte_offset, int allow_packing, int allow_pipelining, ab_request_p *req_out)
+{
+    ab_request_p req = NULL;
+    int rc = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    *req_out = NULL;
+
+    /* the element count is the only input that can change after creation. */
+    if(!tag->read_req_template || tag->read_req_template_elem_count != tag->elem_count) {
+        rc = build_read_request_template(tag);
+        if(rc != PLCTAG_STATUS_OK) {
+            return rc;
+        }
+    }
+
+    /* get a request buffer */
+    rc = session_create_request(tag->session, tag->tag_id, &req);
+    if (rc != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR, "Unable to get new request.  rc=%d", rc);
+        return rc;
+    }
+
+    if(tag->read_req_template_size > req->request_capacity) {
+        pdebug(DEBUG_WARN, "Read request is larger than the session request buffer!");
+        rc_dec(req);
+        return PLCTAG_ERR_TOO_LARGE;
+    }
+
+    /* the connection ID and sequence number are filled in by the session. */
+    mem_copy(req->data, tag->read_req_template, tag->read_req_template_size);
+
+    if(tag->read_req_offset_pos >= 0) {
+        *((uint32_le*)(req->data + tag->read_req_offset_pos)) = h2le32((uint32_t)byte_offset);
+    }
+
+    if(byte_offset > 0) {
+        session_count_fragment_read(tag->session);
+    }
+
+    /* set the size of the request */
+    req->request_size = tag->read_req_template_size;
+
+    req->allow_packing = allow_packing;
+    req->allow_pipelining = allow_pipelining;
 
     /* add the request to the session's list. */
     rc = session_add_request(tag->session, req);
 
     if (rc != PLCTAG_STATUS_OK) {
         pdebug(DEBUG_ERROR, "Unable to add request to session! rc=%d", rc);
-        tag->req = (ab_request_p)rc_dec(req);
+        rc_dec(req);
         return rc;
     }
 
-    /* save the request for later */
-    tag->req = req;
+    *req_out = req;
 
-    pdebug(DEBUG_INFO, "Done");
+    pdebug(DEBUG_DETAIL, "Done");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+/*
+ * build_read_requests_parallel
+ *
+ * Queue one Read Tag Fragmented request per fragment of the tag at once
+ * instead of waiting for each response before asking for the next piece.
+ * The fragment size is the amount of data the PLC returned in the first
+ * piece of an earlier sequential read.
+ *
+ * The requests are not packed: each one already fills a response packet,
+ * and packing would make the PLC return shorter fragments.  They are
+ * pipelined instead, the session sends several before the first answer
+ * comes back, see process_pipelined_requests().
+ */
+
+int build_read_requests_parallel(ab_tag_p tag)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int frag_count = (tag->size + tag->frag_size - 1) / tag->frag_size;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(frag_count > tag->frag_req_capacity) {
+        ab_request_p *new_reqs = (ab_request_p *)mem_realloc(tag->frag_reqs, frag_count * (int)sizeof(ab_request_p));
+        if(!new_reqs) {
+            pdebug(DEBUG_WARN, "Unable to allocate fragment request list!");
+            return PLCTAG_ERR_NO_MEM;
+        }
+
+        tag->frag_reqs = new_reqs;
+        tag->frag_req_capacity = frag_count;
+    }
+
+    for(tag->frag_count = 0; tag->frag_count < frag_count; tag->frag_count++) {
+        int byte_offset = tag->frag_count * tag->frag_size;
+
+        rc = queue_read_request_connected(tag, byte_offset, 0, 1, &tag->frag_reqs[tag->frag_count]);
+        if(rc != PLCTAG_STATUS_OK) {
+            pdebug(DEBUG_WARN, "Unable to queue fragment read at offset %d!", byte_offset);
+            return rc;
+        }
+    }
+
+    pdebug(DEBUG_INFO, "Queued %d fragment reads of %d bytes.", frag_count, tag->frag_size);
 
     return PLCTAG_STATUS_OK;
 }
@@ -671,6 +821,10 @@ int build_read_request_unconnected(ab_tag_p tag, int byte_offset)
         data += sizeof(uint32_le);
     }
 
+    if(byte_offset > 0) {
+        session_count_fragment_read(tag->session);
+    }
+
     /* mark the end of the embedded packet */
     embed_end = data;
 
@@ -1422,12 +1576,130 @@ int build_write_request_unconnected(ab_tag_p tag, int byte_offset)
  * locked!
  */
 
-static int check_read_status_connected(ab_tag_p tag)
+/*
+ * decode_read_response_connected
+ *
+ * Check a connected read response and skip past the type information.
+ * Sets payload to the returned data and payload_size to its length, which
+ * can be zero for a packed response.  partial is set when the PLC has more
+ * data after this fragment.
+ */
+
+static int decode_read_response_connected(ab_tag_p tag, ab_request_p request, uint8_t **payload, int *payload_size, int *partial)
 {
-    int rc = PLCTAG_STATUS_OK;
     eip_cip_co_resp* cip_resp;
     uint8_t* data;
     uint8_t* data_end;
+
+    /* point to the data */
+    cip_resp = (eip_cip_co_resp*)(request->data);
+
+    /* point to the start of the data */
+    data = (request->data) + sizeof(eip_cip_co_resp);
+
+    /* point the end of the data */
+    data_end = (request->data + le2h16(cip_resp->encap_length) + sizeof(eip_encap));
+
+    *payload = NULL;
+    *payload_size = 0;
+    *partial = 0;
+
+    if (le2h16(cip_resp->encap_command) != AB_EIP_CONNECTED_SEND) {
+        pdebug(DEBUG_WARN, "Unexpected EIP packet type received: %d!", cip_resp->encap_command);
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    if (le2h32(cip_resp->encap_status) != AB_EIP_OK) {
+        pdebug(DEBUG_WARN, "EIP command failed, response code: %d", le2h32(cip_resp->encap_status));
+        return PLCTAG_ERR_REMOTE_ERR;
+    }
+
+    /*
+     * FIXME
+     *
+     * It probably should not be necessary to check for both as setting the type to anything other
+     * than fragmented is error-prone.
+     */
+
+    if (cip_resp->reply_service != (AB_EIP_CMD_CIP_READ_FRAG | AB_EIP_CMD_CIP_OK)
+        && cip_resp->reply_service != (AB_EIP_CMD_CIP_READ | AB_EIP_CMD_CIP_OK) ) {
+        pdebug(DEBUG_WARN, "CIP response reply service unexpected: %d", cip_resp->reply_service);
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    if (cip_resp->status != AB_CIP_STATUS_OK && cip_resp->status != AB_CIP_STATUS_FRAG) {
+        pdebug(DEBUG_WARN, "CIP read failed with status: 0x%x %s", cip_resp->status, decode_cip_error_short((uint8_t *)&cip_resp->status));
+        pdebug(DEBUG_INFO, decode_cip_error_long((uint8_t *)&cip_resp->status));
+
+        return decode_cip_error_code((uint8_t *)&cip_resp->status);
+    }
+
+    /* check to see if this is a partial response. */
+    *partial = (cip_resp->status == AB_CIP_STATUS_FRAG);
+
+    /*
+     * check to see if there is any data to process.  If this is a packed
+     * response, there might not be.
+     */
+    if((data_end - data) <= 0) {
+        return PLCTAG_STATUS_OK;
+    }
+
+    /* the first byte of the response is a type byte. */
+    pdebug(DEBUG_DETAIL, "type byte = %d (%x)", (int)*data, (int)*data);
+
+    /* handle the data type part.  This can be long. */
+
+    /* check for a simple/base type */
+    if ((*data) >= AB_CIP_DATA_BIT && (*data) <= AB_CIP_DATA_STRINGI) {
+        /* copy the type info for later. */
+        if (tag->encoded_type_info_size == 0) {
+            tag->encoded_type_info_size = 2;
+            mem_copy(tag->encoded_type_info, data, tag->encoded_type_info_size);
+        }
+
+        /* skip the type byte and zero length byte */
+        data += 2;
+    } else if ((*data) == AB_CIP_DATA_ABREV_STRUCT || (*data) == AB_CIP_DATA_ABREV_ARRAY ||
+               (*data) == AB_CIP_DATA_FULL_STRUCT || (*data) == AB_CIP_DATA_FULL_ARRAY) {
+        /* this is an aggregate type of some sort, the type info is variable length */
+        int type_length = *(data + 1) + 2;  /*
+                                               * MAGIC
+                                               * add 2 to get the total length including
+                                               * the type byte and the length byte.
+                                               */
+
+        /* check for extra long types */
+        if (type_length > MAX_TAG_TYPE_INFO) {
+            pdebug(DEBUG_WARN, "Read data type info is too long (%d)!", type_length);
+            return PLCTAG_ERR_TOO_LARGE;
+        }
+
+        /* copy the type info for later. */
+        if (tag->encoded_type_info_size == 0) {
+            tag->encoded_type_info_size = type_length;
+            mem_copy(tag->encoded_type_info, data, tag->encoded_type_info_size);
+        }
+
+        data += type_length;
+    } else {
+        pdebug(DEBUG_WARN, "Unsupported data type returned, type byte=%d", *data);
+        return PLCTAG_ERR_UNSUPPORTED;
+    }
+
+    *payload = data;
+    *payload_size = (int)(data_end - data);
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+static int check_read_status_connected(ab_tag_p tag)
+{
+    int rc = PLCTAG_STATUS_OK;
+    uint8_t* data;
+    int payload_size = 0;
     int partial_data = 0;
     ab_request_p request = NULL;
 
@@ -1438,6 +1710,10 @@ static int check_read_status_connected(ab_tag_p tag)
         return PLCTAG_ERR_NULL_PTR;
     }
 
+    if(tag->frag_count > 0) {
+        return check_read_status_parallel(tag);
+    }
+
     /* guard against the request being deleted out from underneath us. */
     request = (ab_request_p)rc_inc(tag->req);
     rc = check_read_request_status(tag, request);
@@ -1449,113 +1725,22 @@ static int check_read_status_connected(ab_tag_p tag)
 
     /* the request reference is still valid. */
 
-    /* point to the data */
-    cip_resp = (eip_cip_co_resp*)(request->data);
-
-    /* point to the start of the data */
-    data = (request->data) + sizeof(eip_cip_co_resp);
-
-    /* point the end of the data */
-    data_end = (request->data + le2h16(cip_resp->encap_length) + sizeof(eip_encap));
-
     /* check the status */
     do {
-        ptrdiff_t payload_size = (data_end - data);
-
-        if (le2h16(cip_resp->encap_command) != AB_EIP_CONNECTED_SEND) {
-            pdebug(DEBUG_WARN, "Unexpected EIP packet type received: %d!", cip_resp->encap_command);
-            rc = PLCTAG_ERR_BAD_DATA;
-            break;
-        }
-
-        if (le2h32(cip_resp->encap_status) != AB_EIP_OK) {
-            pdebug(DEBUG_WARN, "EIP command failed, response code: %d", le2h32(cip_resp->encap_status));
-            rc = PLCTAG_ERR_REMOTE_ERR;
-            break;
-        }
-
-        /*
-         * FIXME
-         *
-         * It probably should not be necessary to check for both as setting the type to anything other
-         * than fragmented is error-prone.
-         */
-
-        if (cip_resp->reply_service != (AB_EIP_CMD_CIP_READ_FRAG | AB_EIP_CMD_CIP_OK)
-            && cip_resp->reply_service != (AB_EIP_CMD_CIP_READ | AB_EIP_CMD_CIP_OK) ) {
-            pdebug(DEBUG_WARN, "CIP response reply service unexpected: %d", cip_resp->reply_service);
-            rc = PLCTAG_ERR_BAD_DATA;
+        rc = decode_read_response_connected(tag, request, &data, &payload_size, &partial_data);
+        if(rc != PLCTAG_STATUS_OK) {
             break;
         }
 
-        if (cip_resp->status != AB_CIP_STATUS_OK && cip_resp->status != AB_CIP_STATUS_FRAG) {
-            pdebug(DEBUG_WARN, "CIP read failed with status: 0x%x %s", cip_resp->status, decode_cip_error_short((uint8_t *)&cip_resp->status));
-            pdebug(DEBUG_INFO, decode_cip_error_long((uint8_t *)&cip_resp->status));
-
-            rc = decode_cip_error_code((uint8_t *)&cip_resp->status);
-
-            break;
-        }
-
-        /* check to see if this is a partial response. */
-        partial_data = (cip_resp->status == AB_CIP_STATUS_FRAG);
-
-        /*
-         * check to see if there is any data to process.  If this is a packed
-         * response, there might not be.
-         */
-        payload_size = (data_end - data);
         if(payload_size > 0) {
-            /* the first byte of the response is a type byte. */
-            pdebug(DEBUG_DETAIL, "type byte = %d (%x)", (int)*data, (int)*data);
-
-            /* handle the data type part.  This can be long. */
-
-            /* check for a simple/base type */
-            if ((*data) >= AB_CIP_DATA_BIT && (*data) <= AB_CIP_DATA_STRINGI) {
-                /* copy the type info for later. */
-                if (tag->encoded_type_info_size == 0) {
-                    tag->encoded_type_info_size = 2;
-                    mem_copy(tag->encoded_type_info, data, tag->encoded_type_info_size);
-                }
-
-                /* skip the type byte and zero length byte */
-                data += 2;
-            } else if ((*data) == AB_CIP_DATA_ABREV_STRUCT || (*data) == AB_CIP_DATA_ABREV_ARRAY ||
-                       (*data) == AB_CIP_DATA_FULL_STRUCT || (*data) == AB_CIP_DATA_FULL_ARRAY) {
-                /* this is an aggregate type of some sort, the type info is variable length */
-                int type_length = *(data + 1) + 2;  /*
-                                                       * MAGIC
-                                                       * add 2 to get the total length including
-                                                       * the type byte and the length byte.
-                                                       */
-
-                /* check for extra long types */
-                if (type_length > MAX_TAG_TYPE_INFO) {
-                    pdebug(DEBUG_WARN, "Read data type info is too long (%d)!", type_length);
-                    rc = PLCTAG_ERR_TOO_LARGE;
-                    break;
-                }
-
-                /* copy the type info for later. */
-                if (tag->encoded_type_info_size == 0) {
-                    tag->encoded_type_info_size = type_length;
-                    mem_copy(tag->encoded_type_info, data, tag->encoded_type_info_size);
-                }
-
-                data += type_length;
-            } else {
-                pdebug(DEBUG_WARN, "Unsupported data type returned, type byte=%d", *data);
-                rc = PLCTAG_ERR_UNSUPPORTED;
-                break;
+            /* remember how much the PLC sends per fragment for parallel reads. */
+            if(partial_data && tag->offset == 0) {
+                tag->frag_size = payload_size;
             }
 
-            /* check payload size now that we have bumped past the data type info. */
-            payload_size = (data_end - data);
-
             /* copy the data into the tag and realloc if we need more space. */
             if(payload_size + tag->offset > tag->size) {
-                tag->size = (int)payload_size + tag->offset;
+                tag->size = payload_size + tag->offset;
                 tag->elem_size = tag->size / tag->elem_count;
 
                 pdebug(DEBUG_DETAIL, "Increasing tag buffer size to %d bytes.", tag->size);
@@ -1568,7 +1753,7 @@ static int check_read_status_connected(ab_tag_p tag)
                 }
             }
 
-            pdebug(DEBUG_INFO, "Got %d bytes of data", (int)payload_size);
+            pdebug(DEBUG_INFO, "Got %d bytes of data", payload_size);
 
             /*
              * copy the data, but only if this is not
@@ -1577,11 +1762,11 @@ static int check_read_status_connected(ab_tag_p tag)
              * put into the tag's data buffer.
              */
             if (!tag->pre_write_read) {
-                mem_copy(tag->data + tag->offset, data, (int)(payload_size));
+                mem_copy(tag->data + tag->offset, data, payload_size);
             }
 
             /* bump the byte offset */
-            tag->offset += (int)(payload_size);
+            tag->offset += payload_size;
         } else {
             pdebug(DEBUG_DETAIL, "Response returned no data and no error.");
         }
@@ -1640,6 +1825,83 @@ static int check_read_status_connected(ab_tag_p tag)
 }
 
 
+/*
+ * check_read_status_parallel
+ *
+ * Wait for all fragment requests queued by build_read_requests_parallel()
+ * and copy each piece to its offset in the tag buffer.  If the PLC sent a
+ * shorter fragment than expected, the read continues sequentially from
+ * the first gap and the fragment size is learned again on the next read.
+ */
+
+static int check_read_status_parallel(ab_tag_p tag)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int gap_offset = -1;
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    /* wait until every fragment has an answer or one has failed. */
+    for(int i = 0; i < tag->frag_count && rc == PLCTAG_STATUS_OK; i++) {
+        ab_request_p request = tag->frag_reqs[i];
+
+        spin_block(&request->lock) {
+            if(!request->resp_received) {
+                rc = PLCTAG_STATUS_PENDING;
+            } else if(request->status != PLCTAG_STATUS_OK) {
+                rc = request->status;
+                pdebug(DEBUG_WARN,"Session reported failure of fragment request: %s.", plc_tag_decode_error(rc));
+            }
+        }
+    }
+
+    if(rc == PLCTAG_STATUS_PENDING) {
+        return rc;
+    }
+
+    for(int i = 0; i < tag->frag_count && rc == PLCTAG_STATUS_OK; i++) {
+        int byte_offset = i * tag->frag_size;
+        int expected = tag->size - byte_offset < tag->frag_size ? tag->size - byte_offset : tag->frag_size;
+        uint8_t *data = NULL;
+        int payload_size = 0;
+        int partial_data = 0;
+
+        rc = decode_read_response_connected(tag, tag->frag_reqs[i], &data, &payload_size, &partial_data);
+        if(rc != PLCTAG_STATUS_OK) {
+            break;
+        }
+
+        if(payload_size > expected) {
+            payload_size = expected;
+        }
+
+        if(payload_size < expected && gap_offset < 0) {
+            gap_offset = byte_offset + payload_size;
+        }
+
+        mem_copy(tag->data + byte_offset, data, payload_size);
+    }
+
+    pdebug(DEBUG_DETAIL, "Got %d fragments.", tag->frag_count);
+
+    /* releases the fragment requests and clears the in progress flag. */
+    ab_tag_abort(tag);
+
+    if(rc == PLCTAG_STATUS_OK && gap_offset >= 0) {
+        pdebug(DEBUG_DETAIL, "Fragment shorter than %d bytes, continuing from offset %d.", tag->frag_size, gap_offset);
+
+        tag->frag_size = 0;
+        tag->offset = gap_offset;
+
+        rc = tag_read_start(tag);
+    }
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
 
 static int check_read_status_unconnected(ab_tag_p tag)
 {
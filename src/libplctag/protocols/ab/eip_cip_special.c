@@ -1145,7 +1145,8 @@ static int listing_tag_check_read_status_connected(ab_tag_p tag)
 
             pdebug(DEBUG_DETAIL, "total symbols: %d", symbol_index);
 
-            tag->elem_count = tag->offset;
+            /* a re-read can return less than last time, drop the stale tail. */
+            tag->elem_count = tag->size = tag->offset;
 
             tag->first_read = 0;
             tag->offset = 0;
@@ -44,6 +44,7 @@ extern "C" {
 #endif
 
 #define MAX_REQUESTS (200)
+#define MAX_PIPELINED_REQUESTS (8)
 
 #define EIP_CIP_PREFIX_SIZE (44) /* bytes of encap header and CFP connected header */
 
@@ -62,10 +63,17 @@ extern "C" {
 
 /*
  * Number of milliseconds to wait to try to set up the session again
- * after a failure.
+ * after a failure.  Override with the retry_wait_ms attribute.
  */
 #define RETRY_WAIT_MS (5000)
 
+/*
+ * Give up on a TCP connect after this long and retry.  By default the OS
+ * decides, which can take minutes while a PLC is powered off.  Override with
+ * the connect_timeout_ms attribute.
+ */
+#define CONNECT_TIMEOUT_MS (INT_MAX)
+
 #define SESSION_DISCONNECT_TIMEOUT (5000)
 
 #define SOCKET_WAIT_TIMEOUT_MS (20)
@@ -89,6 +97,7 @@ static int session_unregister(ab_session_p session);
 static THREAD_FUNC(session_handler);
 static int purge_aborted_requests_unsafe(ab_session_p session);
 static int process_requests(ab_session_p session);
+static int process_pipelined_requests(ab_session_p session, ab_request_p *requests, int num_requests);
 //static int check_packing(ab_session_p session, ab_request_p request);
 static int get_payload_size(ab_request_p request);
 static int pack_requests(ab_session_p session, ab_request_p *requests, int num_requests);
@@ -111,6 +120,10 @@ static int send_extended_forward_open_request(ab_session_p session);
 static int receive_forward_open_response(ab_session_p session);
 static void request_destroy(void *req_arg);
 static int session_request_increase_buffer(ab_request_p request, int new_capacity);
+static int rtt_bucket_index(int64_t rtt_us);
+static int64_t rtt_bucket_max(int index);
+static int64_t rtt_percentile(ab_session_p session, int percent);
+static void session_count_packet(ab_session_p session, int num_requests, int64_t rtt_us);
 
 
 static volatile mutex_p session_mutex = NULL;
@@ -249,6 +262,8 @@ int session_find_or_create(ab_session_p *tag_session, attr attribs)
     int auto_disconnect_enabled = 0;
     int auto_disconnect_timeout_ms = INT_MAX;
     int connection_group_id = attr_get_int(attribs, "connection_group_id", 0);
+    int retry_wait_ms = attr_get_int(attribs, "retry_wait_ms", RETRY_WAIT_MS);
+    int connect_timeout_ms = attr_get_int(attribs, "connect_timeout_ms", CONNECT_TIMEOUT_MS);
 
     pdebug(DEBUG_DETAIL, "Starting");
 
@@ -284,6 +299,9 @@ int session_find_or_create(ab_session_p *tag_session, attr attribs)
                 session->auto_disconnect_enabled = auto_disconnect_enabled;
                 session->auto_disconnect_timeout_ms = auto_disconnect_timeout_ms;
 
+                session->retry_wait_ms = retry_wait_ms;
+                session->connect_timeout_ms = connect_timeout_ms;
+
                 new_session = 1;
             }
         } else {
@@ -297,6 +315,15 @@ int session_find_or_create(ab_session_p *tag_session, attr attribs)
                 session->auto_disconnect_timeout_ms = auto_disconnect_timeout_ms;
             }
 
+            /* retry and connect timing always go down. */
+            if(session->retry_wait_ms > retry_wait_ms) {
+                session->retry_wait_ms = retry_wait_ms;
+            }
+
+            if(session->connect_timeout_ms > connect_timeout_ms) {
+                session->connect_timeout_ms = connect_timeout_ms;
+            }
+
             pdebug(DEBUG_DETAIL, "Reusing existing session.");
         }
     }
@@ -1027,6 +1054,7 @@ THREAD_FUNC(session_handler)
     int64_t wait_until_time = 0;
     int64_t auto_disconnect_time = time_ms() + SESSION_DISCONNECT_TIMEOUT;
     int auto_disconnect = 0;
+    int retry_now = 0;
 
 
     pdebug(DEBUG_INFO, "Starting thread for session %p", session);
@@ -1047,6 +1075,46 @@ THREAD_FUNC(session_handler)
             purge_aborted_requests_unsafe(session);
         }
 
+        /*
+         * plc_tag_conn_reconnect() was called.  The link is probably dead so
+         * do not wait on a Forward Close, just drop the socket and start over
+         * without the retry wait.
+         */
+        if(session->reconnect_requested) {
+            session->reconnect_requested = 0;
+
+            pdebug(DEBUG_INFO, "Reconnect requested in state %d.", state);
+
+            switch(state) {
+            case SESSION_OPEN_SOCKET_WAIT:
+            case SESSION_REGISTER:
+            case SESSION_SEND_FORWARD_OPEN:
+            case SESSION_RECEIVE_FORWARD_OPEN:
+            case SESSION_IDLE:
+            case SESSION_DISCONNECT:
+            case SESSION_UNREGISTER:
+                state = SESSION_CLOSE_SOCKET;
+                retry_now = 1;
+                break;
+
+            case SESSION_CLOSE_SOCKET:
+            case SESSION_START_RETRY:
+                retry_now = 1;
+                break;
+
+            case SESSION_WAIT_RETRY:
+            case SESSION_WAIT_RECONNECT:
+                state = SESSION_OPEN_SOCKET_START;
+                break;
+
+            default:
+                /* already connecting. */
+                break;
+            }
+
+            auto_disconnect = 0;
+        }
+
         switch(state) {
         case SESSION_OPEN_SOCKET_START:
             pdebug(DEBUG_DETAIL, "in SESSION_OPEN_SOCKET_START state.");
@@ -1067,6 +1135,8 @@ THREAD_FUNC(session_handler)
                 } else {
                     pdebug(DEBUG_DETAIL, "Connect started, going to state SESSION_OPEN_SOCKET_WAIT.");
 
+                    timeout_time = time_ms() + session->connect_timeout_ms;
+
                     state = SESSION_OPEN_SOCKET_WAIT;
                 }
             }
@@ -1090,7 +1160,12 @@ THREAD_FUNC(session_handler)
 
                 state = SESSION_REGISTER;
             } else if(rc == PLCTAG_ERR_TIMEOUT) {
-                pdebug(DEBUG_DETAIL, "Still waiting for connection to succeed.");
+                if(timeout_time < time_ms()) {
+                    pdebug(DEBUG_WARN, "Session connect timed out after %dms!", session->connect_timeout_ms);
+                    state = SESSION_CLOSE_SOCKET;
+                } else {
+                    pdebug(DEBUG_DETAIL, "Still waiting for connection to succeed.");
+                }
 
                 /* don't wait more.  The TCP connect check will wait in select(). */
             } else {
@@ -1127,6 +1202,11 @@ THREAD_FUNC(session_handler)
                 state = SESSION_UNREGISTER;
             } else {
                 pdebug(DEBUG_DETAIL, "Send Forward Open succeeded, going to SESSION_RECEIVE_FORWARD_OPEN state.");
+
+                spin_block(&session->stats_lock) {
+                    session->stats.forward_opens++;
+                }
+
                 state = SESSION_RECEIVE_FORWARD_OPEN;
             }
             cond_signal(session->wait_cond);
@@ -1151,6 +1231,12 @@ THREAD_FUNC(session_handler)
                     pdebug(DEBUG_WARN, "Receive Forward Open failed %s!", plc_tag_decode_error(rc));
                     state = SESSION_UNREGISTER;
                 }
+
+                if(state == SESSION_SEND_FORWARD_OPEN) {
+                    spin_block(&session->stats_lock) {
+                        session->stats.forward_open_retries++;
+                    }
+                }
             } else {
                 pdebug(DEBUG_DETAIL, "Send Forward Open succeeded, going to SESSION_IDLE state.");
                 state = SESSION_IDLE;
@@ -1245,8 +1331,16 @@ THREAD_FUNC(session_handler)
         case SESSION_START_RETRY:
             pdebug(DEBUG_DETAIL, "in SESSION_START_RETRY state.");
 
-            /* FIXME - make this a tag attribute. */
-            timeout_time = time_ms() + RETRY_WAIT_MS;
+            if(retry_now) {
+                retry_now = 0;
+                timeout_time = time_ms();
+            } else {
+                timeout_time = time_ms() + session->retry_wait_ms;
+            }
+
+            spin_block(&session->stats_lock) {
+                session->stats.session_retries++;
+            }
 
             /* start waiting. */
             state = SESSION_WAIT_RETRY;
@@ -1380,7 +1474,10 @@ int process_requests(ab_session_p session)
     ab_request_p request = NULL;
     ab_request_p bundled_requests[MAX_REQUESTS] = {NULL};
     int num_bundled_requests = 0;
+    ab_request_p pipelined_requests[MAX_PIPELINED_REQUESTS] = {NULL};
+    int num_pipelined_requests = 0;
     int remaining_space = 0;
+    int64_t send_time_us = 0;
 
     debug_set_tag_id(0);
 
@@ -1410,7 +1507,20 @@ int process_requests(ab_session_p session)
             /* how much space do we have to work with. */
             remaining_space = session->max_payload_size - (int)sizeof(cip_multi_req_header);
 
-            if(vector_length(session->requests)) {
+            if(vector_length(session->requests) && ((ab_request_p)vector_get(session->requests, 0))->allow_pipelining) {
+                /* each pipelined request goes out in its own packet. */
+                do {
+                    request = (ab_request_p)vector_get(session->requests, 0);
+
+                    pipelined_requests[num_pipelined_requests] = request;
+                    num_pipelined_requests++;
+
+                    /* remove it from the queue. */
+                    vector_remove(session->requests, 0);
+                } while(vector_length(session->requests)
+                        && ((ab_request_p)vector_get(session->requests, 0))->allow_pipelining
+                        && num_pipelined_requests < MAX_PIPELINED_REQUESTS);
+            } else if(vector_length(session->requests)) {
                 do {
                     request = (ab_request_p)vector_get(session->requests, 0);
 
@@ -1439,6 +1549,13 @@ int process_requests(ab_session_p session)
     /* output debug display as no particular tag. */
     debug_set_tag_id(0);
 
+    if(num_pipelined_requests > 0) {
+        rc = process_pipelined_requests(session, pipelined_requests, num_pipelined_requests);
+
+        /* tickle the main tickler thread to note that we have responses. */
+        plc_tag_tickler_wake();
+    }
+
     if(num_bundled_requests > 0) {
 
         pdebug(DEBUG_INFO, "%d requests to process.", num_bundled_requests);
@@ -1457,6 +1574,8 @@ int process_requests(ab_session_p session)
                 break;
             }
 
+            send_time_us = time_us();
+
             /* send the request */
             if((rc = send_eip_request(session, SESSION_DEFAULT_TIMEOUT)) != PLCTAG_STATUS_OK) {
                 pdebug(DEBUG_WARN, "Error sending packet %s!", plc_tag_decode_error(rc));
@@ -1469,6 +1588,8 @@ int process_requests(ab_session_p session)
                 break;
             }
 
+            session_count_packet(session, num_bundled_requests, time_us() - send_time_us);
+
             /*
              * check the CIP status, but only if this is a bundled
              * response.   If it is a singleton, then we pass the
@@ -1517,6 +1638,10 @@ int process_requests(ab_session_p session)
 
         /* problem? clean up the pending requests and dump everything. */
         if(rc != PLCTAG_STATUS_OK) {
+            spin_block(&session->stats_lock) {
+                session->stats.failed_requests += (uint64_t)num_bundled_requests;
+            }
+
             for(int i=0; i < num_bundled_requests; i++) {
                 if(bundled_requests[i]) {
                     bundled_requests[i]->status = rc;
@@ -1540,6 +1665,105 @@ int process_requests(ab_session_p session)
 }
 
 
+/*
+ * process_pipelined_requests
+ *
+ * Send every request in its own packet before waiting for any response,
+ * then read the responses back in order.  The PLC answers a connection in
+ * sequence number order, so the requests share one round trip instead of
+ * paying one each.
+ */
+int process_pipelined_requests(ab_session_p session, ab_request_p *requests, int num_requests)
+{
+    int rc = PLCTAG_STATUS_OK;
+    uint16_t conn_seq_nums[MAX_PIPELINED_REQUESTS] = {0};
+    int64_t send_times_us[MAX_PIPELINED_REQUESTS] = {0};
+    int num_sent = 0;
+    int num_received = 0;
+    int num_failed = 0;
+
+    pdebug(DEBUG_INFO, "%d requests to pipeline.", num_requests);
+
+    for(num_sent = 0; num_sent < num_requests; num_sent++) {
+        rc = pack_requests(session, &requests[num_sent], 1);
+        if(rc != PLCTAG_STATUS_OK) {
+            pdebug(DEBUG_WARN, "Error while packing request, %s!", plc_tag_decode_error(rc));
+            break;
+        }
+
+        if((rc = prepare_request(session)) != PLCTAG_STATUS_OK) {
+            pdebug(DEBUG_WARN, "Unable to prepare request, %s!", plc_tag_decode_error(rc));
+            break;
+        }
+
+        conn_seq_nums[num_sent] = session->conn_seq_num;
+        send_times_us[num_sent] = time_us();
+
+        if((rc = send_eip_request(session, SESSION_DEFAULT_TIMEOUT)) != PLCTAG_STATUS_OK) {
+            pdebug(DEBUG_WARN, "Error sending packet %s!", plc_tag_decode_error(rc));
+            break;
+        }
+    }
+
+    /* only wait for the responses to packets that were sent. */
+    for(num_received = 0; rc == PLCTAG_STATUS_OK && num_received < num_sent; num_received++) {
+        eip_cip_co_resp *resp = NULL;
+
+        if((rc = recv_eip_response(session, SESSION_DEFAULT_TIMEOUT)) != PLCTAG_STATUS_OK) {
+            pdebug(DEBUG_WARN, "Error receiving packet response %s!", plc_tag_decode_error(rc));
+            break;
+        }
+
+        session_count_packet(session, 1, time_us() - send_times_us[num_received]);
+
+        resp = (eip_cip_co_resp *)(session->data);
+
+        if(le2h16(resp->encap_command) != AB_EIP_CONNECTED_SEND || le2h16(resp->cpf_conn_seq_num) != conn_seq_nums[num_received]) {
+            pdebug(DEBUG_WARN, "Expected a connected response with sequence ID %u!", conn_seq_nums[num_received]);
+            rc = PLCTAG_ERR_BAD_REPLY;
+            break;
+        }
+
+        debug_set_tag_id(requests[num_received]->tag_id);
+
+        rc = unpack_response(session, requests[num_received], 0);
+        if(rc != PLCTAG_STATUS_OK) {
+            pdebug(DEBUG_WARN, "Unable to unpack response!");
+            break;
+        }
+
+        /* release our reference */
+        requests[num_received] = (ab_request_p)rc_dec(requests[num_received]);
+    }
+
+    debug_set_tag_id(0);
+
+    /* problem? fail every request that was not answered, responses still on the wire are dropped with the connection. */
+    if(rc != PLCTAG_STATUS_OK) {
+        for(int i=0; i < num_requests; i++) {
+            if(requests[i]) {
+                requests[i]->status = rc;
+                requests[i]->request_size = 0;
+                requests[i]->resp_received = 1;
+
+                requests[i] = (ab_request_p)rc_dec(requests[i]);
+
+                num_failed++;
+            }
+        }
+
+        spin_block(&session->stats_lock) {
+            session->stats.failed_requests += (uint64_t)num_failed;
+        }
+    }
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return rc;
+}
+
+
+
 int unpack_response(ab_session_p session, ab_request_p request, int sub_packet)
 {
     int rc = PLCTAG_STATUS_OK;
@@ -1886,6 +2110,11 @@ int send_eip_request(ab_session_p session, int timeout)
     session->data_offset = 0;
     session->packet_count++;
 
+    spin_block(&session->stats_lock) {
+        session->stats.packets_sent++;
+        session->stats.bytes_sent += session->data_size;
+    }
+
     /* send the packet */
     do {
         rc = socket_write(session->sock,
@@ -2012,6 +2241,11 @@ int recv_eip_response(ab_session_p session, int timeout)
     session->resp_seq_id = le2h64(((eip_encap *)(session->data))->encap_sender_context);
     session->data_size = data_needed;
 
+    spin_block(&session->stats_lock) {
+        session->stats.packets_received++;
+        session->stats.bytes_received += data_needed;
+    }
+
     rc = PLCTAG_STATUS_OK;
 
     pdebug(DEBUG_INFO, "request received all needed data (%d bytes of %d).", session->data_offset, data_needed);
@@ -2595,6 +2829,165 @@ int session_request_increase_buffer(ab_request_p request, int new_capacity)
     return PLCTAG_STATUS_OK;
 }
 
+
+/*
+ * session_count_fragment_read
+ *
+ * Called by the tag code for each Read Tag Fragmented request that
+ * continues from a non-zero offset.
+ */
+void session_count_fragment_read(ab_session_p session)
+{
+    if(!session) {
+        return;
+    }
+
+    spin_block(&session->stats_lock) {
+        session->stats.fragment_reads++;
+    }
+}
+
+
+
+/*
+ * session_request_reconnect
+ *
+ * Ask the session thread to drop the connection and open it again.  Tags
+ * and queued requests are kept.
+ */
+void session_request_reconnect(ab_session_p session)
+{
+    if(!session) {
+        return;
+    }
+
+    session->reconnect_requested = 1;
+
+    cond_signal(session->wait_cond);
+}
+
+
+
+/*
+ * session_get_stats
+ *
+ * Copy the counters and compute the RTT summary under the stats lock.
+ */
+int session_get_stats(ab_session_p session, plc_tag_session_stats_t *stats)
+{
+    if(!session || !stats) {
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    spin_block(&session->stats_lock) {
+        *stats = session->stats;
+
+        if(stats->rtt_count > 0) {
+            stats->rtt_mean_us = (int64_t)(session->rtt_total_us / stats->rtt_count);
+            stats->rtt_p50_us = rtt_percentile(session, 50);
+            stats->rtt_p90_us = rtt_percentile(session, 90);
+            stats->rtt_p99_us = rtt_percentile(session, 99);
+        }
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+/*
+ * session_count_packet
+ *
+ * Record one request packet that completed its round trip.
+ */
+void session_count_packet(ab_session_p session, int num_requests, int64_t rtt_us)
+{
+    int bundle_bucket = 0;
+
+    if(rtt_us < 0) {
+        rtt_us = 0;
+    }
+
+    while(bundle_bucket < PLCTAG_STATS_BUNDLE_BUCKETS - 1 && (num_requests >> (bundle_bucket + 1)) > 0) {
+        bundle_bucket++;
+    }
+
+    spin_block(&session->stats_lock) {
+        session->stats.requests_sent += (uint64_t)num_requests;
+        session->stats.requests_per_packet[bundle_bucket]++;
+
+        if(session->stats.rtt_count == 0 || rtt_us < session->stats.rtt_min_us) {
+            session->stats.rtt_min_us = rtt_us;
+        }
+
+        if(rtt_us > session->stats.rtt_max_us) {
+            session->stats.rtt_max_us = rtt_us;
+        }
+
+        session->stats.rtt_count++;
+        session->rtt_total_us += (uint64_t)rtt_us;
+        session->rtt_hist[rtt_bucket_index(rtt_us)]++;
+    }
+}
+
+
+
+/* keep the top three bits of the value, SESSION_RTT_SUB_BUCKETS per power of two. */
+int rtt_bucket_index(int64_t rtt_us)
+{
+    int shift = 0;
+    int index = 0;
+
+    if(rtt_us < SESSION_RTT_LINEAR) {
+        return (int)rtt_us;
+    }
+
+    while((rtt_us >> shift) >= 2 * SESSION_RTT_SUB_BUCKETS) {
+        shift++;
+    }
+
+    index = SESSION_RTT_LINEAR + (shift - 1) * SESSION_RTT_SUB_BUCKETS + (int)(rtt_us >> shift) - SESSION_RTT_SUB_BUCKETS;
+
+    return index < SESSION_RTT_BUCKETS ? index : SESSION_RTT_BUCKETS - 1;
+}
+
+
+
+int64_t rtt_bucket_max(int index)
+{
+    int shift = 0;
+    int64_t top = 0;
+
+    if(index < SESSION_RTT_LINEAR) {
+        return index;
+    }
+
+    shift = (index - SESSION_RTT_LINEAR) / SESSION_RTT_SUB_BUCKETS + 1;
+    top = (index - SESSION_RTT_LINEAR) % SESSION_RTT_SUB_BUCKETS + SESSION_RTT_SUB_BUCKETS;
+
+    return ((top + 1) << shift) - 1;
+}
+
+
+
+/* must be called with the stats lock held. */
+int64_t rtt_percentile(ab_session_p session, int percent)
+{
+    uint64_t target = (session->stats.rtt_count * (uint64_t)percent + 99) / 100;
+    uint64_t count = 0;
+
+    for(int i=0; i < SESSION_RTT_BUCKETS; i++) {
+        count += session->rtt_hist[i];
+
+        if(count >= target) {
+            int64_t value = rtt_bucket_max(i);
+            return value < session->stats.rtt_max_us ? value : session->stats.rtt_max_us;
+        }
+    }
+
+    return session->stats.rtt_max_us;
+}
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
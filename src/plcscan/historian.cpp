@@ -0,0 +1,1962 @@
+/* LICENSE: See end of file for license information. */
+
+#include "historian.hpp"
+#include "../util/time_helper.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
+
+
+namespace tmh = time_helper;
+
+using Tag = plcscan::Tag;
+using UdtType = plcscan::UdtType;
+using UdtFieldType = plcscan::UdtFieldType;
+using PlcTagData = plcscan::PlcTagData;
+using TagType = plcscan::TagType;
+
+using RecorderConfig = historian::RecorderConfig;
+using RecorderStats = historian::RecorderStats;
+using MappedFile = historian::MappedFile;
+using CaptureSchema = historian::CaptureSchema;
+using BlockInfo = historian::BlockInfo;
+using Capture = historian::Capture;
+using CaptureBlock = historian::CaptureBlock;
+using ReplayConfig = historian::ReplayConfig;
+
+
+/*
+
+Capture file layout, little endian
+
+FileHeader
+Records, each a RecordHeader followed by size bytes
+    SCHEMA  tags and UDTs, rows after it use this layout
+    BLOCK   up to rows_per_block scans, one column per tag
+    INDEX   offsets of every SCHEMA and BLOCK, written by stop_recording()
+
+The file is only appended to.  If the recorder did not stop cleanly there is no INDEX
+and the records are read until the first one that is not complete.
+
+A BLOCK column lists the rows where the tag changed, then the values of those rows
+    RAW     the tag's bytes (strings, UDTs etc.)
+    DELTA   integers, zigzag varint of the difference with the previous row
+    XOR     REAL/LREAL, XOR with the previous row, a mask of the non zero bytes then those bytes
+The first row of a block is compared with zeros, so each block can be decoded alone.
+
+*/
+
+
+/* mapped file */
+
+namespace /* private */
+{
+    constexpr u64 MIN_MAP_BYTES = 64ull * 1024 * 1024;
+
+
+#ifdef _WIN32
+
+    static bool map_file(MappedFile& mf, u64 capacity)
+    {
+        auto file = (HANDLE)mf.file;
+
+        auto protect = mf.is_writable ? PAGE_READWRITE : PAGE_READONLY;
+        auto access = mf.is_writable ? FILE_MAP_WRITE : FILE_MAP_READ;
+
+        // a writable mapping larger than the file extends it
+        auto mapping = CreateFileMappingA(file, nullptr, protect, (DWORD)(capacity >> 32), (DWORD)capacity, nullptr);
+        if (!mapping)
+        {
+            return false;
+        }
+
+        auto data = MapViewOfFile(mapping, access, 0, 0, (SIZE_T)capacity);
+        if (!data)
+        {
+            CloseHandle(mapping);
+            return false;
+        }
+
+        mf.mapping = (intptr_t)mapping;
+        mf.data = (u8*)data;
+        mf.capacity = capacity;
+
+        return true;
+    }
+
+
+    static void unmap_file(MappedFile& mf)
+    {
+        if (mf.data)
+        {
+            UnmapViewOfFile(mf.data);
+        }
+
+        if (mf.mapping)
+        {
+            CloseHandle((HANDLE)mf.mapping);
+        }
+
+        mf.data = nullptr;
+        mf.mapping = 0;
+        mf.capacity = 0;
+    }
+
+
+    static bool create_file(cstr path, MappedFile& mf)
+    {
+        auto file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        mf = {};
+        mf.file = (intptr_t)file;
+        mf.is_writable = true;
+
+        return true;
+    }
+
+
+    static bool open_file(cstr path, MappedFile& mf)
+    {
+        auto file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(file, &size))
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        mf = {};
+        mf.file = (intptr_t)file;
+        mf.size = (u64)size.QuadPart;
+
+        return true;
+    }
+
+
+    static void close_file(MappedFile& mf)
+    {
+        unmap_file(mf);
+
+        auto file = (HANDLE)mf.file;
+
+        if (mf.is_writable)
+        {
+            // drop the unused part of the last mapping
+            LARGE_INTEGER size{};
+            size.QuadPart = (LONGLONG)mf.size;
+            SetFilePointerEx(file, size, nullptr, FILE_BEGIN);
+            SetEndOfFile(file);
+        }
+
+        CloseHandle(file);
+
+        mf = {};
+    }
+
+#else
+
+    static bool map_file(MappedFile& mf, u64 capacity)
+    {
+        auto fd = (int)mf.file;
+
+        if (mf.is_writable && ftruncate(fd, (off_t)capacity) != 0)
+        {
+            return false;
+        }
+
+        auto prot = mf.is_writable ? PROT_READ | PROT_WRITE : PROT_READ;
+
+        auto data = mmap(nullptr, (size_t)capacity, prot, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            return false;
+        }
+
+        mf.data = (u8*)data;
+        mf.capacity = capacity;
+
+        return true;
+    }
+
+
+    static void unmap_file(MappedFile& mf)
+    {
+        if (mf.data)
+        {
+            munmap(mf.data, (size_t)mf.capacity);
+        }
+
+        mf.data = nullptr;
+        mf.capacity = 0;
+    }
+
+
+    static bool create_file(cstr path, MappedFile& mf)
+    {
+        auto fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        mf = {};
+        mf.file = (intptr_t)fd;
+        mf.is_writable = true;
+
+        return true;
+    }
+
+
+    static bool open_file(cstr path, MappedFile& mf)
+    {
+        auto fd = open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat st{};
+        if (fstat(fd, &st) != 0)
+        {
+            close(fd);
+            return false;
+        }
+
+        mf = {};
+        mf.file = (intptr_t)fd;
+        mf.size = (u64)st.st_size;
+
+        return true;
+    }
+
+
+    static void close_file(MappedFile& mf)
+    {
+        unmap_file(mf);
+
+        auto fd = (int)mf.file;
+
+        if (mf.is_writable)
+        {
+            // drop the unused part of the last mapping
+            (void)ftruncate(fd, (off_t)mf.size);
+        }
+
+        close(fd);
+
+        mf = {};
+    }
+
+#endif
+
+
+    // makes room for n_bytes more, the mapping moves when it grows
+    static bool reserve_file(MappedFile& mf, u64 n_bytes)
+    {
+        auto required = mf.size + n_bytes;
+
+        if (required <= mf.capacity)
+        {
+            return true;
+        }
+
+        auto capacity = std::max(std::max(mf.capacity * 2, MIN_MAP_BYTES), required);
+
+        unmap_file(mf);
+
+        return map_file(mf, capacity);
+    }
+
+
+    static bool append_bytes(MappedFile& mf, void const* src, u64 n_bytes)
+    {
+        if (!reserve_file(mf, n_bytes))
+        {
+            return false;
+        }
+
+        memcpy(mf.data + mf.size, src, (size_t)n_bytes);
+        mf.size += n_bytes;
+
+        return true;
+    }
+}
+
+
+/* file format */
+
+namespace /* private */
+{
+    constexpr char FILE_MAGIC[8] = { 'P', 'L', 'C', 'H', 'I', 'S', 'T', 0 };
+    constexpr u32 FILE_VERSION = 1;
+
+
+    class FileHeader
+    {
+    public:
+        char magic[8] = { 0 };
+        u32 version = 0;
+        u32 header_size = 0;
+
+        // 0 until stop_recording()
+        u64 index_offset = 0;
+
+        u64 created_us = 0;
+
+        u64 reserved[4] = { 0 };
+    };
+
+    static_assert(sizeof(FileHeader) == 64);
+
+
+    enum class RecordKind : u32
+    {
+        NONE = 0,
+        SCHEMA = 1,
+        BLOCK = 2,
+        INDEX = 3
+    };
+
+
+    class RecordHeader
+    {
+    public:
+        RecordKind kind = RecordKind::NONE;
+        u32 schema_id = 0;
+
+        // bytes after the header
+        u64 size = 0;
+    };
+
+    static_assert(sizeof(RecordHeader) == 16);
+
+
+    class SchemaHeader
+    {
+    public:
+        u32 n_tags = 0;
+        u32 n_udts = 0;
+        u32 n_fields = 0;
+        u32 strings_size = 0;
+    };
+
+
+    // string members are offsets into the schema strings
+    class SchemaTag
+    {
+    public:
+        u32 type_id = 0;
+        u32 array_count = 0;
+        u32 size = 0;
+        u32 encoding = 0;
+        u32 name = 0;
+        u32 type_name = 0;
+    };
+
+
+    class SchemaUdt
+    {
+    public:
+        u32 type_id = 0;
+        u32 size = 0;
+        u32 name = 0;
+        u32 description = 0;
+        u32 n_fields = 0;
+        u32 reserved = 0;
+    };
+
+
+    class SchemaField
+    {
+    public:
+        u32 type_id = 0;
+        u32 offset = 0;
+        u32 array_count = 0;
+        i32 bit_number = -1;
+        u32 name = 0;
+        u32 type_name = 0;
+    };
+
+
+    class BlockHeader
+    {
+    public:
+        u32 n_rows = 0;
+        u32 n_tags = 0;
+
+        u64 first_us = 0;
+        u64 last_us = 0;
+    };
+
+
+    class IndexEntry
+    {
+    public:
+        RecordKind kind = RecordKind::NONE;
+        u32 schema_id = 0;
+        u32 n_rows = 0;
+        u32 reserved = 0;
+
+        u64 offset = 0;
+        u64 first_us = 0;
+        u64 last_us = 0;
+    };
+
+
+    enum class Encoding : u32
+    {
+        RAW = 0,
+        DELTA = 1,
+        XOR = 2
+    };
+
+
+    template <typename T>
+    static void push_struct(List<u8>& out, T const& value)
+    {
+        auto begin = (u8 const*)&value;
+        out.insert(out.end(), begin, begin + sizeof(T));
+    }
+
+
+    template <typename T>
+    static bool read_struct(u8 const*& p, u8 const* end, T& value)
+    {
+        if ((u64)(end - p) < sizeof(T))
+        {
+            return false;
+        }
+
+        memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+
+        return true;
+    }
+
+
+    static u64 timestamp_us()
+    {
+        namespace chr = std::chrono;
+
+        return (u64)chr::duration_cast<chr::microseconds>(chr::system_clock::now().time_since_epoch()).count();
+    }
+}
+
+
+/* value encoding */
+
+namespace /* private */
+{
+    static void push_varint(List<u8>& out, u64 value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back((u8)(value | 0x80));
+            value >>= 7;
+        }
+
+        out.push_back((u8)value);
+    }
+
+
+    static bool read_varint(u8 const*& p, u8 const* end, u64& value)
+    {
+        value = 0;
+
+        for (u32 shift = 0; shift < 64 && p < end; shift += 7)
+        {
+            auto b = *p++;
+
+            value |= (u64)(b & 0x7F) << shift;
+
+            if (!(b & 0x80))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    static u64 load_value(u8 const* src, u32 size)
+    {
+        u64 value = 0;
+        memcpy(&value, src, size);
+
+        return value;
+    }
+
+
+    static void store_value(u64 value, u8* dst, u32 size)
+    {
+        memcpy(dst, &value, size);
+    }
+
+
+    static i64 sign_extend(u64 value, u32 size)
+    {
+        auto shift = 64 - 8 * size;
+
+        return (i64)(value << shift) >> shift;
+    }
+
+
+    static u64 zigzag(i64 value)
+    {
+        return ((u64)value << 1) ^ (u64)(value >> 63);
+    }
+
+
+    static i64 unzigzag(u64 value)
+    {
+        return (i64)(value >> 1) ^ -(i64)(value & 1);
+    }
+
+
+    static void get_encoding(Tag const& tag, Encoding& encoding, u32& elem_size)
+    {
+        encoding = Encoding::RAW;
+        elem_size = tag.size();
+
+        u32 size = 0;
+        auto e = Encoding::DELTA;
+
+        switch (plcscan::get_tag_type(tag.type_id))
+        {
+        case TagType::BOOL:
+        case TagType::SINT:
+        case TagType::USINT: size = 1; break;
+
+        case TagType::INT:
+        case TagType::UINT: size = 2; break;
+
+        case TagType::DINT:
+        case TagType::UDINT: size = 4; break;
+
+        case TagType::LINT:
+        case TagType::ULINT: size = 8; break;
+
+        case TagType::REAL: size = 4; e = Encoding::XOR; break;
+        case TagType::LREAL: size = 8; e = Encoding::XOR; break;
+
+        default: return;
+        }
+
+        auto count = tag.array_count ? tag.array_count : 1;
+
+        if (tag.size() != size * count)
+        {
+            return;
+        }
+
+        encoding = e;
+        elem_size = size;
+    }
+
+
+    static void encode_value(Encoding encoding, u32 elem_size, u32 size, u8 const* cur, u8 const* prev, List<u8>& out)
+    {
+        switch (encoding)
+        {
+        case Encoding::DELTA:
+            for (u32 i = 0; i < size; i += elem_size)
+            {
+                auto a = (u64)sign_extend(load_value(cur + i, elem_size), elem_size);
+                auto b = (u64)sign_extend(load_value(prev + i, elem_size), elem_size);
+
+                push_varint(out, zigzag((i64)(a - b)));
+            }
+            break;
+
+        case Encoding::XOR:
+            for (u32 i = 0; i < size; i += elem_size)
+            {
+                auto x = load_value(cur + i, elem_size) ^ load_value(prev + i, elem_size);
+
+                u8 mask = 0;
+                for (u32 b = 0; b < elem_size; ++b)
+                {
+                    mask |= (u8)(((x >> (8 * b)) & 0xFF) != 0) << b;
+                }
+
+                out.push_back(mask);
+
+                for (u32 b = 0; b < elem_size; ++b)
+                {
+                    if (mask & (1 << b))
+                    {
+                        out.push_back((u8)(x >> (8 * b)));
+                    }
+                }
+            }
+            break;
+
+        default:
+            out.insert(out.end(), cur, cur + size);
+            break;
+        }
+    }
+
+
+    // prev and dst can be the same
+    static bool decode_value(Encoding encoding, u32 elem_size, u32 size, u8 const*& p, u8 const* end, u8 const* prev, u8* dst)
+    {
+        switch (encoding)
+        {
+        case Encoding::DELTA:
+            for (u32 i = 0; i < size; i += elem_size)
+            {
+                u64 d = 0;
+                if (!read_varint(p, end, d))
+                {
+                    return false;
+                }
+
+                auto b = (u64)sign_extend(load_value(prev + i, elem_size), elem_size);
+
+                store_value(b + (u64)unzigzag(d), dst + i, elem_size);
+            }
+            return true;
+
+        case Encoding::XOR:
+            for (u32 i = 0; i < size; i += elem_size)
+            {
+                if (p >= end)
+                {
+                    return false;
+                }
+
+                auto mask = *p++;
+
+                u64 x = 0;
+                for (u32 b = 0; b < elem_size; ++b)
+                {
+                    if (!(mask & (1 << b)))
+                    {
+                        continue;
+                    }
+
+                    if (p >= end)
+                    {
+                        return false;
+                    }
+
+                    x |= (u64)(*p++) << (8 * b);
+                }
+
+                store_value(load_value(prev + i, elem_size) ^ x, dst + i, elem_size);
+            }
+            return true;
+
+        default:
+            if ((u64)(end - p) < size)
+            {
+                return false;
+            }
+
+            memmove(dst, p, size);
+            p += size;
+            return true;
+        }
+    }
+}
+
+
+/* recorder schema */
+
+namespace /* private */
+{
+    class TagColumn
+    {
+    public:
+        Encoding encoding = Encoding::RAW;
+        u32 elem_size = 0;
+        u32 size = 0;
+        u32 value_offset = 0;
+
+        // rows of the current block where the tag changed, and their values
+        List<u16> changed_rows;
+        List<u8> values;
+    };
+
+
+    class WriterSchema
+    {
+    public:
+        u32 schema_id = 0;
+        u32 row_size = 0;
+
+        List<TagColumn> columns;
+
+        // SCHEMA record payload
+        List<u8> payload;
+    };
+
+
+    class StringPool
+    {
+    public:
+        List<char> chars;
+        std::unordered_map<std::string_view, u32> offsets;
+    };
+
+
+    // the views point to the tag and UDT names, which outlive the pool
+    static u32 push_string(StringView const& str, StringPool& pool)
+    {
+        std::string_view key = str.data() ? std::string_view(str.data(), str.length) : std::string_view();
+
+        auto it = pool.offsets.find(key);
+        if (it != pool.offsets.end())
+        {
+            return it->second;
+        }
+
+        auto offset = (u32)pool.chars.size();
+
+        pool.chars.insert(pool.chars.end(), key.begin(), key.end());
+        pool.chars.push_back(0);
+
+        pool.offsets.emplace(key, offset);
+
+        return offset;
+    }
+
+
+    static void build_writer_schema(PlcTagData const& data, u32 schema_id, WriterSchema& schema)
+    {
+        schema.schema_id = schema_id;
+        schema.row_size = 0;
+        schema.columns.clear();
+        schema.payload.clear();
+
+        StringPool pool;
+
+        List<SchemaTag> tags;
+        List<SchemaUdt> udts;
+        List<SchemaField> fields;
+
+        tags.reserve(data.tags.size());
+        schema.columns.reserve(data.tags.size());
+
+        for (auto const& tag : data.tags)
+        {
+            TagColumn col{};
+            get_encoding(tag, col.encoding, col.elem_size);
+            col.size = tag.size();
+            col.value_offset = schema.row_size;
+
+            schema.row_size += col.size;
+            schema.columns.push_back(col);
+
+            SchemaTag st{};
+            st.type_id = tag.type_id;
+            st.array_count = tag.array_count;
+            st.size = tag.size();
+            st.encoding = (u32)col.encoding;
+            st.name = push_string(tag.tag_name, pool);
+            st.type_name = push_string(tag.data_type_name, pool);
+
+            tags.push_back(st);
+        }
+
+        for (auto const& udt : data.udt_types)
+        {
+            SchemaUdt su{};
+            su.type_id = udt.type_id;
+            su.size = udt.size;
+            su.name = push_string(udt.udt_name, pool);
+            su.description = push_string(udt.udt_description, pool);
+            su.n_fields = (u32)udt.fields.size();
+
+            udts.push_back(su);
+
+            for (auto const& field : udt.fields)
+            {
+                SchemaField sf{};
+                sf.type_id = field.type_id;
+                sf.offset = field.offset;
+                sf.array_count = field.array_count;
+                sf.bit_number = field.bit_number;
+                sf.name = push_string(field.field_name, pool);
+                sf.type_name = push_string(field.data_type_name, pool);
+
+                fields.push_back(sf);
+            }
+        }
+
+        SchemaHeader header{};
+        header.n_tags = (u32)tags.size();
+        header.n_udts = (u32)udts.size();
+        header.n_fields = (u32)fields.size();
+        header.strings_size = (u32)pool.chars.size();
+
+        auto& out = schema.payload;
+        out.reserve(sizeof(header) + tags.size() * sizeof(SchemaTag) + udts.size() * sizeof(SchemaUdt) + fields.size() * sizeof(SchemaField) + pool.chars.size());
+
+        push_struct(out, header);
+
+        for (auto const& t : tags) { push_struct(out, t); }
+        for (auto const& u : udts) { push_struct(out, u); }
+        for (auto const& f : fields) { push_struct(out, f); }
+
+        out.insert(out.end(), pool.chars.begin(), pool.chars.end());
+    }
+}
+
+
+/* recorder */
+
+namespace /* private */
+{
+    class Snapshot
+    {
+    public:
+        u64 timestamp_us = 0;
+
+        // tag values in schema order
+        List<u8> values;
+
+        // the tag list changed, the writer switches to this schema first
+        bool has_schema = false;
+        WriterSchema schema;
+    };
+
+
+    class Recorder
+    {
+    public:
+        RecorderConfig config;
+
+        MappedFile file;
+
+        std::thread writer;
+        std::mutex mutex;
+        std::condition_variable cv;
+
+        // guarded by mutex
+        bool is_stopping = false;
+        List<u32> queue;
+        List<u32> free_slots;
+
+        List<Snapshot> slots;
+
+        // scan thread
+        bool is_recording = false;
+        bool has_schema = false;
+        u32 tag_list_version = 0;
+        u32 n_tags = 0;
+        u32 row_size = 0;
+        u32 next_schema_id = 0;
+
+        // writer thread
+        WriterSchema schema;
+        List<u8> prev_row;
+        List<u64> timestamps;
+        u64 block_value_bytes = 0;
+        List<u8> block_buffer;
+        List<IndexEntry> index;
+        bool has_file_error = false;
+
+        // stats
+        std::atomic<u64> n_recorded = 0;
+        std::atomic<u64> n_dropped = 0;
+        std::atomic<u64> n_blocks = 0;
+        std::atomic<u64> value_bytes = 0;
+        std::atomic<u64> file_bytes = 0;
+        std::atomic<f64> last_record_ms = 0.0;
+        std::atomic<f64> max_record_ms = 0.0;
+    };
+
+
+    static Recorder g_rec;
+
+
+    static bool append_record(Recorder& rec, RecordKind kind, u32 schema_id, List<u8> const& payload, u64& offset)
+    {
+        if (rec.has_file_error)
+        {
+            return false;
+        }
+
+        RecordHeader header{};
+        header.kind = kind;
+        header.schema_id = schema_id;
+        header.size = payload.size();
+
+        offset = rec.file.size;
+
+        rec.has_file_error =
+            !reserve_file(rec.file, sizeof(header) + payload.size()) ||
+            !append_bytes(rec.file, &header, sizeof(header)) ||
+            !append_bytes(rec.file, payload.data(), payload.size());
+
+        rec.file_bytes = rec.file.size;
+
+        return !rec.has_file_error;
+    }
+
+
+    static void reset_block(Recorder& rec)
+    {
+        for (auto& col : rec.schema.columns)
+        {
+            col.changed_rows.clear();
+            col.values.clear();
+        }
+
+        rec.prev_row.assign(rec.schema.row_size, 0);
+        rec.timestamps.clear();
+        rec.block_value_bytes = 0;
+    }
+
+
+    static void flush_block(Recorder& rec)
+    {
+        auto n_rows = (u32)rec.timestamps.size();
+        if (!n_rows)
+        {
+            return;
+        }
+
+        auto& out = rec.block_buffer;
+        out.clear();
+
+        BlockHeader header{};
+        header.n_rows = n_rows;
+        header.n_tags = (u32)rec.schema.columns.size();
+        header.first_us = rec.timestamps.front();
+        header.last_us = rec.timestamps.back();
+
+        push_struct(out, header);
+
+        for (auto ts : rec.timestamps)
+        {
+            push_varint(out, ts - header.first_us);
+        }
+
+        auto bitmap_size = (n_rows + 7) / 8;
+
+        for (auto const& col : rec.schema.columns)
+        {
+            push_varint(out, col.changed_rows.size());
+
+            if (col.changed_rows.empty())
+            {
+                continue;
+            }
+
+            auto bitmap = out.size();
+            out.resize(out.size() + bitmap_size, 0);
+
+            for (auto r : col.changed_rows)
+            {
+                out[bitmap + r / 8] |= (u8)(1 << (r % 8));
+            }
+
+            push_varint(out, col.values.size());
+            out.insert(out.end(), col.values.begin(), col.values.end());
+        }
+
+        u64 offset = 0;
+        if (append_record(rec, RecordKind::BLOCK, rec.schema.schema_id, out, offset))
+        {
+            IndexEntry entry{};
+            entry.kind = RecordKind::BLOCK;
+            entry.schema_id = rec.schema.schema_id;
+            entry.n_rows = n_rows;
+            entry.offset = offset;
+            entry.first_us = header.first_us;
+            entry.last_us = header.last_us;
+
+            rec.index.push_back(entry);
+            rec.n_blocks++;
+        }
+
+        reset_block(rec);
+    }
+
+
+    static void write_schema(Recorder& rec, WriterSchema& schema)
+    {
+        flush_block(rec);
+
+        u64 offset = 0;
+        if (append_record(rec, RecordKind::SCHEMA, schema.schema_id, schema.payload, offset))
+        {
+            IndexEntry entry{};
+            entry.kind = RecordKind::SCHEMA;
+            entry.schema_id = schema.schema_id;
+            entry.offset = offset;
+
+            rec.index.push_back(entry);
+        }
+
+        std::swap(rec.schema, schema);
+
+        reset_block(rec);
+    }
+
+
+    static void write_row(Recorder& rec, Snapshot& snapshot)
+    {
+        if (snapshot.has_schema)
+        {
+            write_schema(rec, snapshot.schema);
+        }
+
+        if (snapshot.values.size() != rec.schema.row_size)
+        {
+            return;
+        }
+
+        auto row = (u16)rec.timestamps.size();
+
+        auto cur_row = snapshot.values.data();
+        auto prev_row = rec.prev_row.data();
+
+        for (auto& col : rec.schema.columns)
+        {
+            auto cur = cur_row + col.value_offset;
+            auto prev = prev_row + col.value_offset;
+
+            if (!memcmp(cur, prev, col.size))
+            {
+                continue;
+            }
+
+            auto n_values = col.values.size();
+
+            col.changed_rows.push_back(row);
+            encode_value(col.encoding, col.elem_size, col.size, cur, prev, col.values);
+
+            rec.block_value_bytes += col.values.size() - n_values;
+        }
+
+        std::swap(rec.prev_row, snapshot.values);
+
+        rec.timestamps.push_back(snapshot.timestamp_us);
+
+        if (rec.timestamps.size() >= rec.config.rows_per_block || rec.block_value_bytes >= rec.config.max_block_bytes)
+        {
+            flush_block(rec);
+        }
+    }
+
+
+    static void write_index(Recorder& rec)
+    {
+        List<u8> payload;
+        payload.reserve(rec.index.size() * sizeof(IndexEntry));
+
+        for (auto const& entry : rec.index)
+        {
+            push_struct(payload, entry);
+        }
+
+        u64 offset = 0;
+        if (!append_record(rec, RecordKind::INDEX, 0, payload, offset))
+        {
+            return;
+        }
+
+        FileHeader header{};
+        memcpy(&header, rec.file.data, sizeof(header));
+        header.index_offset = offset;
+        memcpy(rec.file.data, &header, sizeof(header));
+    }
+
+
+    static void run_writer(Recorder& rec)
+    {
+        List<u32> batch;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(rec.mutex);
+                rec.cv.wait(lock, [&]() { return !rec.queue.empty() || rec.is_stopping; });
+
+                if (rec.queue.empty())
+                {
+                    break;
+                }
+
+                std::swap(batch, rec.queue);
+            }
+
+            for (auto id : batch)
+            {
+                write_row(rec, rec.slots[id]);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(rec.mutex);
+                rec.free_slots.insert(rec.free_slots.end(), batch.begin(), batch.end());
+            }
+
+            batch.clear();
+        }
+
+        flush_block(rec);
+        write_index(rec);
+    }
+
+
+    static void destroy_recorder(Recorder& rec)
+    {
+        if (rec.file.file >= 0)
+        {
+            close_file(rec.file);
+        }
+
+        rec.slots = {};
+        rec.queue = {};
+        rec.free_slots = {};
+        rec.schema = {};
+        rec.prev_row = {};
+        rec.timestamps = {};
+        rec.block_buffer = {};
+        rec.index = {};
+    }
+
+
+    static void update_record_time(Recorder& rec, f64 ms)
+    {
+        rec.last_record_ms = ms;
+
+        if (ms > rec.max_record_ms)
+        {
+            rec.max_record_ms = ms;
+        }
+    }
+}
+
+
+/* capture */
+
+namespace /* private */
+{
+    static bool in_file(MappedFile const& mf, u64 offset, u64 size)
+    {
+        return offset <= mf.size && size <= mf.size - offset;
+    }
+
+
+    static StringView to_string_view(char const* strings, u32 strings_size, u32 offset)
+    {
+        StringView view{};
+
+        if (offset < strings_size)
+        {
+            view.char_data = (char*)(strings + offset);
+            view.length = (u32)strnlen(view.char_data, strings_size - offset);
+        }
+
+        return view;
+    }
+
+
+    static bool parse_schema(MappedFile const& mf, u64 offset, CaptureSchema& schema)
+    {
+        RecordHeader rh{};
+        if (!in_file(mf, offset, sizeof(rh)))
+        {
+            return false;
+        }
+
+        memcpy(&rh, mf.data + offset, sizeof(rh));
+
+        if (rh.kind != RecordKind::SCHEMA || !in_file(mf, offset + sizeof(rh), rh.size))
+        {
+            return false;
+        }
+
+        auto p = (u8 const*)mf.data + offset + sizeof(rh);
+        auto end = p + rh.size;
+
+        SchemaHeader header{};
+        if (!read_struct(p, end, header))
+        {
+            return false;
+        }
+
+        auto table_size = (u64)header.n_tags * sizeof(SchemaTag) + (u64)header.n_udts * sizeof(SchemaUdt) + (u64)header.n_fields * sizeof(SchemaField);
+        if (table_size + header.strings_size > (u64)(end - p))
+        {
+            return false;
+        }
+
+        auto strings = (char const*)(p + table_size);
+        auto const str = [&](u32 s) { return to_string_view(strings, header.strings_size, s); };
+
+        schema = {};
+        schema.schema_id = rh.schema_id;
+        schema.tags.reserve(header.n_tags);
+        schema.value_offsets.reserve(header.n_tags);
+
+        for (u32 i = 0; i < header.n_tags; ++i)
+        {
+            SchemaTag st{};
+            read_struct(p, end, st);
+
+            Tag tag{};
+            tag.type_id = st.type_id;
+            tag.array_count = st.array_count;
+            tag.tag_name = str(st.name);
+            tag.data_type_name = str(st.type_name);
+            tag.value_bytes.length = st.size;
+
+            schema.tags.push_back(tag);
+            schema.value_offsets.push_back(schema.row_size);
+            schema.row_size += st.size;
+        }
+
+        List<SchemaUdt> udts(header.n_udts);
+        for (auto& su : udts)
+        {
+            read_struct(p, end, su);
+        }
+
+        schema.udt_types.reserve(header.n_udts);
+        schema.udt_fields.reserve(header.n_fields);
+
+        u32 n_fields = 0;
+
+        for (auto const& su : udts)
+        {
+            UdtType udt{};
+            udt.type_id = su.type_id;
+            udt.size = su.size;
+            udt.udt_name = str(su.name);
+            udt.udt_description = str(su.description);
+            udt.fields.first = n_fields;
+
+            for (u32 i = 0; i < su.n_fields && n_fields < header.n_fields; ++i, ++n_fields)
+            {
+                SchemaField sf{};
+                read_struct(p, end, sf);
+
+                UdtFieldType field{};
+                field.type_id = sf.type_id;
+                field.offset = sf.offset;
+                field.array_count = sf.array_count;
+                field.bit_number = sf.bit_number;
+                field.field_name = str(sf.name);
+                field.data_type_name = str(sf.type_name);
+
+                schema.udt_fields.push_back(field);
+            }
+
+            udt.fields.count = n_fields - udt.fields.first;
+
+            schema.udt_types.push_back(udt);
+        }
+
+        return n_fields == header.n_fields;
+    }
+
+
+    static bool read_block_info(MappedFile const& mf, u64 offset, BlockInfo& info)
+    {
+        RecordHeader rh{};
+        BlockHeader header{};
+
+        if (!in_file(mf, offset, sizeof(rh)))
+        {
+            return false;
+        }
+
+        memcpy(&rh, mf.data + offset, sizeof(rh));
+
+        if (rh.kind != RecordKind::BLOCK || rh.size < sizeof(header) || !in_file(mf, offset + sizeof(rh), rh.size))
+        {
+            return false;
+        }
+
+        memcpy(&header, mf.data + offset + sizeof(rh), sizeof(header));
+
+        info.file_offset = offset;
+        info.schema_id = rh.schema_id;
+        info.n_rows = header.n_rows;
+        info.first_us = header.first_us;
+        info.last_us = header.last_us;
+
+        return true;
+    }
+
+
+    static bool add_record(Capture& capture, RecordKind kind, u64 offset)
+    {
+        if (kind == RecordKind::SCHEMA)
+        {
+            CaptureSchema schema{};
+            if (!parse_schema(capture.file, offset, schema))
+            {
+                return false;
+            }
+
+            capture.schemas.push_back(std::move(schema));
+            return true;
+        }
+
+        BlockInfo info{};
+        if (!read_block_info(capture.file, offset, info))
+        {
+            return false;
+        }
+
+        capture.blocks.push_back(info);
+        return true;
+    }
+
+
+    static bool read_index(Capture& capture, u64 index_offset)
+    {
+        auto& mf = capture.file;
+
+        RecordHeader rh{};
+        if (!index_offset || !in_file(mf, index_offset, sizeof(rh)))
+        {
+            return false;
+        }
+
+        memcpy(&rh, mf.data + index_offset, sizeof(rh));
+
+        if (rh.kind != RecordKind::INDEX || !in_file(mf, index_offset + sizeof(rh), rh.size))
+        {
+            return false;
+        }
+
+        auto p = (u8 const*)mf.data + index_offset + sizeof(rh);
+        auto end = p + rh.size;
+
+        IndexEntry entry{};
+        while (read_struct(p, end, entry))
+        {
+            if (!add_record(capture, entry.kind, entry.offset))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    // the recorder did not finish, read up to the first incomplete record
+    static void scan_records(Capture& capture, u64 offset)
+    {
+        auto& mf = capture.file;
+
+        RecordHeader rh{};
+
+        while (in_file(mf, offset, sizeof(rh)))
+        {
+            memcpy(&rh, mf.data + offset, sizeof(rh));
+
+            if (!in_file(mf, offset + sizeof(rh), rh.size))
+            {
+                return;
+            }
+
+            if ((rh.kind == RecordKind::SCHEMA || rh.kind == RecordKind::BLOCK) && !add_record(capture, rh.kind, offset))
+            {
+                return;
+            }
+
+            if (rh.kind == RecordKind::NONE)
+            {
+                return;
+            }
+
+            offset += sizeof(rh) + rh.size;
+        }
+    }
+
+
+    static bool decode_block(Capture const& capture, BlockInfo const& info, CaptureSchema const& schema, CaptureBlock& block)
+    {
+        auto& mf = capture.file;
+
+        RecordHeader rh{};
+        memcpy(&rh, mf.data + info.file_offset, sizeof(rh));
+
+        auto p = (u8 const*)mf.data + info.file_offset + sizeof(rh);
+        auto end = p + rh.size;
+
+        BlockHeader header{};
+        if (!read_struct(p, end, header) || header.n_tags != (u32)schema.tags.size())
+        {
+            return false;
+        }
+
+        auto n_rows = header.n_rows;
+        auto row_size = schema.row_size;
+
+        block.schema_id = schema.schema_id;
+        block.row_size = row_size;
+        block.n_rows = n_rows;
+        block.timestamps_us.resize(n_rows);
+        block.values.assign((size_t)n_rows * row_size, 0);
+
+        for (u32 r = 0; r < n_rows; ++r)
+        {
+            u64 delta = 0;
+            if (!read_varint(p, end, delta))
+            {
+                return false;
+            }
+
+            block.timestamps_us[r] = header.first_us + delta;
+        }
+
+        auto bitmap_size = (n_rows + 7) / 8;
+
+        for (u32 i = 0; i < header.n_tags; ++i)
+        {
+            u64 n_changed = 0;
+            if (!read_varint(p, end, n_changed))
+            {
+                return false;
+            }
+
+            if (!n_changed)
+            {
+                continue; /* zero in every row */
+            }
+
+            auto bitmap = p;
+
+            u64 values_size = 0;
+            if ((u64)(end - p) < bitmap_size || (p += bitmap_size, !read_varint(p, end, values_size)) || (u64)(end - p) < values_size)
+            {
+                return false;
+            }
+
+            auto v = p;
+            auto v_end = p + values_size;
+            p = v_end;
+
+            Encoding encoding{};
+            u32 elem_size = 0;
+            get_encoding(schema.tags[i], encoding, elem_size);
+
+            auto size = schema.tags[i].size();
+            auto dst = block.values.data() + schema.value_offsets[i];
+
+            for (u32 r = 0; r < n_rows; ++r, dst += row_size)
+            {
+                // the first row is compared with zeros
+                auto prev = r ? dst - row_size : dst;
+
+                if (bitmap[r / 8] & (1 << (r % 8)))
+                {
+                    if (!decode_value(encoding, elem_size, size, v, v_end, prev, dst))
+                    {
+                        return false;
+                    }
+                }
+                else if (r)
+                {
+                    memcpy(dst, prev, size);
+                }
+            }
+        }
+
+        return true;
+    }
+}
+
+
+/* replay */
+
+namespace /* private */
+{
+    constexpr u32 NO_SCHEMA = (u32)-1;
+
+
+    class ReplayState
+    {
+    public:
+        PlcTagData data;
+
+        // values of the current row, the tags point here
+        List<u8> values;
+
+        u32 schema_id = NO_SCHEMA;
+    };
+
+
+    static void load_schema(CaptureSchema const& schema, ReplayState& rs)
+    {
+        auto& data = rs.data;
+
+        if (rs.schema_id != NO_SCHEMA)
+        {
+            data.tag_list_version++;
+        }
+
+        rs.schema_id = schema.schema_id;
+        rs.values.assign(schema.row_size, 0);
+
+        data.tags = schema.tags;
+        data.udt_types = schema.udt_types;
+        data.udt_fields = schema.udt_fields;
+
+        for (u32 i = 0; i < (u32)data.tags.size(); ++i)
+        {
+            auto& tag = data.tags[i];
+            tag.value_bytes.data = rs.values.data() + schema.value_offsets[i];
+            tag.health = plcscan::TagHealth::OK;
+        }
+
+        plcscan::update_udt_lookups(data);
+    }
+
+
+    static void load_row(u8 const* row, ReplayState& rs)
+    {
+        auto& data = rs.data;
+
+        data.changed_tags.clear();
+
+        for (u32 i = 0; i < (u32)data.tags.size(); ++i)
+        {
+            auto const& tag = data.tags[i];
+            auto src = row + (tag.data() - rs.values.data());
+
+            if (memcmp(src, tag.data(), tag.size()))
+            {
+                memcpy(tag.data(), src, tag.size());
+                data.changed_tags.push_back(i);
+            }
+        }
+    }
+}
+
+
+/* api */
+
+namespace historian
+{
+    bool start_recording(cstr file_path, PlcTagData const& data, RecorderConfig const& config)
+    {
+        auto& rec = g_rec;
+
+        if (rec.is_recording || !data.is_connected)
+        {
+            return false;
+        }
+
+        if (!create_file(file_path, rec.file))
+        {
+            return false;
+        }
+
+        FileHeader header{};
+        memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+        header.version = FILE_VERSION;
+        header.header_size = (u32)sizeof(header);
+        header.created_us = timestamp_us();
+
+        if (!append_bytes(rec.file, &header, sizeof(header)))
+        {
+            destroy_recorder(rec);
+            return false;
+        }
+
+        rec.config = config;
+        rec.config.max_queued_snapshots = std::max(config.max_queued_snapshots, 1u);
+        rec.config.rows_per_block = std::clamp(config.rows_per_block, 1u, 0xFFFFu);
+
+        rec.slots.resize(rec.config.max_queued_snapshots);
+        rec.free_slots.clear();
+        for (u32 i = 0; i < rec.config.max_queued_snapshots; ++i)
+        {
+            rec.free_slots.push_back(i);
+        }
+
+        rec.queue.clear();
+        rec.queue.reserve(rec.config.max_queued_snapshots);
+
+        rec.is_stopping = false;
+        rec.has_file_error = false;
+        rec.has_schema = false;
+        rec.next_schema_id = 0;
+        rec.index.clear();
+        rec.schema = {};
+
+        rec.n_recorded = 0;
+        rec.n_dropped = 0;
+        rec.n_blocks = 0;
+        rec.value_bytes = 0;
+        rec.file_bytes = rec.file.size;
+        rec.last_record_ms = 0.0;
+        rec.max_record_ms = 0.0;
+
+        rec.writer = std::thread([&]() { run_writer(rec); });
+
+        rec.is_recording = true;
+
+        return true;
+    }
+
+
+    void record(PlcTagData const& data)
+    {
+        auto& rec = g_rec;
+
+        if (!rec.is_recording)
+        {
+            return;
+        }
+
+        Stopwatch sw;
+        sw.start();
+
+        auto schema_changed = !rec.has_schema || data.tag_list_version != rec.tag_list_version || (u32)data.tags.size() != rec.n_tags;
+
+        u32 slot_id = 0;
+        {
+            std::lock_guard<std::mutex> lock(rec.mutex);
+
+            if (rec.free_slots.empty())
+            {
+                // a schema change is picked up by the next snapshot
+                rec.n_dropped++;
+                return;
+            }
+
+            slot_id = rec.free_slots.back();
+            rec.free_slots.pop_back();
+        }
+
+        auto& slot = rec.slots[slot_id];
+
+        slot.has_schema = schema_changed;
+
+        if (schema_changed)
+        {
+            build_writer_schema(data, rec.next_schema_id++, slot.schema);
+
+            rec.has_schema = true;
+            rec.tag_list_version = data.tag_list_version;
+            rec.n_tags = (u32)data.tags.size();
+            rec.row_size = slot.schema.row_size;
+        }
+
+        slot.timestamp_us = timestamp_us();
+        slot.values.resize(rec.row_size);
+
+        u32 offset = 0;
+        for (auto const& tag : data.tags)
+        {
+            memcpy(slot.values.data() + offset, tag.data(), tag.size());
+            offset += tag.size();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(rec.mutex);
+            rec.queue.push_back(slot_id);
+        }
+
+        rec.cv.notify_one();
+
+        rec.n_recorded++;
+        rec.value_bytes += rec.row_size;
+
+        update_record_time(rec, sw.get_time_milli());
+    }
+
+
+    void stop_recording()
+    {
+        auto& rec = g_rec;
+
+        if (!rec.is_recording)
+        {
+            return;
+        }
+
+        rec.is_recording = false;
+
+        {
+            std::lock_guard<std::mutex> lock(rec.mutex);
+            rec.is_stopping = true;
+        }
+
+        rec.cv.notify_one();
+        rec.writer.join();
+
+        destroy_recorder(rec);
+    }
+
+
+    RecorderStats get_recorder_stats()
+    {
+        auto& rec = g_rec;
+
+        RecorderStats stats{};
+        stats.snapshots_recorded = rec.n_recorded;
+        stats.snapshots_dropped = rec.n_dropped;
+        stats.blocks_written = rec.n_blocks;
+        stats.value_bytes = rec.value_bytes;
+        stats.file_bytes = rec.file_bytes;
+        stats.last_record_ms = rec.last_record_ms;
+        stats.max_record_ms = rec.max_record_ms;
+
+        return stats;
+    }
+
+
+    bool open_capture(cstr file_path, Capture& capture)
+    {
+        capture = {};
+
+        auto& mf = capture.file;
+
+        if (!open_file(file_path, mf))
+        {
+            return false;
+        }
+
+        FileHeader header{};
+
+        if (mf.size < sizeof(header) || !map_file(mf, mf.size))
+        {
+            close_file(mf);
+            return false;
+        }
+
+        memcpy(&header, mf.data, sizeof(header));
+
+        if (memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) || header.version != FILE_VERSION || header.header_size < sizeof(header))
+        {
+            close_capture(capture);
+            return false;
+        }
+
+        if (!read_index(capture, header.index_offset))
+        {
+            capture.schemas.clear();
+            capture.blocks.clear();
+
+            scan_records(capture, header.header_size);
+        }
+
+        for (auto const& b : capture.blocks)
+        {
+            capture.n_rows += b.n_rows;
+        }
+
+        if (!capture.blocks.empty())
+        {
+            capture.first_us = capture.blocks.front().first_us;
+            capture.last_us = capture.blocks.back().last_us;
+        }
+
+        return true;
+    }
+
+
+    void close_capture(Capture& capture)
+    {
+        if (capture.file.file >= 0)
+        {
+            close_file(capture.file);
+        }
+
+        capture = {};
+    }
+
+
+    CaptureSchema const* find_schema(u32 schema_id, Capture const& capture)
+    {
+        for (auto const& schema : capture.schemas)
+        {
+            if (schema.schema_id == schema_id)
+            {
+                return &schema;
+            }
+        }
+
+        return nullptr;
+    }
+
+
+    // first block that ends at or after timestamp_us, or the number of blocks
+    u32 find_block(u64 timestamp_us, Capture const& capture)
+    {
+        auto& blocks = capture.blocks;
+
+        auto it = std::lower_bound(blocks.begin(), blocks.end(), timestamp_us, [](BlockInfo const& b, u64 ts) { return b.last_us < ts; });
+
+        return (u32)(it - blocks.begin());
+    }
+
+
+    bool read_block(u32 block_id, Capture const& capture, CaptureBlock& block)
+    {
+        if (block_id >= (u32)capture.blocks.size())
+        {
+            return false;
+        }
+
+        auto& info = capture.blocks[block_id];
+
+        auto schema = find_schema(info.schema_id, capture);
+        if (!schema)
+        {
+            return false;
+        }
+
+        return decode_block(capture, info, *schema, block);
+    }
+
+    bool replay(Capture const& capture, plcscan::data_f const& scan_cb, plcscan::bool_f const& replay_condition, ReplayConfig const& config)
+    {
+        namespace chr = std::chrono;
+        using clock_type = chr::steady_clock;
+
+        ReplayState rs;
+        rs.data.is_init = true;
+        rs.data.is_connected = true;
+
+        CaptureBlock block;
+
+        auto first_us = std::max(config.begin_us, capture.first_us);
+        auto end_us = config.end_us ? config.end_us : capture.last_us;
+
+        auto start = clock_type::now();
+
+        u64 prev_us = 0;
+
+        Stopwatch sw;
+
+        for (auto b = find_block(first_us, capture); b < (u32)capture.blocks.size(); ++b)
+        {
+            if (capture.blocks[b].first_us > end_us)
+            {
+                break;
+            }
+
+            if (!read_block(b, capture, block))
+            {
+                return false;
+            }
+
+            if (block.schema_id != rs.schema_id)
+            {
+                load_schema(*find_schema(block.schema_id, capture), rs);
+            }
+
+            for (u32 r = 0; r < block.n_rows; ++r)
+            {
+                auto ts = block.timestamps_us[r];
+
+                if (ts < first_us)
+                {
+                    continue;
+                }
+
+                if (ts > end_us || !replay_condition())
+                {
+                    return true;
+                }
+
+                if (config.speed > 0.0)
+                {
+                    auto offset_us = (ts - first_us) / config.speed;
+                    std::this_thread::sleep_until(start + chr::microseconds((i64)offset_us));
+                }
+
+                load_row(block.values.data() + (u64)r * block.row_size, rs);
+
+                // recorded time between scans
+                rs.data.scan_ms = prev_us ? (ts - prev_us) / 1000.0 : 0.0;
+                prev_us = ts;
+
+                sw.start();
+                scan_cb(rs.data);
+                rs.data.process_ms = sw.get_time_milli();
+            }
+        }
+
+        return true;
+    }
+
+
+    bool replay(cstr file_path, plcscan::data_f const& scan_cb, plcscan::bool_f const& replay_condition, ReplayConfig const& config)
+    {
+        Capture capture;
+
+        if (!open_capture(file_path, capture))
+        {
+            return false;
+        }
+
+        auto result = replay(capture, scan_cb, replay_condition, config);
+
+        close_capture(capture);
+
+        return result;
+    }
+}
+
+
+/*
+MIT License
+
+Copyright (c) 2023 Adam Lafontaine
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
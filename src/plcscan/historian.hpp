@@ -0,0 +1,189 @@
+#pragma once
+/* LICENSE: See end of file for license information. */
+
+#include "plcscan.hpp"
+
+
+/* types */
+
+namespace historian
+{
+    using DataTypeId32 = plcscan::DataTypeId32;
+
+
+    class RecorderConfig
+    {
+    public:
+        // snapshots waiting for the writer thread, more are dropped
+        u32 max_queued_snapshots = 32;
+
+        // scans per block, a block is decoded as a whole
+        u32 rows_per_block = 256;
+
+        // a block is written early when its encoded values reach this size
+        u32 max_block_bytes = 4 * 1024 * 1024;
+    };
+
+
+    class RecorderStats
+    {
+    public:
+        u64 snapshots_recorded = 0;
+
+        // the writer thread could not keep up
+        u64 snapshots_dropped = 0;
+
+        u64 blocks_written = 0;
+
+        // tag values recorded and the file size they were encoded to
+        u64 value_bytes = 0;
+        u64 file_bytes = 0;
+
+        // time spent in record() on the scan thread
+        f64 last_record_ms = 0.0;
+        f64 max_record_ms = 0.0;
+    };
+
+
+    class MappedFile
+    {
+    public:
+        u8* data = nullptr;
+
+        // bytes written, capacity is the size of the mapping
+        u64 size = 0;
+        u64 capacity = 0;
+
+        bool is_writable = false;
+
+        intptr_t file = -1;
+        intptr_t mapping = 0;
+    };
+
+
+    // Tags and UDTs of a capture, names point into the mapped file
+    class CaptureSchema
+    {
+    public:
+        u32 schema_id = 0;
+
+        // value_bytes.length is the size of each tag, data is not set
+        List<plcscan::Tag> tags;
+        List<plcscan::UdtType> udt_types;
+        List<plcscan::UdtFieldType> udt_fields;
+
+        // where each tag is in a decoded row
+        List<u32> value_offsets;
+        u32 row_size = 0;
+    };
+
+
+    class BlockInfo
+    {
+    public:
+        u64 file_offset = 0;
+
+        u32 schema_id = 0;
+        u32 n_rows = 0;
+
+        // microseconds since the epoch
+        u64 first_us = 0;
+        u64 last_us = 0;
+    };
+
+
+    class Capture
+    {
+    public:
+        MappedFile file;
+
+        List<CaptureSchema> schemas;
+
+        // in time order
+        List<BlockInfo> blocks;
+
+        u64 first_us = 0;
+        u64 last_us = 0;
+        u64 n_rows = 0;
+    };
+
+
+    // Every scan of one block, row r of tag i is at values[r * row_size + value_offsets[i]]
+    class CaptureBlock
+    {
+    public:
+        u32 schema_id = 0;
+        u32 row_size = 0;
+        u32 n_rows = 0;
+
+        List<u64> timestamps_us;
+        List<u8> values;
+    };
+
+
+    class ReplayConfig
+    {
+    public:
+        // 1.0 is the recorded rate, 2.0 twice as fast, 0.0 as fast as possible
+        f64 speed = 1.0;
+
+        // microseconds since the epoch, 0 for the start or end of the capture
+        u64 begin_us = 0;
+        u64 end_us = 0;
+    };
+}
+
+
+/* api */
+
+namespace historian
+{
+    bool start_recording(cstr file_path, plcscan::PlcTagData const& data, RecorderConfig const& config = {});
+
+    void record(plcscan::PlcTagData const& data);
+
+    void stop_recording();
+
+    RecorderStats get_recorder_stats();
+
+
+    bool open_capture(cstr file_path, Capture& capture);
+
+    void close_capture(Capture& capture);
+
+    CaptureSchema const* find_schema(u32 schema_id, Capture const& capture);
+
+    u32 find_block(u64 timestamp_us, Capture const& capture);
+
+    bool read_block(u32 block_id, Capture const& capture, CaptureBlock& block);
+
+
+    bool replay(Capture const& capture, plcscan::data_f const& scan_cb, plcscan::bool_f const& replay_condition, ReplayConfig const& config = {});
+
+    bool replay(cstr file_path, plcscan::data_f const& scan_cb, plcscan::bool_f const& replay_condition, ReplayConfig const& config = {});
+}
+
+
+/*
+MIT License
+
+Copyright (c) 2023 Adam Lafontaine
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
@@ -16,11 +16,26 @@ namespace mh = memory_helper;
 #include "../dev/devplctag.cpp"
 
 constexpr auto PLCTAG_STATUS_OK = dev::PLCTAG_STATUS_OK;
+constexpr auto PLCTAG_STATUS_PENDING = dev::PLCTAG_STATUS_PENDING;
+constexpr auto PLCTAG_ERR_BAD_DATA = dev::PLCTAG_ERR_BAD_DATA;
+constexpr auto PLCTAG_ERR_TIMEOUT = dev::PLCTAG_ERR_TIMEOUT;
+
+using plc_tag_conn_p = dev::plc_tag_conn_p;
 
 #define plc_tag_create dev::plc_tag_create
+#define plc_tag_conn_create dev::plc_tag_conn_create
+#define plc_tag_create_in_conn dev::plc_tag_create_in_conn
+#define plc_tag_conn_destroy dev::plc_tag_conn_destroy
+#define plc_tag_conn_reconnect dev::plc_tag_conn_reconnect
+#define plc_tag_destroy dev::plc_tag_destroy
 #define plc_tag_read dev::plc_tag_read
+#define plc_tag_status dev::plc_tag_status
 #define plc_tag_get_raw_bytes dev::plc_tag_get_raw_bytes
+#define plc_tag_set_raw_bytes dev::plc_tag_set_raw_bytes
+#define plc_tag_write dev::plc_tag_write
+#define plc_tag_abort dev::plc_tag_abort
 #define plc_tag_get_size dev::plc_tag_get_size
+#define plc_tag_get_int_attribute dev::plc_tag_get_int_attribute
 #define plc_tag_shutdown dev::plc_tag_shutdown
 
 #else
@@ -33,10 +48,38 @@ constexpr auto PLCTAG_STATUS_OK = dev::PLCTAG_STATUS_OK;
 #include "plcscan.hpp"
 
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <algorithm>
+#include <condition_variable>
 #include <functional>
-#include <execution>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <string_view>
+#include <unordered_map>
+
+// AVX2 gather is chosen at runtime, see cpu_has_avx2()
+#if defined(_M_X64) || defined(__x86_64__)
+#define GATHER_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef _WIN32
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#else
+
+#include <pthread.h>
+#include <sched.h>
+
+#endif
 
 
 using DataTypeId32 = plcscan::DataTypeId32;
@@ -44,7 +87,23 @@ using Tag = plcscan::Tag;
 using DataType = plcscan::DataType;
 using UdtFieldType = plcscan::UdtFieldType;
 using UdtType = plcscan::UdtType;
+using DecodeStep = plcscan::DecodeStep;
+using DecodePlan = plcscan::DecodePlan;
+using TypeColumn = plcscan::TypeColumn;
+using ColumnView = plcscan::ColumnView;
 using PlcTagData = plcscan::PlcTagData;
+using LatencyHistogram = plcscan::LatencyHistogram;
+using ScanTelemetry = plcscan::ScanTelemetry;
+using ScanThreadConfig = plcscan::ScanThreadConfig;
+using Backpressure = plcscan::Backpressure;
+using ConsumerConfig = plcscan::ConsumerConfig;
+using ConsumerStats = plcscan::ConsumerStats;
+using ScanSnapshot = plcscan::ScanSnapshot;
+using snapshot_f = plcscan::snapshot_f;
+using TagHealth = plcscan::TagHealth;
+using WriteStatus = plcscan::WriteStatus;
+using WriteResult = plcscan::WriteResult;
+using write_f = plcscan::write_f;
 
 
 
@@ -71,16 +130,6 @@ static bool vector_contains(std::vector<T> const& vec, T value)
 }
 
 
-template <size_t N>
-using f_array = std::array<std::function<void()>, N>;
-
-
-template <size_t N>
-inline void execute_parallel(f_array<N> const& f_list)
-{
-    std::for_each(std::execution::par, f_list.begin(), f_list.end(), [](auto const& f) { f(); });
-}
-
 
 /* 16 bit ids */
 
@@ -420,6 +469,79 @@ namespace id32
     {
         return (id & UDT_TYPE_ID_MASK) && !(id & OTHER_TYPE_ID_MASK) && !(id & FIXED_TYPE_ID_MASK);
     }
+
+
+    static inline u16 get_udt_id(DataTypeId32 id)
+    {
+        return (u16)((id & UDT_TYPE_ID_MASK) >> 8);
+    }
+}
+
+
+/* udt index */
+
+namespace /* private */
+{
+    // one slot per 12 bit UDT id
+    constexpr u32 N_UDT_IDS = (u32)id16::UDT_TYPE_ID_MASK + 1;
+
+    constexpr u16 NO_UDT_INDEX = (u16)0xFFFF;
+
+
+    // also points the field ranges at udt_fields
+    static void index_udt_types(PlcTagData& data)
+    {
+        auto& udts = data.udt_types;
+
+        data.udt_index.assign(N_UDT_IDS, NO_UDT_INDEX);
+
+        for (u32 i = 0; i < (u32)udts.size(); ++i)
+        {
+            auto& udt = udts[i];
+
+            data.udt_index[id32::get_udt_id(udt.type_id)] = (u16)i;
+            udt.fields.field_data = data.udt_fields.data() + udt.fields.first;
+        }
+    }
+
+
+    static UdtType const* find_udt(DataTypeId32 type_id, PlcTagData const& data)
+    {
+        if (!id32::is_udt_type(type_id) || data.udt_index.size() != N_UDT_IDS)
+        {
+            return nullptr;
+        }
+
+        auto i = data.udt_index[id32::get_udt_id(type_id)];
+        
+        return i < (u32)data.udt_types.size() ? data.udt_types.data() + i : nullptr;
+    }
+
+
+    // UDTs that tags or UDT fields refer to but whose templates were not read
+    static void find_missing_udt_types(PlcTagData& data)
+    {
+        auto& missing = data.missing_udt_types;
+        missing.clear();
+
+        auto const check = [&](DataTypeId32 type_id)
+        {
+            if (id32::is_udt_type(type_id) && !find_udt(type_id, data) && !vector_contains(missing, type_id))
+            {
+                missing.push_back(type_id);
+            }
+        };
+
+        for (auto const& tag : data.tags)
+        {
+            check(tag.type_id);
+        }
+
+        for (auto const& field : data.udt_fields)
+        {
+            check(field.type_id);
+        }
+    }
 }
 
 
@@ -437,8 +559,12 @@ namespace /* private */
         u32 elem_size = 0;
         u32 elem_count = 0;
         
-        char* name_ptr = nullptr;
+        // copied, entries outlive the fragment they were parsed from
+        char name[MAX_TAG_NAME_LENGTH + 1] = { 0 };
         u32 name_length = 0;
+
+        // created as soon as the entry is parsed
+        int connection_handle = -1;
     };
 
 
@@ -533,35 +659,91 @@ namespace /* private */
 
         auto string_len = (u32)get16();
 
-        entry.name_ptr = (char*)(entry_data.data + offset);
-        entry.name_length = string_len;
+        auto name_ptr = (char*)push(string_len);
 
-        char buffer[MAX_TAG_NAME_LENGTH + 1] = { 0 };
-        mh::copy_unsafe(entry.name_ptr, buffer, entry.name_length);
-
-        if (is_valid_tag_name(buffer))
+        if (string_len <= MAX_TAG_NAME_LENGTH)
         {
-            entries.push_back(std::move(entry));
-        }
+            entry.name_length = string_len;
+            mh::copy_unsafe(name_ptr, entry.name, entry.name_length);
 
-        offset += string_len;
+            if (is_valid_tag_name(entry.name))
+            {
+                entries.push_back(std::move(entry));
+            }
+        }
 
         return offset;
     }
 
 
-    static TagEntryList parse_tag_entries(ByteView const& entry_data)
+    // instance_id, symbol_type, element_length, array_dims[3], string_len
+    constexpr u32 TAG_ENTRY_HEADER_SIZE = 22;
+
+
+    static u32 tag_entry_size(u8 const* header)
     {
-        TagEntryList list;
+        auto string_len = *(u16*)(header + TAG_ENTRY_HEADER_SIZE - sizeof(u16));
 
-        u64 offset = 0;
+        return TAG_ENTRY_HEADER_SIZE + string_len;
+    }
+
+
+    // @tags parsed one fragment at a time while the rest is still downloading
+    class TagEntryStream
+    {
+    public:
+        TagEntryList entries;
+
+        // an entry split between two fragments
+        std::vector<u8> partial;
+
+        u32 n_bytes = 0;
+    };
+
+
+    static void reset_tag_entry_stream(TagEntryStream& stream)
+    {
+        destroy_vector(stream.entries);
+        destroy_vector(stream.partial);
+        stream.n_bytes = 0;
+    }
 
-        while ((u32)offset < entry_data.length)
+
+    static void push_tag_entry_bytes(TagEntryStream& stream, ByteView const& fragment)
+    {
+        auto& partial = stream.partial;
+
+        u32 offset = 0;
+
+        while (offset < fragment.length)
         {
-            offset += append_tag_entry(list, mb::sub_view(entry_data, (u32)offset));
+            auto data = fragment.data + offset;
+            auto n_left = fragment.length - offset;
+
+            if (partial.empty() && n_left >= TAG_ENTRY_HEADER_SIZE && n_left >= tag_entry_size(data))
+            {
+                offset += (u32)append_tag_entry(stream.entries, mb::sub_view(fragment, offset));
+                continue;
+            }
+
+            // header first, then the name it gives the length of
+            auto n_partial = (u32)partial.size();
+            auto n_need = n_partial < TAG_ENTRY_HEADER_SIZE ? TAG_ENTRY_HEADER_SIZE : tag_entry_size(partial.data());
+            auto n_copy = std::min(n_need - n_partial, n_left);
+
+            partial.insert(partial.end(), data, data + n_copy);
+            offset += n_copy;
+
+            n_partial = (u32)partial.size();
+
+            if (n_partial >= TAG_ENTRY_HEADER_SIZE && n_partial == tag_entry_size(partial.data()))
+            {
+                append_tag_entry(stream.entries, { partial.data(), n_partial });
+                partial.clear();
+            }
         }
 
-        return list;
+        stream.n_bytes += fragment.length;
     }
 }
 
@@ -577,8 +759,24 @@ namespace /* private */
 
         MemoryOffset scan_offset;
 
+        // index in PlcTagData::tags, subscriptions report to their parent tag
+        u32 tag_index = 0;
+
         bool scan_ok = false;
 
+        // read at least once since connect()
+        bool has_read = false;
+
+        // not read this cycle, waiting out a backoff
+        bool scan_skipped = false;
+
+        // read again on or after this scan cycle
+        u32 n_failures = 0;
+        u64 next_read_cycle = 0;
+
+        // whole tag read replaced by member/slice subscriptions
+        bool is_subscribed = false;
+
         bool is_connected() const { return connection_handle > 0; }
     };
 
@@ -587,11 +785,14 @@ namespace /* private */
     {
     public:
         std::vector<TagConnection> connections;
+        std::vector<TagConnection> subscriptions;
         // TODO tag_status
         //std::vector<Tag> tags;
 
         u32 n_tags = 0;
 
+        u64 scan_cycle = 0;
+
         ParallelBuffer<u8> scan_data;
         ByteBuffer public_tag_data;
         MemoryBuffer<char> name_data;
@@ -601,6 +802,7 @@ namespace /* private */
     static void destroy_tag_memory(TagMemory& mem)
     {
         destroy_vector(mem.connections);
+        destroy_vector(mem.subscriptions);
 
         mb::destroy_buffer(mem.scan_data);
         mb::destroy_buffer(mem.public_tag_data);
@@ -630,6 +832,7 @@ namespace /* private */
         assert(name_alloc_len > name_copy_len); /* zero terminated */
 
         TagConnection conn{};
+        conn.connection_handle = entry.connection_handle;
         conn.scan_offset = mb::push_offset(mem.scan_data , value_len);
 
         Tag tag{};
@@ -638,7 +841,7 @@ namespace /* private */
         tag.tag_name = mh::push_cstr_view(mem.name_data, name_alloc_len);        
         tag.value_bytes = mb::sub_view(mem.public_tag_data, conn.scan_offset);
 
-        mh::copy_unsafe(entry.name_ptr, tag.tag_name, name_copy_len);
+        mh::copy_unsafe((char*)entry.name, tag.tag_name, name_copy_len);
 
         mem.connections.push_back(conn);
         tags.push_back(tag);
@@ -694,7 +897,43 @@ namespace /* private */
     }
 
 
-    static StringView get_data_type_name(DataTypeId32 type_id, List<UdtType> const& udts)
+    // same names, types and sizes in the same order as create_tags() made them
+    static bool tags_match(TagEntryList const& entries, List<Tag> const& tags)
+    {
+        u32 i = 0;
+
+        for (auto const& e : entries)
+        {
+            if (!elem_size(e))
+            {
+                continue; /* not added */
+            }
+
+            if (i >= (u32)tags.size())
+            {
+                return false;
+            }
+
+            auto const& tag = tags[i++];
+
+            if (tag.type_id != id32::get_data_type_id(e.type_code) ||
+                tag.array_count != e.elem_count ||
+                tag.size() != elem_size(e))
+            {
+                return false;
+            }
+
+            if (strncmp(tag.name(), e.name, e.name_length) != 0 || tag.name()[e.name_length])
+            {
+                return false;
+            }
+        }
+
+        return i == (u32)tags.size();
+    }
+
+
+    static StringView get_data_type_name(DataTypeId32 type_id, PlcTagData const& data)
     {
         static constexpr auto udt_type = "UDT";
 
@@ -706,35 +945,30 @@ namespace /* private */
             return mh::to_string_view_unsafe((char*)str, len);
         }
         
-        for (auto const& udt : udts)
+        auto udt = find_udt(type_id, data);
+        if (udt)
         {
-            if (type_id == udt.type_id)
-            {
-                return udt.udt_name;
-            }
+            return udt->udt_name;
         }
 
         return mh::to_string_view_unsafe((char*)udt_type, (u32)strlen(udt_type));
     }
     
     
-    static void set_tag_data_type_names(List<Tag>& tags, List<UdtType> const& udts)
+    static void set_tag_data_type_names(PlcTagData& data)
     {
-        for (auto& tag : tags)
+        for (auto& tag : data.tags)
         {
-            tag.data_type_name = get_data_type_name(tag.type_id, udts);
+            tag.data_type_name = get_data_type_name(tag.type_id, data);
         }
     }
 
 
-    static void set_udt_field_data_type_names(List<UdtType>& udts)
+    static void set_udt_field_data_type_names(PlcTagData& data)
     {
-        for (auto& udt : udts)
+        for (auto& field : data.udt_fields)
         {
-            for (auto& field : udt.fields)
-            {
-                field.data_type_name = get_data_type_name(field.type_id, udts);
-            }
+            field.data_type_name = get_data_type_name(field.type_id, data);
         }
     }
 }
@@ -876,20 +1110,6 @@ namespace /* private */
         return entry; 
     }
 
-
-    template <class ENTRY>
-    static void append_udt_ids(std::vector<ENTRY> const& entries, std::vector<u16>& udt_ids)
-    {
-        for (auto const& e : entries)
-        {
-            auto id = id16::get_udt_id(e.type_code);
-            if (id && !vector_contains(udt_ids, id))
-            {
-                udt_ids.push_back(id);
-            }
-        }
-    }
-
 }
 
 
@@ -916,20 +1136,16 @@ namespace /* private */
     {
     public:
         MemoryBuffer<char> type_name_data;
-        std::vector<MemoryBuffer<char>> udt_name_data;
+
+        // names of every UDT and UDT field
+        MemoryBuffer<char> udt_name_data;
     };
 
 
     static void destroy_data_type_memory(DataTypeMemory& mem)
     {
         mb::destroy_buffer(mem.type_name_data);
-
-        for (auto& buffer : mem.udt_name_data)
-        {
-            mb::destroy_buffer(buffer);
-        }
-
-        destroy_vector(mem.udt_name_data);
+        mb::destroy_buffer(mem.udt_name_data);
     }
 
 
@@ -964,47 +1180,43 @@ namespace /* private */
     }
 
 
-    static void add_udt_type(List<UdtType>& udt_types, DataTypeMemory& mem, UdtEntry const& entry)
-    {
-        auto type_id = id32::get_udt_type_id(entry.udt_id);
-        
-        if (!type_id || list_contains(udt_types, type_id))
-        {
-            return;
-        }
-        
-        MemoryBuffer<char> buffer{};
-        
-        auto desc_str = "User defined type";
+    constexpr auto UDT_DESCRIPTION = "User defined type";
 
-        auto name_len = entry.name_length;
-        auto desc_len = (u32)strlen(desc_str);
 
-        auto buffer_len = desc_len + name_len + 2; /* zero terminated */
+    static u32 udt_name_bytes(UdtEntry const& entry)
+    {
+        auto n_bytes = entry.name_length + (u32)strlen(UDT_DESCRIPTION) + 2; /* zero terminated */
+
         for (auto const& f : entry.fields)
         {
-            buffer_len += f.name.length + 1; /* zero terminated */
+            n_bytes += f.name.length + 1; /* zero terminated */
         }
 
-        if (!mb::create_buffer(buffer, buffer_len))
-        {            
-            return;
-        }
+        return n_bytes;
+    }
 
-        mb::zero_buffer(buffer);
+
+    // names has room for udt_name_bytes()
+    static void add_udt_type(UdtEntry const& entry, MemoryBuffer<char>& names, List<UdtType>& udt_types, List<UdtFieldType>& udt_fields)
+    {
+        auto name_len = entry.name_length;
+        auto desc_len = (u32)strlen(UDT_DESCRIPTION);
 
         UdtType ut{};
 
-        ut.type_id = type_id;
+        // libplctag reports the template instance id without the struct bit
+        ut.type_id = id32::get_udt_type_id(id16::TYPE_IS_STRUCT | entry.udt_id);
         ut.size = entry.udt_size;
 
-        ut.udt_name = mh::push_cstr_view(buffer, name_len + 1);
-        ut.udt_description = mh::push_cstr_view(buffer, desc_len + 1);
-        
+        ut.udt_name = mh::push_cstr_view(names, name_len + 1);
+        ut.udt_description = mh::push_cstr_view(names, desc_len + 1);
+
         mh::copy_unsafe(entry.name_ptr, ut.udt_name, entry.name_length);
-        mh::copy_unsafe((char*)desc_str, ut.udt_description, desc_len);
+        mh::copy_unsafe((char*)UDT_DESCRIPTION, ut.udt_description, desc_len);
+
+        ut.fields.first = (u32)udt_fields.size();
+        ut.fields.count = (u32)entry.fields.size();
 
-        ut.fields.reserve(entry.fields.size());
         for (auto const& f : entry.fields)
         {
             UdtFieldType ft{};
@@ -1013,14 +1225,72 @@ namespace /* private */
             ft.array_count = f.elem_count;
             ft.bit_number = f.bit_number;
 
-            ft.field_name = mh::push_cstr_view(buffer, f.name.length + 1);
+            ft.field_name = mh::push_cstr_view(names, f.name.length + 1);
             mh::copy(f.name, ft.field_name);
 
-            ut.fields.push_back(ft);
+            udt_fields.push_back(ft);
         }
 
         udt_types.push_back(ut);
-        mem.udt_name_data.push_back(buffer);
+    }
+
+
+    // replaces udt_types and udt_fields, one name buffer for every UDT
+    static bool set_udt_types(List<UdtEntry> const& entries, DataTypeMemory& mem, PlcTagData& data)
+    {
+        List<bool> is_added(N_UDT_IDS, false);
+        List<UdtEntry const*> added;
+
+        u32 n_fields = 0;
+        u32 n_name_bytes = 0;
+
+        for (auto const& entry : entries)
+        {
+            auto type_id = id32::get_udt_type_id(id16::TYPE_IS_STRUCT | entry.udt_id);
+            auto udt_id = id32::get_udt_id(type_id);
+
+            if (!type_id || is_added[udt_id])
+            {
+                continue;
+            }
+
+            is_added[udt_id] = true;
+            added.push_back(&entry);
+
+            n_fields += (u32)entry.fields.size();
+            n_name_bytes += udt_name_bytes(entry);
+        }
+
+        MemoryBuffer<char> names{};
+
+        if (n_name_bytes)
+        {
+            if (!mb::create_buffer(names, n_name_bytes))
+            {
+                return false;
+            }
+
+            mb::zero_buffer(names);
+        }
+
+        List<UdtType> udt_types;
+        List<UdtFieldType> udt_fields;
+
+        udt_types.reserve(added.size());
+        udt_fields.reserve(n_fields);
+
+        for (auto entry : added)
+        {
+            add_udt_type(*entry, names, udt_types, udt_fields);
+        }
+
+        mb::destroy_buffer(mem.udt_name_data);
+        mem.udt_name_data = names;
+
+        data.udt_types = std::move(udt_types);
+        data.udt_fields = std::move(udt_fields);
+
+        return true;
     }
 
 
@@ -1093,60 +1363,75 @@ namespace
 
         StringView connection_string;
 
+        // parsed once, shared by every tag handle
+        plc_tag_conn_p connection = nullptr;
+
+        // @tags, read again to check the tag list after a reconnect
+        int listing_handle = -1;
+
         char string_data[100 + MAX_TAG_NAME_LENGTH] = { 0 }; // should be enough
     };
 
 
-    static void init_controller(ControllerAttr& attr)
+    static void destroy_controller(ControllerAttr& attr)
     {
-        attr.connection_string = mh::to_string_view_unsafe(attr.string_data, (u32)sizeof(attr.string_data));
-
-        mh::zero_string(attr.connection_string);
+        if (attr.connection)
+        {
+            plc_tag_conn_destroy(attr.connection);
+            attr.connection = nullptr;
+        }
     }
 
 
-    static void set_connection_string(ControllerAttr const& attr, cstr tag_name, int elem_size, int elem_count)
+    static bool init_controller(ControllerAttr& attr)
     {
         constexpr auto fmt =
             "protocol=ab-eip"
             "&plc=controllogix"
             "&gateway=%s"
             "&path=%s"
-            "&name=%s"
-            "&elem_size=%d"
-            "&elem_count=%d";
+            "&parallel_frag_read=1"
+            "&retry_wait_ms=100"
+            "&connect_timeout_ms=250";
+
+        destroy_controller(attr);
+
+        attr.connection_string = mh::to_string_view_unsafe(attr.string_data, (u32)sizeof(attr.string_data));
 
         mh::zero_string(attr.connection_string);
 
         auto dst = attr.connection_string.char_data;
         auto max_len = (int)attr.connection_string.length;
 
-        qsnprintf(dst, max_len, fmt, attr.gateway, attr.path, tag_name, elem_size, elem_count);
+        qsnprintf(dst, max_len, fmt, attr.gateway, attr.path);
+
+        auto rc = plc_tag_conn_create(attr.connection_string.data(), &attr.connection);
+
+        return rc == PLCTAG_STATUS_OK;
     }
 
 
-    static void set_tag(ControllerAttr const& attr, Tag const& tag)
+    static int create_tag_handle(ControllerAttr const& attr, cstr tag_name, int elem_size, int elem_count)
     {
-        auto el_count = (int)tag.array_count;
-        auto el_size = (int)(tag.size() / tag.array_count);
+        auto timeout = 100;
 
-        set_connection_string(attr, tag.name(), el_size, el_count);
+        return plc_tag_create_in_conn(attr.connection, tag_name, elem_size, elem_count, timeout);
     }
 
 
-    static void set_tag(ControllerAttr const& attr, cstr tag_name)
+    // returns without waiting, plc_tag_status() is pending until the handle can be read
+    static int start_tag_handle(ControllerAttr const& attr, cstr tag_name, int elem_size, int elem_count)
     {
-        set_connection_string(attr, tag_name, 1, 1);
+        return plc_tag_create_in_conn(attr.connection, tag_name, elem_size, elem_count, 0);
     }
 
 
     static bool connect_tag(ControllerAttr const& attr, Tag const& tag, TagConnection& conn)
     {
-        set_tag(attr, tag);
-
-        auto timeout = 100;
+        auto el_count = (int)tag.array_count;
+        auto el_size = (int)(tag.size() / tag.array_count);
 
-        auto rc = plc_tag_create(attr.connection_string.data(), timeout);
+        auto rc = create_tag_handle(attr, tag.name(), el_size, el_count);
         if (rc < 0)
         {
             return false;
@@ -1186,16 +1471,8 @@ namespace
     }
 
 
-    static bool scan_to_buffer(int tag_handle, ByteBuffer& dst)
+    static bool get_tag_buffer(int tag_handle, ByteBuffer& dst)
     {
-        auto timeout = 100;
-
-        auto rc = plc_tag_read(tag_handle, timeout);
-        if (rc != PLCTAG_STATUS_OK)
-        {
-            return false;
-        }
-
         auto size = plc_tag_get_size(tag_handle);
         if (size < 4)
         {
@@ -1209,7 +1486,7 @@ namespace
 
         auto view = mb::push_view(dst, (u32)size);
 
-        rc = plc_tag_get_raw_bytes(tag_handle, 0, view.data, view.length);
+        auto rc = plc_tag_get_raw_bytes(tag_handle, 0, view.data, view.length);
         if (rc != PLCTAG_STATUS_OK)
         {
             return false;
@@ -1218,159 +1495,2829 @@ namespace
         return true;
     }
 
+}
 
-    static bool scan_to_buffer(ControllerAttr const& attr, cstr tag_name, ByteBuffer& dst)
-    {
-        set_tag(attr, tag_name);
 
-        auto timeout = 100;
+/* subscriptions */
 
-        auto rc = plc_tag_create(attr.connection_string.data(), timeout);
-        if (rc < 0)
-        {
-            return false;
-        }
+namespace
+{
+    constexpr size_t MAX_SUBSCRIPTION_PATH_LENGTH = 256;
 
-        auto handle = rc;
 
-        return scan_to_buffer(handle, dst);
-    }
+    class SubscriptionPath
+    {
+    public:
+        u32 tag_index = 0;
 
+        u32 offset = 0;
+        u32 elem_size = 0;
+        u32 elem_count = 0;
 
-    static bool scan_tag_entry_listing(ControllerAttr const& attr, ByteBuffer& dst)
-    {
-        return scan_to_buffer(attr, "@tags", dst);
-    }
+        char plc_name[MAX_SUBSCRIPTION_PATH_LENGTH] = { 0 };
+    };
 
 
-    static bool scan_udt_entry(ControllerAttr const& attr, int udt_id, ByteBuffer& dst)
+    static bool segment_equals(cstr name, cstr segment, u32 segment_len)
     {
-        char udt[20];
-        qsnprintf(udt, 20, "@udt/%d", udt_id);
-
-        return scan_to_buffer(attr, udt, dst);
+        return strlen(name) == segment_len && strncmp(name, segment, segment_len) == 0;
     }
 
-}
-
-
-/* scan cycle */
 
-namespace
-{
-    static bool enumerate_tags(ControllerAttr const& attr, TagMemory& tag_mem, DataTypeMemory& dt_mem, PlcTagData& data)
+    static cstr parse_index(cstr str, u32& value)
     {
-        ByteBuffer entry_buffer;
-        
-        if (!scan_tag_entry_listing(attr, entry_buffer))
+        if (*str < '0' || *str > '9')
         {
-            return false;
+            return nullptr;
         }
 
-        auto entry_data = mb::make_view(entry_buffer);
-
-        auto tag_entries = parse_tag_entries(entry_data);
-
-        if (!create_tags(tag_entries, tag_mem, data.tags))
+        value = 0;
+        while (*str >= '0' && *str <= '9')
         {
-            mb::destroy_buffer(entry_buffer);
-            return false;
+            value = value * 10 + (u32)(*str - '0');
+            ++str;
         }
 
-        std::vector<u16> udt_ids;
-        append_udt_ids(tag_entries, udt_ids);
+        return str;
+    }
 
-        destroy_vector(tag_entries);
-        mb::destroy_buffer(entry_buffer);
 
-        for (u32 i = 0; i < udt_ids.size(); ++i)
+    static u32 get_type_size(DataTypeId32 type_id, PlcTagData const& data)
+    {
+        if (!id32::is_udt_type(type_id))
         {
-            auto id = (int)udt_ids[i];
+            auto size = data_type_size((FixedType)type_id);
             
-            ByteBuffer udt_buffer;
+            // strings and time types do not have a known fixed size
+            return size == MAX_TYPE_BYTES ? 0 : size;
+        }
+
+        auto udt = find_udt(type_id, data);
+
+        return udt ? udt->size : 0;
+    }
+
+
+    static UdtFieldType const* find_udt_field(DataTypeId32 type_id, cstr name, u32 name_len, PlcTagData const& data)
+    {
+        auto udt = find_udt(type_id, data);
+        if (!udt)
+        {
+            return nullptr;
+        }
+
+        for (auto const& field : udt->fields)
+        {
+            if (segment_equals(field.name(), name, name_len))
+            {
+                return &field;
+            }
+        }
+
+        return nullptr;
+    }
+
+
+    /*
+    Resolves "Tag.Member.Sub", "Tag[100..199]" or "Tag.Member[2..5]" to a byte range in the tag value
+    and the name/elem_count libplctag should read. Bit members and multi-dimension indexes are not supported.
+    */
+    static bool resolve_subscription(cstr path, PlcTagData const& data, SubscriptionPath& sub)
+    {
+        auto& tags = data.tags;
+
+        auto name = path;
+        auto len = (u32)strcspn(name, ".[");
+
+        auto found = false;
+        for (u32 i = 0; i < (u32)tags.size(); ++i)
+        {
+            if (segment_equals(tags[i].name(), name, len))
+            {
+                sub.tag_index = i;
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+        {
+            return false;
+        }
+
+        auto& tag = tags[sub.tag_index];
+
+        auto type_id = tag.type_id;
+        auto array_count = tag.array_count ? tag.array_count : 1;
+
+        sub.offset = 0;
+        sub.elem_size = tag.size() / array_count;
+        sub.elem_count = array_count;
+
+        auto dst = sub.plc_name;
+        auto dst_end = sub.plc_name + MAX_SUBSCRIPTION_PATH_LENGTH - 1;
+
+        auto const push_name = [&](cstr src, u32 src_len)
+        {
+            if (dst + src_len > dst_end)
+            {
+                return false;
+            }
+
+            mh::copy_bytes((u8*)src, (u8*)dst, src_len);
+            dst += src_len;
+            *dst = 0;
+            return true;
+        };
+
+        if (!push_name(name, len))
+        {
+            return false;
+        }
+
+        name += len;
+
+        auto needs_index = false;
+
+        while (*name)
+        {
+            if (*name == '[')
+            {
+                u32 begin = 0;
+                u32 end = 0;
+
+                name = parse_index(name + 1, begin);
+                if (!name)
+                {
+                    return false;
+                }
+
+                end = begin;
+                if (name[0] == '.' && name[1] == '.')
+                {
+                    name = parse_index(name + 2, end);
+                    if (!name)
+                    {
+                        return false;
+                    }
+                }
+
+                if (*name != ']' || end < begin || end >= sub.elem_count)
+                {
+                    return false;
+                }
+
+                ++name;
+
+                char index[16] = { 0 };
+                auto index_len = (u32)qsnprintf(index, (int)sizeof(index), "[%u]", begin);
+                if (!push_name(index, index_len))
+                {
+                    return false;
+                }
+
+                sub.offset += begin * sub.elem_size;
+                sub.elem_count = end - begin + 1;
+
+                needs_index = false;
+            }
+            else if (*name == '.')
+            {
+                // members of a single UDT value only
+                if (sub.elem_count != 1 || !id32::is_udt_type(type_id))
+                {
+                    return false;
+                }
+
+                len = (u32)strcspn(name + 1, ".[");
+
+                auto field = find_udt_field(type_id, name + 1, len, data);
+                if (!field || field->is_bit())
+                {
+                    return false;
+                }
+
+                if (!push_name(name, len + 1))
+                {
+                    return false;
+                }
+
+                name += len + 1;
+
+                type_id = field->type_id;
+
+                sub.offset += field->offset;
+                sub.elem_size = get_type_size(type_id, data);
+                sub.elem_count = field->array_count ? field->array_count : 1;
+
+                needs_index = sub.elem_count > 1;
+
+                if (!sub.elem_size)
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        // whole member arrays are read from the first element
+        if (needs_index && !push_name("[0]", 3))
+        {
+            return false;
+        }
+
+        return sub.offset + sub.elem_size * sub.elem_count <= tag.size();
+    }
+
+
+    static bool subscribe_tag(ControllerAttr const& attr, SubscriptionPath const& path, TagMemory& mem)
+    {
+        auto& tag_conn = mem.connections[path.tag_index];
+
+        TagConnection conn{};
+        conn.scan_offset.begin = tag_conn.scan_offset.begin + path.offset;
+        conn.scan_offset.length = path.elem_size * path.elem_count;
+        conn.tag_index = path.tag_index;
+
+        auto rc = create_tag_handle(attr, path.plc_name, (int)path.elem_size, (int)path.elem_count);
+        if (rc < 0)
+        {
+            return false;
+        }
+
+        conn.connection_handle = rc;
+
+        mem.subscriptions.push_back(conn);
+        tag_conn.is_subscribed = true;
+
+        return true;
+    }
+}
+
+
+/* writes */
+
+namespace /* private */
+{
+    constexpr int WRITE_TIMEOUT_MS = 100;
+
+
+    class WriteRequest
+    {
+    public:
+        SubscriptionPath path;
+
+        // bytes in the queue's value buffer
+        u32 value_offset = 0;
+        u32 value_size = 0;
+
+        // tag_index is only valid for this tag list
+        u32 tag_list_version = 0;
+
+        write_f on_done;
+
+        // started by write()
+        Stopwatch sw;
+
+        int handle = -1;
+        bool is_sending = false;
+
+        WriteResult result;
+    };
+
+
+    class WriteQueue
+    {
+    public:
+        std::mutex mutex;
+
+        // written by write(), taken by the scan at the start of a cycle
+        List<WriteRequest> pending;
+        List<u8> pending_values;
+
+        // tag_index and offset of each pending write, size is checked
+        std::unordered_map<u64, u32> pending_index;
+
+        // reported before the next scan callback
+        List<WriteRequest> done;
+
+        // scan thread
+        List<WriteRequest> sending;
+        List<u8> sending_values;
+        u32 tag_list_version = 0;
+
+        // members and array elements are written through their own handle
+        std::unordered_map<std::string, int> member_handles;
+
+        // scan callback thread
+        List<WriteRequest> reporting;
+    };
+
+
+    static void destroy_member_handles(WriteQueue& q)
+    {
+        for (auto const& [name, handle] : q.member_handles)
+        {
+            plc_tag_destroy(handle);
+        }
+
+        q.member_handles.clear();
+    }
+
+
+    static void reset_write_queue(WriteQueue& q)
+    {
+        destroy_member_handles(q);
+
+        std::lock_guard<std::mutex> lock(q.mutex);
+
+        q.pending.clear();
+        q.pending_values.clear();
+        q.pending_index.clear();
+        q.done.clear();
+        q.sending.clear();
+        q.sending_values.clear();
+        q.reporting.clear();
+    }
+
+
+    static void queue_write(WriteQueue& q, WriteRequest& w, u8 const* src)
+    {
+        auto key = ((u64)w.path.tag_index << 32) | w.path.offset;
+
+        std::lock_guard<std::mutex> lock(q.mutex);
+
+        auto it = q.pending_index.find(key);
+        if (it != q.pending_index.end() && q.pending[it->second].value_size == w.value_size)
+        {
+            // last value wins
+            auto& old = q.pending[it->second];
+
+            w.value_offset = old.value_offset;
+
+            old.result.status = WriteStatus::REPLACED;
+            old.result.latency_ms = old.sw.get_time_milli();
+            q.done.push_back(std::move(old));
+
+            old = std::move(w);
+        }
+        else
+        {
+            w.value_offset = (u32)q.pending_values.size();
+            q.pending_values.resize(q.pending_values.size() + w.value_size);
+
+            q.pending_index[key] = (u32)q.pending.size();
+            q.pending.push_back(std::move(w));
+        }
+
+        auto& sent = q.pending[q.pending_index[key]];
+
+        std::copy(src, src + sent.value_size, q.pending_values.data() + sent.value_offset);
+    }
+
+
+    static int get_write_handle(ControllerAttr const& attr, TagMemory const& mem, SubscriptionPath const& path, WriteQueue& q)
+    {
+        auto const& conn = mem.connections[path.tag_index];
+
+        // whole tags use the scan handle, reads wait for the write
+        if (path.offset == 0 && path.elem_size * path.elem_count == conn.scan_offset.length)
+        {
+            return conn.connection_handle;
+        }
+
+        auto it = q.member_handles.find(path.plc_name);
+        if (it != q.member_handles.end())
+        {
+            return it->second;
+        }
+
+        auto rc = create_tag_handle(attr, path.plc_name, (int)path.elem_size, (int)path.elem_count);
+        if (rc < 0)
+        {
+            return rc;
+        }
+
+        q.member_handles.emplace(path.plc_name, rc);
+
+        return rc;
+    }
+
+
+    static void finish_write(WriteRequest& w, WriteStatus status)
+    {
+        w.is_sending = false;
+        w.result.status = status;
+        w.result.latency_ms = w.sw.get_time_milli();
+    }
+
+
+    static void start_write(ControllerAttr const& attr, TagMemory const& mem, WriteQueue& q, WriteRequest& w)
+    {
+        if (w.tag_list_version != q.tag_list_version || w.path.tag_index >= (u32)mem.connections.size())
+        {
+            finish_write(w, WriteStatus::FAILED);
+            return;
+        }
+
+        auto handle = get_write_handle(attr, mem, w.path, q);
+        if (handle <= 0)
+        {
+            finish_write(w, WriteStatus::FAILED);
+            return;
+        }
+
+        auto src = q.sending_values.data() + w.value_offset;
+
+        auto rc = plc_tag_set_raw_bytes(handle, 0, src, (int)w.value_size);
+        if (rc != PLCTAG_STATUS_OK)
+        {
+            finish_write(w, WriteStatus::FAILED);
+            return;
+        }
+
+        // queued without waiting so libplctag packs them together
+        rc = plc_tag_write(handle, 0);
+
+        if (rc == PLCTAG_STATUS_PENDING)
+        {
+            w.handle = handle;
+            w.is_sending = true;
+            return;
+        }
+
+        finish_write(w, rc == PLCTAG_STATUS_OK ? WriteStatus::OK : WriteStatus::FAILED);
+    }
+
+
+    // returns the number of writes still waiting
+    static u32 poll_writes(List<WriteRequest>& writes)
+    {
+        u32 n_sending = 0;
+
+        for (auto& w : writes)
+        {
+            if (!w.is_sending)
+            {
+                continue;
+            }
+
+            auto rc = plc_tag_status(w.handle);
+            if (rc == PLCTAG_STATUS_PENDING)
+            {
+                n_sending++;
+                continue;
+            }
+
+            finish_write(w, rc == PLCTAG_STATUS_OK ? WriteStatus::OK : WriteStatus::FAILED);
+        }
+
+        return n_sending;
+    }
+
+
+    // sent before the reads of the cycle and waited for
+    static void send_writes(ControllerAttr const& attr, TagMemory const& mem, WriteQueue& q, bool is_link_down, u32& n_sent, u32& n_failed)
+    {
+        {
+            std::lock_guard<std::mutex> lock(q.mutex);
+
+            std::swap(q.sending, q.pending);
+            std::swap(q.sending_values, q.pending_values);
+
+            q.pending.clear();
+            q.pending_values.clear();
+            q.pending_index.clear();
+        }
+
+        if (q.sending.empty())
+        {
+            return;
+        }
+
+        for (auto& w : q.sending)
+        {
+            if (is_link_down)
+            {
+                finish_write(w, WriteStatus::FAILED);
+                continue;
+            }
+
+            start_write(attr, mem, q, w);
+        }
+
+        Stopwatch sw;
+        sw.start();
+
+        while (poll_writes(q.sending) && sw.get_time_milli() < WRITE_TIMEOUT_MS)
+        {
+            tmh::delay_current_thread_us(100);
+        }
+
+        n_sent = (u32)q.sending.size();
+        n_failed = 0;
+
+        std::lock_guard<std::mutex> lock(q.mutex);
+
+        for (auto& w : q.sending)
+        {
+            if (w.is_sending)
+            {
+                // timed out, the handle stays busy until the write is aborted
+                plc_tag_abort(w.handle);
+                finish_write(w, WriteStatus::FAILED);
+            }
+
+            n_failed += w.result.status != WriteStatus::OK;
+
+            q.done.push_back(std::move(w));
+        }
+
+        q.sending.clear();
+    }
+
+
+    // calls on_done for every finished write, from the scan callback thread
+    static void report_writes(WriteQueue& q)
+    {
+        {
+            std::lock_guard<std::mutex> lock(q.mutex);
+
+            if (q.done.empty())
+            {
+                return;
+            }
+
+            std::swap(q.reporting, q.done);
+        }
+
+        for (auto const& w : q.reporting)
+        {
+            if (w.on_done)
+            {
+                w.on_done(w.result);
+            }
+        }
+
+        q.reporting.clear();
+    }
+
+
+    // called between cycles
+    static void update_write_targets(WriteQueue& q, u32 tag_list_version)
+    {
+        if (q.tag_list_version == tag_list_version)
+        {
+            return;
+        }
+
+        // member offsets may have moved
+        destroy_member_handles(q);
+
+        q.tag_list_version = tag_list_version;
+    }
+}
+
+
+/* decode plans */
+
+namespace /* private */
+{
+    // guards against a template that contains itself
+    constexpr u32 MAX_UDT_DEPTH = 16;
+
+
+    static bool is_hidden_field(UdtFieldType const& field)
+    {
+        // BOOL members are bits of hidden SINT host members
+        constexpr auto prefix = "ZZZZZZZZZZ";
+
+        return field.field_name.data() && !strncmp(field.name(), prefix, strlen(prefix));
+    }
+
+
+    static u32 push_path(List<char>& pool, List<char> const& path)
+    {
+        auto offset = (u32)pool.size();
+
+        pool.insert(pool.end(), path.begin(), path.end());
+        pool.push_back(0);
+
+        return offset;
+    }
+
+
+    static void append_path(List<char>& path, cstr str)
+    {
+        path.insert(path.end(), str, str + strlen(str));
+    }
+
+
+    // path holds the members leading to this UDT and is restored on return
+    static bool append_udt_steps(UdtType const& udt, u32 offset, u32 depth, PlcTagData const& data, List<char>& path, DecodePlan& plan)
+    {
+        if (depth >= MAX_UDT_DEPTH)
+        {
+            return false;
+        }
+
+        auto path_len = path.size();
+
+        for (auto const& field : udt.fields)
+        {
+            if (is_hidden_field(field))
+            {
+                continue;
+            }
+
+            if (!path.empty())
+            {
+                path.push_back('.');
+            }
+
+            append_path(path, field.name());
+
+            auto count = field.array_count ? field.array_count : 1;
+
+            if (!id32::is_udt_type(field.type_id))
+            {
+                DecodeStep step{};
+                step.type_id = field.type_id;
+                step.offset = offset + field.offset;
+                step.size = get_type_size(field.type_id, data);
+                step.array_count = count;
+                step.bit_number = field.bit_number;
+                step.path = push_path(plan.path_pool, path);
+
+                plan.steps.push_back(step);
+            }
+            else
+            {
+                auto nested = find_udt(field.type_id, data);
+                if (!nested)
+                {
+                    return false;
+                }
+
+                // arrays of UDTs are expanded
+                auto member_len = path.size();
+
+                for (u32 i = 0; i < count; ++i)
+                {
+                    if (field.is_array())
+                    {
+                        char index[16] = { 0 };
+                        qsnprintf(index, (int)sizeof(index), "[%u]", i);
+                        append_path(path, index);
+                    }
+
+                    if (!append_udt_steps(*nested, offset + field.offset + i * nested->size, depth + 1, data, path, plan))
+                    {
+                        return false;
+                    }
+
+                    path.resize(member_len);
+                }
+            }
+
+            path.resize(path_len);
+        }
+
+        return true;
+    }
+
+
+    static bool compile_plan(DataTypeId32 type_id, u32 element_count, PlcTagData const& data, DecodePlan& plan)
+    {
+        plan = DecodePlan{};
+        plan.type_id = type_id;
+        plan.element_count = element_count ? element_count : 1;
+
+        List<char> path;
+
+        if (!id32::is_udt_type(type_id))
+        {
+            DecodeStep step{};
+            step.type_id = type_id;
+            step.size = get_type_size(type_id, data);
+            step.path = push_path(plan.path_pool, path);
+
+            plan.element_size = step.size;
+            plan.steps.push_back(step);
+
+            return true;
+        }
+
+        auto udt = find_udt(type_id, data);
+        if (!udt)
+        {
+            return false;
+        }
+
+        plan.element_size = udt->size;
+
+        if (!append_udt_steps(*udt, 0, 0, data, path, plan))
+        {
+            plan = DecodePlan{};
+            return false;
+        }
+
+        return true;
+    }
+
+
+    static bool compile_tag_plan(Tag const& tag, PlcTagData const& data, DecodePlan& plan)
+    {
+        if (!compile_plan(tag.type_id, tag.array_count, data, plan))
+        {
+            return false;
+        }
+
+        if (!plan.element_size)
+        {
+            // strings etc. are sized by the controller
+            plan.element_size = tag.size() / plan.element_count;
+            plan.steps[0].size = plan.element_size;
+        }
+
+        if ((u64)plan.element_size * plan.element_count > tag.size())
+        {
+            plan = DecodePlan{};
+            return false;
+        }
+
+        return true;
+    }
+}
+
+
+/* columns */
+
+namespace /* private */
+{
+    // BOOL through LREAL
+    constexpr u32 N_COLUMNS = (u32)FixedType::LREAL - (u32)FixedType::BOOL + 1;
+
+
+    static bool is_column_type(DataTypeId32 type_id)
+    {
+        return type_id >= (DataTypeId32)FixedType::BOOL && type_id <= (DataTypeId32)FixedType::LREAL;
+    }
+
+
+    static void add_column_values(DecodeStep const& step, u32 tag_index, u64 offset, TypeColumn& col)
+    {
+        for (u32 i = 0; i < step.array_count; ++i)
+        {
+            col.source_offsets.push_back((u32)(offset + (u64)i * step.size));
+            col.tag_indexes.push_back(tag_index);
+
+            if (step.type_id == (DataTypeId32)FixedType::BOOL)
+            {
+                col.bit_numbers.push_back(step.is_bit() ? (u8)step.bit_number : 0);
+            }
+        }
+    }
+
+
+    static void build_columns(PlcTagData const& data, ColumnView& view)
+    {
+        view = ColumnView{};
+        view.tag_list_version = data.tag_list_version;
+        view.tag_count = (u32)data.tags.size();
+        view.first_tag_data = data.tags.empty() ? nullptr : data.tags[0].data();
+        view.columns.resize(N_COLUMNS);
+
+        for (u32 i = 0; i < N_COLUMNS; ++i)
+        {
+            auto& col = view.columns[i];
+            col.type_id = (DataTypeId32)FixedType::BOOL + i;
+            col.value_size = data_type_size((FixedType)col.type_id);
+        }
+
+        // tag values are in one buffer
+        for (auto const& tag : data.tags)
+        {
+            if (tag.size() && (!view.tag_data || tag.data() < view.tag_data))
+            {
+                view.tag_data = tag.data();
+            }
+        }
+
+        if (!view.tag_data)
+        {
+            return;
+        }
+
+        u64 end = 0;
+
+        DecodePlan plan{};
+
+        for (u32 t = 0; t < (u32)data.tags.size(); ++t)
+        {
+            auto& tag = data.tags[t];
+
+            if (!tag.size() || !compile_tag_plan(tag, data, plan))
+            {
+                continue;
+            }
+
+            auto tag_offset = (u64)(tag.data() - view.tag_data);
+
+            for (u32 e = 0; e < plan.element_count; ++e)
+            {
+                auto element_offset = tag_offset + (u64)e * plan.element_size;
+
+                for (auto const& step : plan.steps)
+                {
+                    if (!is_column_type(step.type_id) || step.size != data_type_size((FixedType)step.type_id))
+                    {
+                        continue;
+                    }
+
+                    auto& col = view.columns[step.type_id - (DataTypeId32)FixedType::BOOL];
+
+                    add_column_values(step, t, element_offset + step.offset, col);
+
+                    end = std::max(end, element_offset + step.offset + (u64)step.array_count * step.size);
+                }
+            }
+        }
+
+        view.can_gather = end <= (u64)INT32_MAX;
+
+        for (auto& col : view.columns)
+        {
+            col.values.resize((size_t)col.count() * col.value_size);
+        }
+    }
+
+
+    template <u32 SIZE>
+    static void gather_scalar(u8 const* base, u32 const* offsets, u8* dst, u32 begin, u32 end)
+    {
+        for (u32 i = begin; i < end; ++i)
+        {
+            memcpy(dst + (size_t)i * SIZE, base + offsets[i], SIZE);
+        }
+    }
+
+
+#ifdef GATHER_AVX2
+
+// compiled for AVX2 whatever the build flags, only called when the CPU has it
+#ifdef _MSC_VER
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+
+    static bool cpu_has_avx2()
+    {
+    #ifdef _MSC_VER
+
+        int info[4] = { 0 };
+
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+
+        // AVX, and the OS saves the YMM registers
+        __cpuid(info, 1);
+        if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+        {
+            return false;
+        }
+
+        __cpuidex(info, 7, 0);
+
+        return (info[1] & (1 << 5)) != 0;
+
+    #else
+
+        __builtin_cpu_init();
+
+        return __builtin_cpu_supports("avx2");
+
+    #endif
+    }
+
+
+    TARGET_AVX2 static u32 gather_4_avx2(u8 const* base, u32 const* offsets, u8* dst, u32 n)
+    {
+        u32 i = 0;
+
+        for (; i + 8 <= n; i += 8)
+        {
+            auto index = _mm256_loadu_si256((__m256i const*)(offsets + i));
+            auto values = _mm256_i32gather_epi32((int const*)base, index, 1);
+            _mm256_storeu_si256((__m256i*)(dst + (size_t)i * 4), values);
+        }
+
+        return i;
+    }
+
+
+    TARGET_AVX2 static u32 gather_8_avx2(u8 const* base, u32 const* offsets, u8* dst, u32 n)
+    {
+        u32 i = 0;
+
+        for (; i + 4 <= n; i += 4)
+        {
+            auto index = _mm_loadu_si128((__m128i const*)(offsets + i));
+            auto values = _mm256_i32gather_epi64((long long const*)base, index, 1);
+            _mm256_storeu_si256((__m256i*)(dst + (size_t)i * 8), values);
+        }
+
+        return i;
+    }
+
+
+    static bool const g_has_avx2 = cpu_has_avx2();
+
+
+    static u32 gather_4(u8 const* base, u32 const* offsets, u8* dst, u32 n)
+    {
+        return g_has_avx2 ? gather_4_avx2(base, offsets, dst, n) : 0;
+    }
+
+
+    static u32 gather_8(u8 const* base, u32 const* offsets, u8* dst, u32 n)
+    {
+        return g_has_avx2 ? gather_8_avx2(base, offsets, dst, n) : 0;
+    }
+
+#else
+
+    // no gather instructions, gather_scalar() copies every value
+    static u32 gather_4(u8 const*, u32 const*, u8*, u32) { return 0; }
+
+    static u32 gather_8(u8 const*, u32 const*, u8*, u32) { return 0; }
+
+#endif
+
+
+    static void gather_column(u8 const* base, bool can_gather, TypeColumn& col)
+    {
+        auto n = col.count();
+        auto offsets = col.source_offsets.data();
+        auto dst = col.values.data();
+
+        if (col.type_id == (DataTypeId32)FixedType::BOOL)
+        {
+            auto bits = col.bit_numbers.data();
+
+            for (u32 i = 0; i < n; ++i)
+            {
+                dst[i] = (base[offsets[i]] >> bits[i]) & 1;
+            }
+
+            return;
+        }
+
+        switch (col.value_size)
+        {
+        case 1:
+            gather_scalar<1>(base, offsets, dst, 0, n);
+            break;
+
+        case 2:
+            gather_scalar<2>(base, offsets, dst, 0, n);
+            break;
+
+        case 4:
+            gather_scalar<4>(base, offsets, dst, can_gather ? gather_4(base, offsets, dst, n) : 0, n);
+            break;
+
+        case 8:
+            gather_scalar<8>(base, offsets, dst, can_gather ? gather_8(base, offsets, dst, n) : 0, n);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+
+    static bool columns_match(PlcTagData const& data, ColumnView const& view)
+    {
+        return
+            view.columns.size() == N_COLUMNS &&
+            view.tag_list_version == data.tag_list_version &&
+            view.tag_count == (u32)data.tags.size() &&
+            (data.tags.empty() || data.tags[0].data() == view.first_tag_data);
+    }
+}
+
+
+/* tag list */
+
+namespace
+{
+    // every read at once is packed into replies too large for the connection
+    constexpr u32 MAX_UDT_READS_IN_FLIGHT = 16;
+
+    // a template that still fails is left out of udt_types and listed in missing_udt_types
+    constexpr u32 MAX_UDT_READ_ATTEMPTS = 3;
+
+
+    class UdtRead
+    {
+    public:
+        u16 udt_id = 0;
+        int handle = -1;
+
+        bool is_reading = false;
+        bool is_done = false;
+
+        u32 n_attempts = 0;
+
+        ByteBuffer buffer;
+    };
+
+
+    class TagListSync
+    {
+    public:
+        // reenumerate() was called
+        std::atomic<bool> is_requested = false;
+
+        // apply the new list, otherwise only compare it with the current one
+        bool is_updating = false;
+
+        // @tags then the @udt templates are read in the background
+        bool is_reading_listing = false;
+        bool is_reading_udts = false;
+
+        TagEntryStream listing;
+
+        // entries whose templates have been requested
+        u32 n_entries_checked = 0;
+
+        List<UdtRead> udt_reads;
+        List<UdtEntry> udt_entries;
+
+        // indexed by 12 bit UDT id, templates already requested
+        List<bool> udt_requested;
+
+        bool is_busy() const { return is_reading_listing || is_reading_udts; }
+    };
+
+
+    static void reset_tag_list_sync(TagListSync& sync)
+    {
+        for (auto& read : sync.udt_reads)
+        {
+            if (read.handle > 0)
+            {
+                plc_tag_destroy(read.handle);
+            }
+
+            mb::destroy_buffer(read.buffer);
+        }
+
+        destroy_vector(sync.udt_reads);
+        destroy_vector(sync.udt_entries);
+        destroy_vector(sync.udt_requested);
+        reset_tag_entry_stream(sync.listing);
+
+        sync.n_entries_checked = 0;
+        sync.is_updating = false;
+        sync.is_reading_listing = false;
+        sync.is_reading_udts = false;
+    }
+
+
+    static void start_listing_read(ControllerAttr const& attr, TagListSync& sync, bool update)
+    {
+        sync.is_updating |= update;
+
+        if (sync.is_busy() || attr.listing_handle < 0)
+        {
+            return;
+        }
+
+        reset_tag_entry_stream(sync.listing);
+        sync.n_entries_checked = 0;
+
+        // don't block the scan, the status is polled between cycles
+        auto rc = plc_tag_read(attr.listing_handle, 0);
+
+        sync.is_reading_listing = rc == PLCTAG_STATUS_OK || rc == PLCTAG_STATUS_PENDING;
+
+        if (!sync.is_reading_listing)
+        {
+            sync.is_updating = false;
+        }
+    }
+
+
+    static void start_udt_read(TagListSync& sync, u16 udt_id)
+    {
+        if (!udt_id || udt_id >= N_UDT_IDS)
+        {
+            return;
+        }
+
+        if (sync.udt_requested.empty())
+        {
+            sync.udt_requested.assign(N_UDT_IDS, false);
+        }
+
+        if (sync.udt_requested[udt_id])
+        {
+            return;
+        }
+
+        sync.udt_requested[udt_id] = true;
+
+        // sent by send_udt_reads()
+        UdtRead read{};
+        read.udt_id = udt_id;
+
+        sync.udt_reads.push_back(read);
+    }
+
+
+    static void send_udt_read(ControllerAttr const& attr, UdtRead& read)
+    {
+        read.n_attempts++;
+
+        if (read.handle < 0)
+        {
+            char udt[20];
+            qsnprintf(udt, 20, "@udt/%d", (int)read.udt_id);
+
+            read.handle = create_tag_handle(attr, udt, 1, 1);
+        }
+
+        if (read.handle < 0)
+        {
+            read.is_done = read.n_attempts >= MAX_UDT_READ_ATTEMPTS;
+            return;
+        }
+
+        auto rc = plc_tag_read(read.handle, 0);
+
+        read.is_reading = rc == PLCTAG_STATUS_OK || rc == PLCTAG_STATUS_PENDING;
+        read.is_done = !read.is_reading && read.n_attempts >= MAX_UDT_READ_ATTEMPTS;
+    }
+
+
+    // queued and failed reads are sent while fewer than MAX_UDT_READS_IN_FLIGHT are pending
+    static void send_udt_reads(ControllerAttr const& attr, TagListSync& sync)
+    {
+        u32 n_in_flight = 0;
+
+        for (auto const& read : sync.udt_reads)
+        {
+            n_in_flight += read.is_reading;
+        }
+
+        for (auto& read : sync.udt_reads)
+        {
+            if (n_in_flight >= MAX_UDT_READS_IN_FLIGHT)
+            {
+                return;
+            }
+
+            if (read.is_reading || read.is_done)
+            {
+                continue;
+            }
+
+            send_udt_read(attr, read);
+
+            n_in_flight += read.is_reading;
+        }
+    }
+
+
+    template <class ENTRY>
+    static void start_udt_reads(TagListSync& sync, List<ENTRY> const& entries)
+    {
+        for (auto const& e : entries)
+        {
+            start_udt_read(sync, id16::get_udt_id(e.type_code));
+        }
+    }
+
+
+    // returns true when every template has been read or has run out of attempts
+    static bool poll_udt_reads(ControllerAttr const& attr, TagListSync& sync)
+    {
+        // new reads are appended for nested UDTs
+        for (u32 i = 0; i < (u32)sync.udt_reads.size(); ++i)
+        {
+            auto& read = sync.udt_reads[i];
+
+            if (!read.is_reading || plc_tag_status(read.handle) == PLCTAG_STATUS_PENDING)
+            {
+                continue;
+            }
+
+            read.is_reading = false;
+
+            if (plc_tag_status(read.handle) != PLCTAG_STATUS_OK || !get_tag_buffer(read.handle, read.buffer))
+            {
+                // sent again by send_udt_reads()
+                read.is_done = read.n_attempts >= MAX_UDT_READ_ATTEMPTS;
+                continue;
+            }
+
+            read.is_done = true;
+
+            sync.udt_entries.push_back(parse_udt_entry(mb::make_view(read.buffer)));
+
+            // nested UDTs
+            start_udt_reads(sync, sync.udt_entries.back().fields);
+        }
+
+        send_udt_reads(attr, sync);
+
+        for (auto const& read : sync.udt_reads)
+        {
+            if (!read.is_done)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    // templates are requested as their tags arrive in the listing
+    static void start_entry_udt_reads(TagListSync& sync)
+    {
+        auto const& entries = sync.listing.entries;
+
+        for (; sync.n_entries_checked < (u32)entries.size(); ++sync.n_entries_checked)
+        {
+            start_udt_read(sync, id16::get_udt_id(entries[sync.n_entries_checked].type_code));
+        }
+    }
+
+
+    // parses the part of @tags that arrived since the last call
+    static bool read_listing_fragments(int listing_handle, TagEntryStream& stream)
+    {
+        auto n_received = plc_tag_get_int_attribute(listing_handle, "bytes_received", 0);
+        if (n_received < 0)
+        {
+            return false;
+        }
+
+        u8 fragment[4096];
+
+        while (stream.n_bytes < (u32)n_received)
+        {
+            auto length = std::min((u32)n_received - stream.n_bytes, (u32)sizeof(fragment));
+
+            auto rc = plc_tag_get_raw_bytes(listing_handle, (int)stream.n_bytes, fragment, (int)length);
+            if (rc != PLCTAG_STATUS_OK)
+            {
+                return false;
+            }
+
+            push_tag_entry_bytes(stream, { fragment, length });
+        }
+
+        return true;
+    }
+
+
+    // returns PLCTAG_STATUS_PENDING until all of @tags has been parsed
+    static int poll_listing_read(ControllerAttr const& attr, TagListSync& sync)
+    {
+        auto rc = plc_tag_status(attr.listing_handle);
+        if (rc != PLCTAG_STATUS_OK && rc != PLCTAG_STATUS_PENDING)
+        {
+            return rc;
+        }
+
+        if (!read_listing_fragments(attr.listing_handle, sync.listing))
+        {
+            return PLCTAG_ERR_BAD_DATA;
+        }
+
+        if (sync.is_updating)
+        {
+            start_entry_udt_reads(sync);
+            poll_udt_reads(attr, sync);
+        }
+
+        if (rc == PLCTAG_STATUS_OK && !sync.listing.partial.empty())
+        {
+            return PLCTAG_ERR_BAD_DATA; /* ends inside an entry */
+        }
+
+        return rc;
+    }
+
+
+    static bool udt_matches(UdtType const& udt, UdtEntry const& entry)
+    {
+        if (udt.size != entry.udt_size || udt.fields.size() != entry.fields.size())
+        {
+            return false;
+        }
+
+        if (udt.udt_name.length != entry.name_length || strncmp(udt.name(), entry.name_ptr, entry.name_length) != 0)
+        {
+            return false;
+        }
+
+        for (u32 i = 0; i < (u32)entry.fields.size(); ++i)
+        {
+            auto const& ft = udt.fields[i];
+            auto const& f = entry.fields[i];
+
+            if (ft.type_id != id32::get_data_type_id(f.type_code) ||
+                ft.offset != f.offset ||
+                ft.array_count != f.elem_count ||
+                ft.bit_number != f.bit_number ||
+                ft.field_name.length != f.name.length ||
+                strncmp(ft.name(), f.name.data(), f.name.length) != 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    // changed_ids are UDTs with a new layout
+    // returns false when udt_types was left as it was
+    static bool update_udt_types(List<UdtEntry> const& entries, DataTypeMemory& mem, PlcTagData& data, List<DataTypeId32>& changed_ids)
+    {
+        List<bool> is_added(N_UDT_IDS, false);
+
+        u32 n_udts = 0;
+        bool is_replaced = false;
+
+        for (auto const& entry : entries)
+        {
+            auto type_id = id32::get_udt_type_id(id16::TYPE_IS_STRUCT | entry.udt_id);
+            auto udt_id = id32::get_udt_id(type_id);
+
+            if (!type_id || is_added[udt_id])
+            {
+                continue;
+            }
+
+            is_added[udt_id] = true;
+            n_udts++;
+
+            // udt_index still refers to the current udt_types
+            auto udt = find_udt(type_id, data);
+
+            if (!udt)
+            {
+                is_replaced = true;
+                continue;
+            }
+
+            if (!udt_matches(*udt, entry))
+            {
+                is_replaced = true;
+                changed_ids.push_back(type_id);
+            }
+        }
+
+        // the same templates, possibly read in another order
+        if (!is_replaced && n_udts == (u32)data.udt_types.size())
+        {
+            return false;
+        }
+
+        return set_udt_types(entries, mem, data);
+    }
+
+
+    static bool tag_unchanged(Tag const& old_tag, Tag const& tag, List<DataTypeId32> const& changed_udt_ids)
+    {
+        return
+            old_tag.type_id == tag.type_id &&
+            old_tag.array_count == tag.array_count &&
+            old_tag.size() == tag.size() &&
+            !vector_contains(changed_udt_ids, tag.type_id);
+    }
+
+
+    static void move_tag_data(TagMemory const& src_mem, TagConnection const& src, Tag const& src_tag, TagMemory& dst_mem, TagConnection const& dst, Tag const& dst_tag)
+    {
+        auto len = src.scan_offset.length;
+
+        auto const copy = [len](u8* s, u8* d) { mh::copy_bytes(s, d, len); };
+
+        copy(mb::make_read_view(src_mem.scan_data, src.scan_offset).data, mb::make_read_view(dst_mem.scan_data, dst.scan_offset).data);
+        copy(mb::make_write_view(src_mem.scan_data, src.scan_offset).data, mb::make_write_view(dst_mem.scan_data, dst.scan_offset).data);
+
+        mh::copy(src_tag.value_bytes, dst_tag.value_bytes);
+    }
+
+
+    // called between cycles
+    static bool update_tags(ControllerAttr const& attr, TagEntryList const& entries, List<DataTypeId32> const& changed_udt_ids, TagMemory& mem, List<Tag>& tags)
+    {
+        TagMemory new_mem{};
+        List<Tag> new_tags;
+
+        if (!create_tags(entries, new_mem, new_tags))
+        {
+            return false;
+        }
+
+        new_mem.scan_cycle = mem.scan_cycle;
+        new_mem.scan_data.read_id = mem.scan_data.read_id;
+
+        std::unordered_map<std::string_view, u32> old_ids;
+        old_ids.reserve(tags.size());
+
+        for (u32 i = 0; i < (u32)tags.size(); ++i)
+        {
+            old_ids[tags[i].name()] = i;
+        }
+
+        constexpr auto NOT_KEPT = (u32)-1;
+        List<u32> new_ids(tags.size(), NOT_KEPT);
+
+        for (u32 i = 0; i < new_mem.n_tags; ++i)
+        {
+            auto& conn = new_mem.connections[i];
+            auto& tag = new_tags[i];
+
+            conn.tag_index = i;
+
+            auto it = old_ids.find(tag.name());
+
+            if (it == old_ids.end() || !tag_unchanged(tags[it->second], tag, changed_udt_ids))
+            {
+                // added or resized
+                tag.health = connect_tag(attr, tag, conn) ? TagHealth::OK : TagHealth::NOT_CONNECTED;
+                continue;
+            }
+
+            auto old_id = it->second;
+            auto const& old_conn = mem.connections[old_id];
+            auto const& old_tag = tags[old_id];
+
+            move_tag_data(mem, old_conn, old_tag, new_mem, conn, tag);
+
+            // keeps scanning with the same handle and health
+            auto scan_offset = conn.scan_offset;
+            conn = old_conn;
+            conn.scan_offset = scan_offset;
+            conn.tag_index = i;
+            conn.is_subscribed = false;
+
+            tag.health = old_tag.health;
+            tag.consecutive_failures = old_tag.consecutive_failures;
+
+            new_ids[old_id] = i;
+        }
+
+        for (auto sub : mem.subscriptions)
+        {
+            auto old_id = sub.tag_index;
+            auto new_id = new_ids[old_id];
+
+            if (new_id == NOT_KEPT)
+            {
+                plc_tag_destroy(sub.connection_handle);
+                continue;
+            }
+
+            auto& tag_conn = new_mem.connections[new_id];
+
+            sub.scan_offset.begin = sub.scan_offset.begin - mem.connections[old_id].scan_offset.begin + tag_conn.scan_offset.begin;
+            sub.tag_index = new_id;
+
+            new_mem.subscriptions.push_back(sub);
+            tag_conn.is_subscribed = true;
+        }
+
+        for (u32 i = 0; i < mem.n_tags; ++i)
+        {
+            auto const& conn = mem.connections[i];
+
+            if (new_ids[i] == NOT_KEPT && conn.is_connected())
+            {
+                plc_tag_destroy(conn.connection_handle);
+            }
+        }
+
+        destroy_tag_memory(mem);
+        mem = std::move(new_mem);
+
+        tags = std::move(new_tags);
+
+        return true;
+    }
+
+
+    static void apply_tag_list(ControllerAttr const& attr, TagListSync& sync, TagMemory& tag_mem, DataTypeMemory& dt_mem, PlcTagData& data)
+    {
+        List<DataTypeId32> changed_udt_ids;
+        auto udts_replaced = update_udt_types(sync.udt_entries, dt_mem, data, changed_udt_ids);
+
+        auto tags_replaced = false;
+
+        if (changed_udt_ids.empty() && tags_match(sync.listing.entries, data.tags))
+        {
+            data.tag_set_changed = false;
+        }
+        else if (update_tags(attr, sync.listing.entries, changed_udt_ids, tag_mem, data.tags))
+        {
+            tags_replaced = true;
+            data.tag_set_changed = false;
+        }
+
+        if (!udts_replaced && !tags_replaced)
+        {
+            return;
+        }
+
+        // udt_index and the type names point into the old lists, whichever of them was replaced
+        index_udt_types(data);
+        find_missing_udt_types(data);
+        set_tag_data_type_names(data);
+        set_udt_field_data_type_names(data);
+
+        data.tag_list_version++;
+    }
+
+
+    // called between cycles
+    static void update_tag_list(ControllerAttr const& attr, TagListSync& sync, TagMemory& tag_mem, DataTypeMemory& dt_mem, PlcTagData& data)
+    {
+        if (sync.is_requested.exchange(false))
+        {
+            start_listing_read(attr, sync, true);
+        }
+
+        if (sync.is_reading_listing)
+        {
+            // templates can change with the same id after a download, they are all read again
+            auto rc = poll_listing_read(attr, sync);
+            if (rc == PLCTAG_STATUS_PENDING)
+            {
+                return;
+            }
+
+            sync.is_reading_listing = false;
+
+            if (rc != PLCTAG_STATUS_OK)
+            {
+                reset_tag_list_sync(sync); /* tried again after the next reconnect */
+                return;
+            }
+
+            if (!sync.is_updating)
+            {
+                data.tag_set_changed = !tags_match(sync.listing.entries, data.tags);
+                reset_tag_list_sync(sync);
+                return;
+            }
+
+            sync.is_reading_udts = true;
+        }
+
+        if (sync.is_reading_udts)
+        {
+            if (!poll_udt_reads(attr, sync))
+            {
+                return;
+            }
+
+            sync.is_reading_udts = false;
+
+            apply_tag_list(attr, sync, tag_mem, dt_mem, data);
+            reset_tag_list_sync(sync);
+        }
+    }
+}
+
+
+/* scan cycle */
+
+namespace
+{
+    // failed reads are retried after 1, 2, 4 ... scans
+    constexpr u32 MAX_BACKOFF_CYCLES = 64;
+
+    // then only probed every QUARANTINE_PROBE_CYCLES scans
+    constexpr u32 QUARANTINE_FAILURES = 8;
+    constexpr u32 QUARANTINE_PROBE_CYCLES = 300;
+
+    // failed reads in a row from tags that were reading fine
+    constexpr u32 LINK_DOWN_FAILURES = 8;
+
+
+    class LinkState
+    {
+    public:
+        // one tag at a time is read until it answers again
+        bool is_down = false;
+        u32 probe_index = 0;
+
+        u32 n_failed_in_row = 0;
+
+        // per cycle
+        u32 n_read_ok = 0;
+        u32 n_link_failed = 0;
+
+        std::atomic<bool> reconnect_requested = false;
+    };
+
+
+    // connect() fails when nothing more of @tags or the templates arrives for this long
+    constexpr f64 ENUMERATE_IDLE_TIMEOUT_MS = 1000.0;
+
+
+    // handles are created as entries are parsed, while the rest of @tags downloads
+    static void connect_tag_entries(ControllerAttr const& attr, TagEntryList& entries, u32& n_connected)
+    {
+        for (; n_connected < (u32)entries.size(); ++n_connected)
+        {
+            auto& e = entries[n_connected];
+            if (!elem_size(e))
+            {
+                continue; /* skipped by create_tags() */
+            }
+
+            auto rc = start_tag_handle(attr, e.name, (int)e.elem_size, (int)e.elem_count);
+            if (rc >= 0)
+            {
+                e.connection_handle = rc;
+            }
+        }
+    }
+
+
+    // returns true when no handle is still being created, failed ones are left to connect_tags()
+    static bool poll_tag_entry_handles(TagEntryList& entries, u32& n_ready)
+    {
+        for (; n_ready < (u32)entries.size(); ++n_ready)
+        {
+            auto& e = entries[n_ready];
+            if (e.connection_handle < 0)
+            {
+                continue;
+            }
+
+            auto rc = plc_tag_status(e.connection_handle);
+            if (rc == PLCTAG_STATUS_PENDING)
+            {
+                return false;
+            }
+
+            if (rc != PLCTAG_STATUS_OK)
+            {
+                plc_tag_destroy(e.connection_handle);
+                e.connection_handle = -1;
+            }
+        }
+
+        return true;
+    }
+
+
+    static void destroy_tag_entry_handles(TagEntryList const& entries)
+    {
+        for (auto const& e : entries)
+        {
+            if (e.connection_handle > 0)
+            {
+                plc_tag_destroy(e.connection_handle);
+            }
+        }
+    }
+
+
+    static bool enumerate_tags(ControllerAttr& attr, TagMemory& tag_mem, DataTypeMemory& dt_mem, PlcTagData& data)
+    {
+        attr.listing_handle = create_tag_handle(attr, "@tags", 1, 1);
+        if (attr.listing_handle < 0)
+        {
+            return false;
+        }
+
+        TagListSync sync;
+        start_listing_read(attr, sync, true);
+
+        if (!sync.is_reading_listing)
+        {
+            return false;
+        }
+
+        auto& entries = sync.listing.entries;
+
+        u32 n_connected = 0;
+        u32 n_ready = 0;
+        u64 n_received = 0;
+
+        Stopwatch sw;
+        sw.start();
+
+        auto rc = PLCTAG_STATUS_PENDING;
+
+        while (true)
+        {
+            if (sync.is_reading_listing)
+            {
+                rc = poll_listing_read(attr, sync);
+                sync.is_reading_listing = rc == PLCTAG_STATUS_PENDING;
+            }
+
+            connect_tag_entries(attr, entries, n_connected);
+
+            if (rc != PLCTAG_STATUS_OK && rc != PLCTAG_STATUS_PENDING)
+            {
+                break;
+            }
+
+            auto is_ready = poll_tag_entry_handles(entries, n_ready);
+
+            if (!sync.is_reading_listing && poll_udt_reads(attr, sync) && is_ready)
+            {
+                break;
+            }
+
+            auto n = sync.listing.n_bytes + sync.udt_entries.size() + n_ready;
+            if (n != n_received)
+            {
+                n_received = n;
+                sw.start();
+            }
+            else if (sw.get_time_milli() > ENUMERATE_IDLE_TIMEOUT_MS)
+            {
+                rc = PLCTAG_ERR_TIMEOUT;
+                break;
+            }
+
+            tmh::delay_current_thread_ms(1);
+        }
+
+        if (rc != PLCTAG_STATUS_OK || entries.empty() || !create_tags(entries, tag_mem, data.tags))
+        {
+            destroy_tag_entry_handles(entries);
+            reset_tag_list_sync(sync);
+            return false;
+        }
+
+        set_udt_types(sync.udt_entries, dt_mem, data);
+
+        reset_tag_list_sync(sync);
+
+        index_udt_types(data);
+        find_missing_udt_types(data);
+        set_tag_data_type_names(data);
+        set_udt_field_data_type_names(data);
+
+        return true;
+    }
+
+
+    static void connect_tags(ControllerAttr const& attr, TagMemory& mem, List<Tag>& tags)
+    {
+        assert(mem.n_tags == (u32)tags.size());
+
+        for (u32 i = 0; i < mem.n_tags; ++i)
+        {
+            auto& conn = mem.connections[i];
+            auto& tag = tags[i];
+
+            conn.tag_index = i;
+
+            // most were connected while the listing downloaded
+            auto is_connected = conn.is_connected() || connect_tag(attr, tag, conn);
+
+            tag.health = is_connected ? TagHealth::OK : TagHealth::NOT_CONNECTED;
+        }
+    }
+
+
+    class ScanCounts
+    {
+    public:
+        u32 n_failed = 0;
+        u32 n_retried = 0;
+
+        u32 n_writes = 0;
+        u32 n_writes_failed = 0;
+        f64 write_ms = 0.0;
+    };
+
+
+    static void update_link(LinkState& link, TagConnection const& conn)
+    {
+        if (conn.scan_ok)
+        {
+            link.n_read_ok++;
+            link.n_failed_in_row = 0;
+            return;
+        }
+
+        // tags that never read or were already failing say nothing about the link
+        if (!conn.has_read || conn.n_failures)
+        {
+            return;
+        }
+
+        link.n_link_failed++;
+        link.n_failed_in_row++;
+
+        // don't wait out a timeout for every remaining tag
+        link.is_down = link.n_failed_in_row >= LINK_DOWN_FAILURES;
+    }
+
+
+    static void read_tags(List<TagConnection>& connections, u64 cycle, LinkState& link, ScanCounts& counts)
+    {
+        auto timeout = 100;
+
+        for (auto& conn : connections)
+        {
+            if (!conn.is_connected() || conn.is_subscribed)
+            {
+                continue;
+            }
+
+            conn.scan_skipped = link.is_down || cycle < conn.next_read_cycle;
+            if (conn.scan_skipped)
+            {
+                continue;
+            }
+
+            counts.n_retried += conn.n_failures > 0;
+
+            auto rc = plc_tag_read(conn.connection_handle, timeout);
+            conn.scan_ok = rc == PLCTAG_STATUS_OK;
+
+            update_link(link, conn);
+        }
+    }
+
+
+    static int find_probe_handle(TagMemory const& mem, LinkState& link)
+    {
+        auto n_connections = (u32)mem.connections.size();
+        auto n = n_connections + (u32)mem.subscriptions.size();
+
+        for (u32 i = 0; i < n; ++i)
+        {
+            auto id = (link.probe_index + i) % n;
+            auto const& conn = id < n_connections ? mem.connections[id] : mem.subscriptions[id - n_connections];
+
+            if (conn.has_read && !conn.is_subscribed)
+            {
+                link.probe_index = id;
+                return conn.connection_handle;
+            }
+        }
+
+        return -1;
+    }
+
+
+    // returns true when the link is back
+    static bool probe_link(TagMemory& mem, LinkState& link)
+    {
+        auto timeout = 100;
+
+        auto handle = find_probe_handle(mem, link);
+
+        if (handle > 0 && plc_tag_read(handle, timeout) != PLCTAG_STATUS_OK)
+        {
+            // the tag may be gone from the controller, try another next cycle
+            link.probe_index++;
+            return false;
+        }
+
+        link.is_down = false;
+        link.n_failed_in_row = 0;
+
+        // handles survived the reconnect, read everything this cycle
+        for (auto& conn : mem.connections)
+        {
+            conn.next_read_cycle = 0;
+        }
+
+        for (auto& conn : mem.subscriptions)
+        {
+            conn.next_read_cycle = 0;
+        }
+
+        return true;
+    }
+
+
+    static void update_health(TagConnection& conn, u64 cycle)
+    {
+        if (conn.scan_ok)
+        {
+            conn.n_failures = 0;
+            conn.next_read_cycle = 0;
+            return;
+        }
+
+        conn.n_failures++;
+
+        if (conn.n_failures >= QUARANTINE_FAILURES)
+        {
+            // probe read
+            conn.next_read_cycle = cycle + QUARANTINE_PROBE_CYCLES;
+            return;
+        }
+
+        auto backoff = std::min((u64)1 << (conn.n_failures - 1), (u64)MAX_BACKOFF_CYCLES);
+
+        conn.next_read_cycle = cycle + 1 + backoff;
+    }
+
+
+    // the write half still has the value from two scans ago, keep the last one
+    static void keep_tag_bytes(TagConnection const& conn, ParallelBuffer<u8>& scan_data)
+    {
+        auto src = mb::make_read_view(scan_data, conn.scan_offset);
+        auto dst = mb::make_write_view(scan_data, conn.scan_offset);
+
+        mh::copy(src, dst);
+    }
+
+
+    static void keep_tag_bytes(List<TagConnection> const& connections, ParallelBuffer<u8>& scan_data)
+    {
+        for (auto const& conn : connections)
+        {
+            if (conn.is_connected() && !conn.is_subscribed)
+            {
+                keep_tag_bytes(conn, scan_data);
+            }
+        }
+    }
+
+
+    static void get_tag_bytes(List<TagConnection>& connections, ParallelBuffer<u8>& scan_data, u64 cycle, LinkState const& link, ScanCounts& counts)
+    {
+        for (auto& conn : connections)
+        {
+            if (!conn.is_connected() || conn.is_subscribed)
+            {
+                continue;
+            }
+
+            if (conn.scan_skipped)
+            {
+                keep_tag_bytes(conn, scan_data);
+                continue;
+            }
+
+            if (conn.scan_ok)
+            {
+                auto view = mb::make_write_view(scan_data, conn.scan_offset);
+                auto rc = plc_tag_get_raw_bytes(conn.connection_handle, 0, view.data, view.length);
+                conn.scan_ok = rc == PLCTAG_STATUS_OK;
+                conn.has_read |= conn.scan_ok;
+            }
+
+            if (!conn.scan_ok)
+            {
+                keep_tag_bytes(conn, scan_data);
+            }
+
+            counts.n_failed += !conn.scan_ok;
+
+            if (!conn.scan_ok && link.is_down)
+            {
+                continue; /* not the tag's fault */
+            }
+
+            update_health(conn, cycle);
+        }
+    }
+
+
+    static void scan_tags(ControllerAttr const& attr, TagMemory& mem, LinkState& link, WriteQueue& writes, ScanCounts& counts)
+    {
+        Stopwatch sw;
+        sw.start();
+
+        counts = {};
+
+        auto cycle = mem.scan_cycle++;
+
+        auto is_link_up = !link.is_down || probe_link(mem, link);
+
+        // writes go ahead of the reads
+        send_writes(attr, mem, writes, !is_link_up, counts.n_writes, counts.n_writes_failed);
+        counts.write_ms = sw.get_time_milli();
+
+        if (is_link_up)
+        {
+            link.n_read_ok = 0;
+            link.n_link_failed = 0;
+
+            read_tags(mem.connections, cycle, link, counts);
+            read_tags(mem.subscriptions, cycle, link, counts);
+
+            // fewer than LINK_DOWN_FAILURES tags and none answered
+            link.is_down |= link.n_link_failed && !link.n_read_ok;
+
+            tmh::delay_current_thread_ms(10);
+
+            get_tag_bytes(mem.connections, mem.scan_data, cycle, link, counts);
+            get_tag_bytes(mem.subscriptions, mem.scan_data, cycle, link, counts);
+        }
+        else
+        {
+            // nothing was read, publish the same values again
+            keep_tag_bytes(mem.connections, mem.scan_data);
+            keep_tag_bytes(mem.subscriptions, mem.scan_data);
+        }
+
+        tmh::delay_current_thread_ms(sw, 40);
+    }
+
+
+    static TagHealth to_tag_health(TagConnection const& conn)
+    {
+        if (!conn.is_connected())
+        {
+            return TagHealth::NOT_CONNECTED;
+        }
+
+        if (!conn.n_failures)
+        {
+            return TagHealth::OK;
+        }
+
+        return conn.n_failures < QUARANTINE_FAILURES ? TagHealth::BACKOFF : TagHealth::QUARANTINED;
+    }
+
+
+    static void set_tag_health(Tag& tag, TagConnection const& conn)
+    {
+        auto health = to_tag_health(conn);
+
+        // a subscribed tag shows its least healthy subscription
+        if ((int)health > (int)tag.health)
+        {
+            tag.health = health;
+        }
+
+        tag.consecutive_failures = std::max(tag.consecutive_failures, conn.n_failures);
+    }
+
+
+    // called between cycles, not while the scan callback reads the tags
+    static void publish_tag_health(TagMemory const& mem, List<Tag>& tags, ScanTelemetry& telemetry)
+    {
+        for (auto& tag : tags)
+        {
+            tag.health = TagHealth::OK;
+            tag.consecutive_failures = 0;
+        }
+
+        for (auto const& conn : mem.connections)
+        {
+            if (!conn.is_subscribed)
+            {
+                set_tag_health(tags[conn.tag_index], conn);
+            }
+        }
+
+        for (auto const& conn : mem.subscriptions)
+        {
+            set_tag_health(tags[conn.tag_index], conn);
+        }
+
+        telemetry.tags_in_backoff = 0;
+        telemetry.tags_quarantined = 0;
+
+        for (auto const& tag : tags)
+        {
+            telemetry.tags_in_backoff += tag.health == TagHealth::BACKOFF;
+            telemetry.tags_quarantined += tag.health == TagHealth::QUARANTINED;
+        }
+    }
+
+
+    static void reset_link(LinkState& link)
+    {
+        link.is_down = false;
+        link.probe_index = 0;
+        link.n_failed_in_row = 0;
+        link.reconnect_requested = false;
+    }
+
+
+    // called between cycles
+    static void update_connection(ControllerAttr const& attr, LinkState& link, TagListSync& sync, PlcTagData& data)
+    {
+        if (link.reconnect_requested.exchange(false))
+        {
+            plc_tag_conn_reconnect(attr.connection);
+
+            link.is_down = true;
+            data.tag_set_changed = false;
+        }
+        else if (link.is_down && !data.is_link_down)
+        {
+            // the old socket can sit on TCP retransmits long after the link returns
+            plc_tag_conn_reconnect(attr.connection);
+
+            data.telemetry.link_losses++;
+        }
+
+        if (!link.is_down && data.is_link_down)
+        {
+            start_listing_read(attr, sync, false);
+        }
+
+        data.is_link_down = link.is_down;
+    }
+
+
+    // connection of the first tag that ends after byte_offset, connections are in scan_offset order
+    static u32 next_connection(List<TagConnection> const& connections, u32 conn_id, u32 byte_offset)
+    {
+        auto n = (u32)connections.size();
+
+        while (conn_id < n && connections[conn_id].scan_offset.begin + connections[conn_id].scan_offset.length <= byte_offset)
+        {
+            ++conn_id;
+        }
+
+        return conn_id;
+    }
+
+
+    // copy the scanned values to the published values and list the tags whose bytes differ
+    // tags that were not read this cycle were carried forward, see keep_tag_bytes()
+    static void copy_changed_tags(TagMemory& mem, List<u32>& changed_tags)
+    {
+        changed_tags.clear();
+
+        auto src = mb::make_read_view(mem.scan_data);
+        auto dst = mb::make_view(mem.public_tag_data);
+
+        assert(src.length <= dst.length);
+
+        auto& connections = mem.connections;
+
+        auto len = src.length;
+        auto len32 = len - len % 32;
+
+        u32 conn_id = 0;
+
+        auto const add_changed = [&](u32 byte_offset)
+        {
+            conn_id = next_connection(connections, conn_id, byte_offset);
+            if (conn_id >= (u32)connections.size())
+            {
+                return byte_offset + 1;
+            }
+
+            auto& offset = connections[conn_id].scan_offset;
+            if (byte_offset < offset.begin)
+            {
+                return offset.begin;
+            }
+
+            auto tag_index = connections[conn_id].tag_index;
+            if (changed_tags.empty() || changed_tags.back() != tag_index)
+            {
+                changed_tags.push_back(tag_index);
+            }
+
+            // rest of the tag is already changed
+            return offset.begin + offset.length;
+        };
+
+        for (u32 i = 0; i < len32; i += 32)
+        {
+            auto bits = mh::copy_diff_32(src.data + i, dst.data + i);
+
+            while (bits)
+            {
+                auto next = add_changed(i + mh::count_trailing_zeros(bits));
+                if (next >= i + 32)
+                {
+                    break;
+                }
+
+                bits &= ~((1u << (next - i)) - 1);
+            }
+        }
+
+        for (u32 i = len32; i < len; ++i)
+        {
+            if (src.data[i] != dst.data[i])
+            {
+                dst.data[i] = src.data[i];
+                add_changed(i);
+            }
+        }
+    }
+  
+}
+
+
+/* telemetry */
+
+namespace
+{
+    static u32 to_bucket_index(u64 value_us)
+    {
+        constexpr auto N = LatencyHistogram::N_LINEAR;
+        constexpr auto S = LatencyHistogram::N_SUB_BUCKETS;
+
+        if (value_us < N)
+        {
+            return (u32)value_us;
+        }
+
+        // keep the top 4 bits of the value
+        u32 shift = 0;
+        while ((value_us >> shift) >= 2 * S)
+        {
+            ++shift;
+        }
+
+        auto index = N + (shift - 1) * S + (u32)(value_us >> shift) - S;
+
+        return std::min(index, LatencyHistogram::N_BUCKETS - 1);
+    }
+
+
+    static u64 to_bucket_max(u32 index)
+    {
+        constexpr auto N = LatencyHistogram::N_LINEAR;
+        constexpr auto S = LatencyHistogram::N_SUB_BUCKETS;
+
+        if (index < N)
+        {
+            return index;
+        }
+
+        auto shift = (index - N) / S + 1;
+        auto top = (u64)((index - N) % S + S);
+
+        return ((top + 1) << shift) - 1;
+    }
+
+
+    static void record_ms(LatencyHistogram& hist, f64 value_ms)
+    {
+        auto value_us = value_ms > 0.0 ? (u64)(value_ms * 1000.0) : 0;
+
+        hist.counts[to_bucket_index(value_us)]++;
+
+        if (!hist.total_count || value_us < hist.min_us)
+        {
+            hist.min_us = value_us;
+        }
+
+        if (value_us > hist.max_us)
+        {
+            hist.max_us = value_us;
+        }
+
+        hist.total_count++;
+        hist.total_us += value_us;
+    }
+
+
+    static void update_telemetry(ScanTelemetry& tm, f64 network_ms, f64 process_ms, f64 scan_ms, ScanCounts const& counts)
+    {
+        auto lateness_ms = std::max(scan_ms - tm.target_scan_ms, 0.0);
+
+        tm.cycle_count++;
+        tm.overrun_count += lateness_ms > 0.0;
+
+        tm.last_network_ms = network_ms;
+        tm.last_process_ms = process_ms;
+        tm.last_scan_ms = scan_ms;
+        tm.last_lateness_ms = lateness_ms;
+
+        tm.last_tags_failed = counts.n_failed;
+        tm.last_tags_retried = counts.n_retried;
+        tm.total_tags_failed += counts.n_failed;
+        tm.total_tags_retried += counts.n_retried;
+
+        tm.last_writes = counts.n_writes;
+        tm.total_writes += counts.n_writes;
+        tm.total_writes_failed += counts.n_writes_failed;
+
+        if (counts.n_writes)
+        {
+            record_ms(tm.write, counts.write_ms);
+        }
+
+        record_ms(tm.network, network_ms);
+        record_ms(tm.process, process_ms);
+        record_ms(tm.scan, scan_ms);
+        record_ms(tm.lateness, lateness_ms);
+    }
+}
+
+
+/* scan worker */
+
+namespace /* private */
+{
+    // spins before sleeping, the other thread is usually close to done
+    constexpr u32 HANDOFF_SPIN_COUNT = 2000;
+
+
+    // One thread posts, the other waits for the count to reach a value
+    class Handoff
+    {
+    public:
+        std::atomic<u64> count = 0;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+
+
+    static void post(Handoff& h)
+    {
+        {
+            std::lock_guard<std::mutex> lock(h.mutex);
+            h.count.fetch_add(1, std::memory_order_release);
+        }
+
+        h.cv.notify_one();
+    }
+
+
+    static void wait_for(Handoff& h, u64 count)
+    {
+        for (u32 i = 0; i < HANDOFF_SPIN_COUNT; ++i)
+        {
+            if (h.count.load(std::memory_order_acquire) >= count)
+            {
+                return;
+            }
+
+            std::this_thread::yield();
+        }
+
+        std::unique_lock<std::mutex> lock(h.mutex);
+        h.cv.wait(lock, [&]() { return h.count.load(std::memory_order_acquire) >= count; });
+    }
+
+
+    class ScanWorker
+    {
+    public:
+        std::thread thread;
+
+        // a cycle may start, and the scan leg of a cycle is done
+        Handoff start;
+        Handoff done;
+
+        u64 n_cycles = 0;
+
+        bool is_stopping = false;
+
+        bool is_pinned = false;
+        bool is_realtime = false;
+    };
+
+
+    static bool pin_current_thread(int cpu)
+    {
+        if (cpu < 0)
+        {
+            return false;
+        }
+
+#ifdef _WIN32
+
+        if (cpu >= 64)
+        {
+            return false;
+        }
+
+        return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+
+#else
+
+        if (cpu >= CPU_SETSIZE)
+        {
+            return false;
+        }
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+
+#endif
+    }
+
+
+    static bool set_realtime_priority()
+    {
+#ifdef _WIN32
+
+        return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+
+#else
+
+        // above the default so it is not starved, below kernel threads at the top
+        sched_param param{};
+        param.sched_priority = (sched_get_priority_min(SCHED_FIFO) + sched_get_priority_max(SCHED_FIFO)) / 2;
+
+        return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+
+#endif
+    }
+
+
+    template <class F>
+    static void start_scan_worker(ScanWorker& worker, ScanThreadConfig const& config, F const& scan_leg)
+    {
+        worker.n_cycles = 0;
+        worker.is_stopping = false;
+
+        worker.thread = std::thread([&worker, config, &scan_leg]()
+        {
+            worker.is_pinned = pin_current_thread(config.cpu);
+            worker.is_realtime = config.realtime_priority && set_realtime_priority();
+
+            for (u64 n = 1; ; ++n)
+            {
+                wait_for(worker.start, n);
+
+                if (worker.is_stopping)
+                {
+                    return;
+                }
+
+                scan_leg();
+
+                post(worker.done);
+            }
+        });
+    }
+
+
+    // the scan leg runs on the worker while process_leg runs on this thread
+    template <class F>
+    static void run_cycle(ScanWorker& worker, F const& process_leg)
+    {
+        auto n = ++worker.n_cycles;
+
+        post(worker.start);
+
+        process_leg();
+
+        wait_for(worker.done, n);
+    }
+
+
+    static void stop_scan_worker(ScanWorker& worker)
+    {
+        worker.is_stopping = true;
+
+        post(worker.start);
+
+        worker.thread.join();
+    }
+}
+
+
+/* consumers */
+
+namespace /* private */
+{
+    // Filled slot ids, pushed by the scan
+    // Popped by the consumer, and by the scan when it drops the oldest
+    class SlotRing
+    {
+    public:
+        List<std::atomic<u32>> slot_ids;
+
+        std::atomic<u64> head = 0;
+        std::atomic<u64> tail = 0;
+    };
+
+
+    static void create_ring(SlotRing& ring, u32 capacity)
+    {
+        ring.slot_ids = List<std::atomic<u32>>(capacity);
+        ring.head = 0;
+        ring.tail = 0;
+    }
+
+
+    static u32 ring_count(SlotRing const& ring)
+    {
+        return (u32)(ring.tail.load(std::memory_order_acquire) - ring.head.load(std::memory_order_acquire));
+    }
+
+
+    // one thread only, the ring is never full, it has a place for every slot
+    static void push_slot(SlotRing& ring, u32 slot_id)
+    {
+        auto tail = ring.tail.load(std::memory_order_relaxed);
+
+        ring.slot_ids[tail % ring.slot_ids.size()].store(slot_id, std::memory_order_relaxed);
+        ring.tail.store(tail + 1, std::memory_order_release);
+    }
+
+
+    static bool pop_slot(SlotRing& ring, u32& slot_id)
+    {
+        auto head = ring.head.load(std::memory_order_acquire);
+
+        while (head < ring.tail.load(std::memory_order_acquire))
+        {
+            // only overwritten after head moves on, then the exchange fails
+            auto id = ring.slot_ids[head % ring.slot_ids.size()].load(std::memory_order_relaxed);
+
+            if (ring.head.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                slot_id = id;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    class Consumer
+    {
+    public:
+        u32 consumer_id = 0;
+
+        snapshot_f on_snapshot;
+        Backpressure policy = Backpressure::DROP_OLDEST;
+
+        // capacity + 1, the consumer holds one while the rest wait
+        List<ScanSnapshot> slots;
+
+        SlotRing ready;
+        SlotRing free;
+
+        // ready and free were pushed
+        Handoff published;
+        Handoff freed;
+
+        std::thread thread;
+        std::atomic<bool> is_stopping = false;
+
+        std::atomic<u64> n_delivered = 0;
+        std::atomic<u64> n_dropped = 0;
+        std::atomic<u64> max_block_us = 0;
+    };
+
+
+    class ConsumerList
+    {
+    public:
+        std::mutex mutex;
+
+        // shared with publish_snapshot(), a removed consumer lives until the scan lets go of it
+        List<std::shared_ptr<Consumer>> consumers;
+
+        // scan thread, copied from consumers under the lock
+        List<std::shared_ptr<Consumer>> publishing;
+
+        u32 next_id = 1;
+    };
+
+
+    static u64 timestamp_us()
+    {
+        namespace chr = std::chrono;
+
+        return (u64)chr::duration_cast<chr::microseconds>(chr::system_clock::now().time_since_epoch()).count();
+    }
+
+
+    static void run_consumer(Consumer& c)
+    {
+        u32 slot_id = 0;
+
+        for (;;)
+        {
+            auto n = c.published.count.load(std::memory_order_acquire);
+
+            if (pop_slot(c.ready, slot_id))
+            {
+                c.on_snapshot(c.slots[slot_id]);
+                c.n_delivered++;
+
+                push_slot(c.free, slot_id);
+
+                if (c.policy == Backpressure::BLOCK)
+                {
+                    post(c.freed);
+                }
 
-            if (!scan_udt_entry(attr, id, udt_buffer))
-            {
                 continue;
             }
 
-            auto entry = parse_udt_entry(mb::make_view(udt_buffer));
+            // snapshots already queued are delivered first
+            if (c.is_stopping)
+            {
+                return;
+            }
+
+            wait_for(c.published, n + 1);
+        }
+    }
+
 
-            add_udt_type(data.udt_types, dt_mem, entry);
+    static void start_consumer(Consumer& c, ConsumerConfig const& config)
+    {
+        auto capacity = c.policy == Backpressure::LATEST_ONLY ? 1u : std::max(config.capacity, 1u);
+        auto n_slots = capacity + 1;
+
+        c.slots.resize(n_slots);
 
-            // add new udts as we find them
-            append_udt_ids(entry.fields, udt_ids);
+        create_ring(c.ready, n_slots);
+        create_ring(c.free, n_slots);
 
-            mb::destroy_buffer(udt_buffer);
+        for (u32 i = 0; i < n_slots; ++i)
+        {
+            push_slot(c.free, i);
         }
 
-        set_tag_data_type_names(data.tags, data.udt_types);
-        set_udt_field_data_type_names(data.udt_types);
+        c.thread = std::thread([&c]() { run_consumer(c); });
+    }
+
 
-        return true;
+    static void stop_consumer(Consumer& c)
+    {
+        c.is_stopping = true;
+
+        post(c.published);
+        post(c.freed);
+
+        c.thread.join();
     }
 
 
-    static void connect_tags(ControllerAttr const& attr, TagMemory& mem, List<Tag>& tags)
+    static void fill_snapshot(ScanSnapshot& snap, PlcTagData const& data, ByteView const& tag_data, u64 version, u64 time_us)
     {
-        assert(mem.n_tags == (u32)tags.size());
+        snap.version = version;
+        snap.timestamp_us = time_us;
+        snap.is_link_down = data.is_link_down;
 
-        for (u32 i = 0; i < mem.n_tags; ++i)
-        {
-            auto& conn = mem.connections[i];
-            auto& tag = tags[i];
+        auto n_tags = (u32)data.tags.size();
 
-            connect_tag(attr, tag, conn);
+        if (snap.tag_list_version != data.tag_list_version || snap.tag_offsets.size() != n_tags)
+        {
+            snap.tag_list_version = data.tag_list_version;
+            snap.tag_offsets.resize(n_tags);
+            snap.tag_sizes.resize(n_tags);
 
-            //tag.connection_ok = connect_tag(attr, tag, conn);
+            for (u32 i = 0; i < n_tags; ++i)
+            {
+                auto const& tag = data.tags[i];
+                snap.tag_offsets[i] = (u32)(tag.data() - tag_data.data);
+                snap.tag_sizes[i] = tag.size();
+            }
         }
+
+        // keeps the capacity, no allocation once every slot has seen a scan
+        snap.values.assign(tag_data.data, tag_data.data + tag_data.length);
+        snap.changed_tags.assign(data.changed_tags.begin(), data.changed_tags.end());
     }
 
 
-    static void scan_tags(TagMemory& mem)
+    static bool take_free_slot(Consumer& c, u32& slot_id)
     {
-        auto timeout = 100;
+        if (pop_slot(c.free, slot_id))
+        {
+            return true;
+        }
+
+        if (c.policy != Backpressure::BLOCK)
+        {
+            // drop the oldest, if the consumer took it a slot is free next scan
+            c.n_dropped++;
+            return pop_slot(c.ready, slot_id);
+        }
 
         Stopwatch sw;
         sw.start();
 
-        for (auto& conn : mem.connections)
+        for (;;)
         {
-            if (!conn.is_connected())
+            auto n = c.freed.count.load(std::memory_order_acquire);
+
+            if (pop_slot(c.free, slot_id))
             {
-                continue;
+                break;
             }
 
-            auto rc = plc_tag_read(conn.connection_handle, timeout);
-            conn.scan_ok = rc == PLCTAG_STATUS_OK;
+            if (c.is_stopping)
+            {
+                return false;
+            }
+
+            wait_for(c.freed, n + 1);
         }
 
-        tmh::delay_current_thread_ms(10);
+        auto block_us = (u64)sw.get_time_micro();
+        if (block_us > c.max_block_us)
+        {
+            c.max_block_us = block_us;
+        }
 
-        for (auto& conn : mem.connections)
+        return true;
+    }
+
+
+    static void publish_to(Consumer& c, PlcTagData const& data, ByteView const& tag_data, u64 version, u64 time_us)
+    {
+        u32 slot_id = 0;
+
+        if (!take_free_slot(c, slot_id))
+        {
+            return;
+        }
+
+        fill_snapshot(c.slots[slot_id], data, tag_data, version, time_us);
+
+        push_slot(c.ready, slot_id);
+        post(c.published);
+    }
+
+
+    // the scan only waits for BLOCK consumers, and without holding the list lock
+    static void publish_snapshot(ConsumerList& list, PlcTagData const& data, TagMemory const& mem, u64 version)
+    {
+        auto& publishing = list.publishing;
+
+        {
+            std::lock_guard<std::mutex> lock(list.mutex);
+            publishing.assign(list.consumers.begin(), list.consumers.end());
+        }
+
+        if (publishing.empty())
+        {
+            return;
+        }
+
+        auto tag_data = mb::make_view(mem.public_tag_data);
+        auto time_us = timestamp_us();
+
+        // consumers that never wait are not held up by one that does
+        for (auto& c : publishing)
         {
-            if (!conn.is_connected() || !conn.scan_ok)
+            if (c->policy != Backpressure::BLOCK)
             {
-                continue;
+                publish_to(*c, data, tag_data, version, time_us);
             }
+        }
 
-            auto view = mb::make_write_view(mem.scan_data , conn.scan_offset);
-            auto rc = plc_tag_get_raw_bytes(conn.connection_handle, 0, view.data, view.length);
-            conn.scan_ok = rc == PLCTAG_STATUS_OK;
+        for (auto& c : publishing)
+        {
+            if (c->policy == Backpressure::BLOCK)
+            {
+                publish_to(*c, data, tag_data, version, time_us);
+            }
         }
 
-        tmh::delay_current_thread_ms(sw, 40);
+        // keeps the capacity
+        publishing.clear();
     }
 
 
-    static void copy_tags(TagMemory& mem)
+    static void remove_all_consumers(ConsumerList& list)
     {
-        auto src = mb::make_read_view(mem.scan_data);
-        auto dst = mb::make_view(mem.public_tag_data);
+        List<std::shared_ptr<Consumer>> removed;
 
-        mh::copy(src, dst);
+        {
+            std::lock_guard<std::mutex> lock(list.mutex);
+            removed = std::move(list.consumers);
+            list.consumers.clear();
+        }
+
+        for (auto& c : removed)
+        {
+            stop_consumer(*c);
+        }
     }
-  
 }
 
 
@@ -1381,12 +4328,22 @@ namespace plcscan
     static DataTypeMemory g_dt_mem;
     static TagMemory g_tag_mem;
     static ControllerAttr g_attr;
+    static LinkState g_link;
+    static TagListSync g_sync;
+    static WriteQueue g_writes;
+    static ConsumerList g_consumers;
+
+    static std::atomic<bool> g_is_scanning = false;
 
 
     void shutdown()
     {
+        remove_all_consumers(g_consumers);
+        reset_tag_list_sync(g_sync);
+        reset_write_queue(g_writes);
         destroy_data_type_memory(g_dt_mem);
         destroy_tag_memory(g_tag_mem);
+        destroy_controller(g_attr);
         plc_tag_shutdown();
     }
 
@@ -1419,7 +4376,10 @@ namespace plcscan
         g_attr.gateway = gateway;
         g_attr.path = path;
 
-        init_controller(g_attr);
+        if (!init_controller(g_attr))
+        {
+            return false;
+        }
 
         if (!enumerate_tags(g_attr, g_tag_mem, g_dt_mem, data))
         {
@@ -1428,11 +4388,166 @@ namespace plcscan
 
         connect_tags(g_attr, g_tag_mem, data.tags);        
 
+        reset_link(g_link);
+        reset_tag_list_sync(g_sync);
+        reset_write_queue(g_writes);
+        g_writes.tag_list_version = data.tag_list_version;
+
+        data.is_link_down = false;
+        data.tag_set_changed = false;
+
         data.is_connected = true;
         return true;
     }
 
 
+    bool subscribe(cstr tag_path, PlcTagData& data)
+    {
+        if (!data.is_connected || !tag_path)
+        {
+            return false;
+        }
+
+        SubscriptionPath path{};
+
+        if (!resolve_subscription(tag_path, data, path))
+        {
+            return false;
+        }
+
+        return subscribe_tag(g_attr, path, g_tag_mem);
+    }
+
+
+    bool write(cstr tag_path, u8 const* src, u32 size, PlcTagData const& data, write_f const& on_done)
+    {
+        if (!data.is_connected || !tag_path || !src)
+        {
+            return false;
+        }
+
+        WriteRequest w{};
+
+        if (!resolve_subscription(tag_path, data, w.path) || size != w.path.elem_size * w.path.elem_count)
+        {
+            return false;
+        }
+
+        w.value_size = size;
+        w.tag_list_version = data.tag_list_version;
+        w.on_done = on_done;
+        w.sw.start();
+
+        queue_write(g_writes, w, src);
+
+        return true;
+    }
+
+
+    bool reconnect(PlcTagData& data)
+    {
+        if (!data.is_connected)
+        {
+            return false;
+        }
+
+        // handled by scan() between cycles
+        g_link.reconnect_requested = true;
+
+        return true;
+    }
+
+
+    bool reenumerate(PlcTagData& data)
+    {
+        if (!data.is_connected)
+        {
+            return false;
+        }
+
+        // handled by scan() between cycles
+        g_sync.is_requested = true;
+
+        if (g_is_scanning)
+        {
+            return true;
+        }
+
+        do
+        {
+            update_tag_list(g_attr, g_sync, g_tag_mem, g_dt_mem, data);
+            tmh::delay_current_thread_ms(1);
+        }
+        while (g_sync.is_busy());
+
+        return true;
+    }
+
+
+    UdtType const* find_udt_type(DataTypeId32 type_id, PlcTagData const& data)
+    {
+        return find_udt(type_id, data);
+    }
+
+
+    // udt_types and udt_fields were filled in without connect(), e.g. from a capture
+    void update_udt_lookups(PlcTagData& data)
+    {
+        index_udt_types(data);
+    }
+
+
+    bool compile_decode_plan(DataTypeId32 type_id, PlcTagData const& data, DecodePlan& plan)
+    {
+        return compile_plan(type_id, 1, data, plan);
+    }
+
+
+    bool compile_decode_plan(Tag const& tag, PlcTagData const& data, DecodePlan& plan)
+    {
+        return compile_tag_plan(tag, data, plan);
+    }
+
+
+    bool update_columns(PlcTagData const& data, ColumnView& view)
+    {
+        if (!data.is_connected)
+        {
+            return false;
+        }
+
+        if (!columns_match(data, view))
+        {
+            build_columns(data, view);
+        }
+
+        if (!view.tag_data)
+        {
+            return false;
+        }
+
+        for (auto& col : view.columns)
+        {
+            gather_column(view.tag_data, view.can_gather, col);
+        }
+
+        return true;
+    }
+
+
+    TypeColumn const* get_column(TagType type, ColumnView const& view)
+    {
+        auto i = (u32)type - (u32)TagType::BOOL;
+
+        if (type > TagType::LREAL || i >= (u32)view.columns.size())
+        {
+            return nullptr;
+        }
+
+        return view.columns.data() + i;
+    }
+
+
     TagType get_tag_type(DataTypeId32 type_id)
     {
         if (id32::is_udt_type(type_id))
@@ -1457,9 +4572,103 @@ namespace plcscan
 
         return TagType::MISC;
     }
+
+
+    f64 get_percentile_ms(LatencyHistogram const& hist, f64 percentile)
+    {
+        if (!hist.total_count)
+        {
+            return 0.0;
+        }
+
+        percentile = std::clamp(percentile, 0.0, 100.0);
+
+        auto target = std::max((u64)(percentile / 100.0 * hist.total_count + 0.5), (u64)1);
+
+        u64 count = 0;
+        for (u32 i = 0; i < LatencyHistogram::N_BUCKETS; ++i)
+        {
+            count += hist.counts[i];
+            if (count >= target)
+            {
+                return std::min(to_bucket_max(i), hist.max_us) / 1000.0;
+            }
+        }
+
+        return hist.max_ms();
+    }
     
     
-    void scan(data_f const& scan_cb, bool_f const& scan_condition, PlcTagData& data)
+    u32 add_consumer(snapshot_f const& on_snapshot, ConsumerConfig const& config)
+    {
+        if (!on_snapshot)
+        {
+            return 0;
+        }
+
+        auto c = std::make_shared<Consumer>();
+        c->on_snapshot = on_snapshot;
+        c->policy = config.policy;
+
+        start_consumer(*c, config);
+
+        std::lock_guard<std::mutex> lock(g_consumers.mutex);
+
+        c->consumer_id = g_consumers.next_id++;
+        g_consumers.consumers.push_back(std::move(c));
+
+        return g_consumers.consumers.back()->consumer_id;
+    }
+
+
+    bool remove_consumer(u32 consumer_id)
+    {
+        std::shared_ptr<Consumer> removed;
+
+        {
+            std::lock_guard<std::mutex> lock(g_consumers.mutex);
+
+            auto& list = g_consumers.consumers;
+
+            auto it = std::find_if(list.begin(), list.end(), [&](auto const& c) { return c->consumer_id == consumer_id; });
+            if (it == list.end())
+            {
+                return false;
+            }
+
+            removed = std::move(*it);
+            list.erase(it);
+        }
+
+        // outside the lock, the scan and other consumers do not wait for the queue to drain
+        stop_consumer(*removed);
+
+        return true;
+    }
+
+
+    bool get_consumer_stats(u32 consumer_id, ConsumerStats& stats)
+    {
+        std::lock_guard<std::mutex> lock(g_consumers.mutex);
+
+        for (auto const& c : g_consumers.consumers)
+        {
+            if (c->consumer_id == consumer_id)
+            {
+                stats.snapshots_delivered = c->n_delivered;
+                stats.snapshots_dropped = c->n_dropped;
+                stats.queued = ring_count(c->ready);
+                stats.max_block_ms = c->max_block_us / 1000.0;
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    void scan(data_f const& scan_cb, bool_f const& scan_condition, PlcTagData& data, ScanThreadConfig const& config)
     {
         constexpr int target_scan_ms = 100;
 
@@ -1486,43 +4695,70 @@ namespace plcscan
             }
         };
 
+        auto& telemetry = data.telemetry;
+        telemetry = {};
+        telemetry.target_scan_ms = target_scan_ms;
+
+        ScanCounts counts{};
+        f64 network_ms = 0.0;
+        f64 process_ms = 0.0;
+        u64 snapshot_version = 0;
+
         Stopwatch sw;
 
         auto const scan = [&]()
         { 
-            scan_tags(g_tag_mem);            
-            acc_network_ms += sw.get_time_milli();
+            scan_tags(g_attr, g_tag_mem, g_link, g_writes, counts);
+            network_ms = sw.get_time_milli();
         };
 
         auto const process = [&]() 
         {
-            copy_tags(g_tag_mem);
+            report_writes(g_writes);
+            copy_changed_tags(g_tag_mem, data.changed_tags);
+            publish_snapshot(g_consumers, data, g_tag_mem, ++snapshot_version);
             scan_cb(data);
-            acc_process_ms += sw.get_time_milli();
+            process_ms = sw.get_time_milli();
         };
 
-        f_array<2> procs = 
-        {
-            scan,
-            process
-        };
+        ScanWorker worker;
+        start_scan_worker(worker, config, scan);
+
+        g_is_scanning = true;
 
         sw.start();
 
         do
         {
-            execute_parallel(procs);
+            run_cycle(worker, process);
+
+            telemetry.is_scan_thread_pinned = worker.is_pinned;
+            telemetry.is_scan_thread_realtime = worker.is_realtime;
 
             mb::flip_read_write(g_tag_mem.scan_data);
 
             tmh::delay_current_thread_ms(sw, target_scan_ms);
 
-            acc_scan_ms += sw.get_time_milli();
+            auto scan_ms = sw.get_time_milli();
             sw.start();
 
+            acc_network_ms += network_ms;
+            acc_process_ms += process_ms;
+            acc_scan_ms += scan_ms;
+
+            publish_tag_health(g_tag_mem, data.tags, telemetry);
+            update_connection(g_attr, g_link, g_sync, data);
+            update_tag_list(g_attr, g_sync, g_tag_mem, g_dt_mem, data);
+            update_write_targets(g_writes, data.tag_list_version);
+            update_telemetry(telemetry, network_ms, process_ms, scan_ms, counts);
+
             next_scan();
         } 
         while (scan_condition());
+
+        stop_scan_worker(worker);
+
+        g_is_scanning = false;
     }    
 }
 
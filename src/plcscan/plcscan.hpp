@@ -18,6 +18,22 @@ namespace plcscan
     using DataTypeId32 = u32;
 
 
+    enum class TagHealth : int
+    {
+        // reads succeed
+        OK,
+
+        // recent reads failed, retried after a growing number of scans
+        BACKOFF,
+
+        // failed repeatedly, only probed now and then
+        QUARANTINED,
+
+        // no tag handle could be created
+        NOT_CONNECTED
+    };
+
+
     class Tag
     {
     public:
@@ -29,13 +45,16 @@ namespace plcscan
 
         ByteView value_bytes;
 
-        // TODO: tag/connection status
+        // updated after every scan cycle
+        TagHealth health = TagHealth::NOT_CONNECTED;
+        u32 consecutive_failures = 0;
 
         cstr name() const { return tag_name.data(); }
         cstr type() const { return data_type_name.data(); }
         u8* data() const { return value_bytes.data; }
         u32 size() const { return (u32)value_bytes.length; }
         bool is_array() const { return array_count > 1; }
+        bool is_ok() const { return health == TagHealth::OK; }
     };
 
 
@@ -75,6 +94,26 @@ namespace plcscan
     };
 
 
+    // The fields of one UDT, a range of PlcTagData::udt_fields
+    class UdtFieldRange
+    {
+    public:
+        u32 first = 0;
+        u32 count = 0;
+
+        // set by update_udt_lookups()
+        UdtFieldType const* field_data = nullptr;
+
+        UdtFieldType const* begin() const { return field_data; }
+        UdtFieldType const* end() const { return field_data + count; }
+
+        u32 size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        UdtFieldType const& operator [] (u32 i) const { return field_data[i]; }
+    };
+
+
     class UdtType
     {
     public:
@@ -83,7 +122,7 @@ namespace plcscan
         StringView udt_name;
         StringView udt_description;
 
-        std::vector<UdtFieldType> fields;
+        UdtFieldRange fields;
 
         u32 size = 0;
 
@@ -92,6 +131,265 @@ namespace plcscan
     };
 
 
+    // One leaf member of a value, nested UDTs are flattened
+    class DecodeStep
+    {
+    public:
+        // never a UDT
+        DataTypeId32 type_id = 0;
+
+        // bytes from the start of the value
+        u32 offset = 0;
+
+        // bytes per element, 0 when the type has no fixed size
+        u32 size = 0;
+
+        // elements of a fixed type array, size bytes apart
+        u32 array_count = 1;
+
+        i32 bit_number = -1;
+
+        // dotted member path, offset into DecodePlan::path_pool
+        u32 path = 0;
+
+        bool is_array() const { return array_count > 1; }
+        bool is_bit() const { return bit_number >= 0; }
+    };
+
+
+    // Every leaf of a UDT or of a tag, see compile_decode_plan()
+    // The steps decode one element, element e starts at e * element_size
+    class DecodePlan
+    {
+    public:
+        DataTypeId32 type_id = 0;
+
+        u32 element_count = 1;
+        u32 element_size = 0;
+
+        List<DecodeStep> steps;
+
+        List<char> path_pool;
+
+        cstr path(DecodeStep const& step) const { return path_pool.data() + step.path; }
+    };
+
+
+    // Every value of one numeric type, from tags and UDT leaves, in one array
+    class TypeColumn
+    {
+    public:
+        DataTypeId32 type_id = 0;
+        u32 value_size = 0;
+
+        // value i is read from source_offsets[i] bytes after ColumnView::tag_data
+        List<u32> source_offsets;
+
+        // BOOL only, the bit of the source byte
+        List<u8> bit_numbers;
+
+        // index into PlcTagData::tags of each value
+        List<u32> tag_indexes;
+
+        // value_size bytes per value, BOOL values are 0 or 1
+        List<u8> values;
+
+        u32 count() const { return (u32)tag_indexes.size(); }
+
+        template <typename T>
+        T const* data() const { return (T const*)values.data(); }
+    };
+
+
+    // Columns of BOOL through LREAL values, see update_columns()
+    class ColumnView
+    {
+    public:
+        List<TypeColumn> columns;
+
+        // start of the scanned tag values
+        u8 const* tag_data = nullptr;
+
+        // the columns are built again when these change
+        u8 const* first_tag_data = nullptr;
+        u32 tag_list_version = 0;
+        u32 tag_count = 0;
+
+        // offsets fit the 32 bit signed indexes of the gather instructions
+        bool can_gather = false;
+    };
+
+
+    // HDR style, 8 linear buckets per power of two (12.5% resolution)
+    // Fixed size, recording a value never allocates
+    class LatencyHistogram
+    {
+    public:
+        static constexpr u32 N_LINEAR = 16;
+        static constexpr u32 N_SUB_BUCKETS = 8;
+        static constexpr u32 N_BUCKETS = N_LINEAR + 32 * N_SUB_BUCKETS;
+
+        u64 counts[N_BUCKETS] = { 0 };
+
+        u64 total_count = 0;
+        u64 total_us = 0;
+        u64 min_us = 0;
+        u64 max_us = 0;
+
+        f64 mean_ms() const { return total_count ? total_us / (total_count * 1000.0) : 0.0; }
+        f64 max_ms() const { return max_us / 1000.0; }
+    };
+
+
+    class ScanTelemetry
+    {
+    public:
+        u64 cycle_count = 0;
+
+        u32 target_scan_ms = 0;
+
+        // cycles that took longer than target_scan_ms
+        u64 overrun_count = 0;
+
+        f64 last_network_ms = 0.0;
+        f64 last_process_ms = 0.0;
+        f64 last_scan_ms = 0.0;
+
+        // how far the next cycle starts behind schedule
+        f64 last_lateness_ms = 0.0;
+
+        u32 last_tags_failed = 0;
+        u32 last_tags_retried = 0;
+
+        u64 total_tags_failed = 0;
+        u64 total_tags_retried = 0;
+
+        // tag health after the last cycle
+        u32 tags_in_backoff = 0;
+        u32 tags_quarantined = 0;
+
+        // times the controller stopped answering
+        u64 link_losses = 0;
+
+        // writes sent in the last cycle, failures include timeouts
+        u32 last_writes = 0;
+        u64 total_writes = 0;
+        u64 total_writes_failed = 0;
+
+        LatencyHistogram network;
+        LatencyHistogram process;
+        LatencyHistogram scan;
+        LatencyHistogram lateness;
+
+        // time spent sending writes, cycles without writes are not recorded
+        LatencyHistogram write;
+
+        // ScanThreadConfig settings that were applied
+        bool is_scan_thread_pinned = false;
+        bool is_scan_thread_realtime = false;
+    };
+
+
+    // Tag reads run on a thread started by scan(), the callback runs on the thread that called scan()
+    class ScanThreadConfig
+    {
+    public:
+        // run the scan thread on this CPU only, -1 to let the OS choose
+        int cpu = -1;
+
+        // SCHED_FIFO on Linux (needs CAP_SYS_NICE), THREAD_PRIORITY_TIME_CRITICAL on Windows
+        bool realtime_priority = false;
+    };
+
+
+    enum class WriteStatus : int
+    {
+        OK,
+
+        // a later write to the same tag or member was sent instead
+        REPLACED,
+
+        FAILED
+    };
+
+
+    class WriteResult
+    {
+    public:
+        WriteStatus status = WriteStatus::FAILED;
+
+        // from write() until the controller answered
+        f64 latency_ms = 0.0;
+
+        bool is_ok() const { return status == WriteStatus::OK; }
+    };
+
+
+    enum class Backpressure : int
+    {
+        // a full queue drops its oldest snapshot
+        DROP_OLDEST,
+
+        // only the newest snapshot waits, capacity is 1
+        LATEST_ONLY,
+
+        // the scan waits for room, nothing is dropped
+        BLOCK
+    };
+
+
+    class ConsumerConfig
+    {
+    public:
+        Backpressure policy = Backpressure::DROP_OLDEST;
+
+        // snapshots waiting for the consumer
+        u32 capacity = 8;
+    };
+
+
+    class ConsumerStats
+    {
+    public:
+        u64 snapshots_delivered = 0;
+        u64 snapshots_dropped = 0;
+
+        // snapshots waiting now
+        u32 queued = 0;
+
+        // longest a BLOCK consumer held up the scan
+        f64 max_block_ms = 0.0;
+    };
+
+
+    // Tag values of one scan, copied for a consumer thread
+    class ScanSnapshot
+    {
+    public:
+        // counts scans from 1, a gap means snapshots were dropped
+        u64 version = 0;
+
+        // microseconds since the epoch
+        u64 timestamp_us = 0;
+
+        // tag i of PlcTagData::tags while its tag_list_version matches
+        u32 tag_list_version = 0;
+
+        bool is_link_down = false;
+
+        List<u8> values;
+        List<u32> tag_offsets;
+        List<u32> tag_sizes;
+
+        // changed since the previous scan, not the previous snapshot received
+        List<u32> changed_tags;
+
+        u32 tag_count() const { return (u32)tag_offsets.size(); }
+        u8 const* value(u32 tag_index) const { return values.data() + tag_offsets[tag_index]; }
+        u32 size(u32 tag_index) const { return tag_sizes[tag_index]; }
+    };
+
+
     class PlcTagData
     {
     public:
@@ -99,12 +397,36 @@ namespace plcscan
         List<UdtType> udt_types;
         List<Tag> tags;
 
+        // the fields of every UDT in one table, in udt_types order
+        List<UdtFieldType> udt_fields;
+
+        // indexes into tags whose value changed in the last scan
+        List<u32> changed_tags;
+
+        // position in udt_types of every 12 bit UDT id, see find_udt_type()
+        List<u16> udt_index;
+
+        // UDTs that tags refer to whose templates could not be read, their tags are scanned as raw bytes
+        List<DataTypeId32> missing_udt_types;
+
         bool is_init = false;
         bool is_connected = false;
 
+        // the controller stopped answering, tags keep their last values
+        bool is_link_down = false;
+
+        // the controller's tag list no longer matches tags, see reenumerate()
+        bool tag_set_changed = false;
+
+        // incremented when reenumerate() changes tags or udt_types
+        u32 tag_list_version = 0;
+
         f64 network_ms = 0.0;
         f64 process_ms = 0.0;
         f64 scan_ms = 0.0;
+
+        // updated after every cycle
+        ScanTelemetry telemetry;
     };
 }
 
@@ -138,6 +460,10 @@ namespace plcscan
     using data_f = std::function<void(PlcTagData const&)>;
     using bool_f = std::function<bool()>;
 
+    using write_f = std::function<void(WriteResult const&)>;
+
+    using snapshot_f = std::function<void(ScanSnapshot const&)>;
+
 
     void shutdown();
 
@@ -145,9 +471,37 @@ namespace plcscan
     
     bool connect(cstr gateway, cstr path, PlcTagData& data);
 
+    bool subscribe(cstr tag_path, PlcTagData& data);
+
+    bool write(cstr tag_path, u8 const* src, u32 size, PlcTagData const& data, write_f const& on_done = nullptr);
+
+    bool reconnect(PlcTagData& data);
+
+    bool reenumerate(PlcTagData& data);
+
     TagType get_tag_type(DataTypeId32 type_id);
 
-    void scan(data_f const& scan_cb, bool_f const& scan_condition, PlcTagData& data);    
+    UdtType const* find_udt_type(DataTypeId32 type_id, PlcTagData const& data);
+
+    void update_udt_lookups(PlcTagData& data);
+
+    bool compile_decode_plan(DataTypeId32 type_id, PlcTagData const& data, DecodePlan& plan);
+
+    bool compile_decode_plan(Tag const& tag, PlcTagData const& data, DecodePlan& plan);
+
+    bool update_columns(PlcTagData const& data, ColumnView& view);
+
+    TypeColumn const* get_column(TagType type, ColumnView const& view);
+
+    f64 get_percentile_ms(LatencyHistogram const& hist, f64 percentile);
+
+    u32 add_consumer(snapshot_f const& on_snapshot, ConsumerConfig const& config = {});
+
+    bool remove_consumer(u32 consumer_id);
+
+    bool get_consumer_stats(u32 consumer_id, ConsumerStats& stats);
+
+    void scan(data_f const& scan_cb, bool_f const& scan_condition, PlcTagData& data, ScanThreadConfig const& config = {});    
 }
 
 
@@ -342,7 +342,7 @@ namespace memory_buffer
 	MemoryView<T> sub_view(MemoryView<T> const& view, u32 begin, u32 end)
 	{
 		assert(end > begin);
-		assert(view.length > end);
+		assert(view.length >= end);
 
 		MemoryView<T> sub_view{};
 
@@ -508,7 +508,7 @@ namespace memory_buffer
 		assert(buffer.p_data_[0]);
 		assert(buffer.p_capacity_);
 
-		assert((buffer.size_ - offset.begin) >= offset.length);
+		assert((buffer.p_size_ - offset.begin) >= offset.length);
 
 		MemoryView<T> view{};
 
@@ -4,6 +4,16 @@
 
 #include <cstring>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 
 namespace memory_helper
 {
@@ -150,6 +160,73 @@ namespace memory_helper
     }
 
 
+    inline u32 count_trailing_zeros(u32 bits)
+    {
+        assert(bits);
+
+    #ifdef _MSC_VER
+        unsigned long i = 0;
+        _BitScanForward(&i, bits);
+        return (u32)i;
+    #else
+        return (u32)__builtin_ctz(bits);
+    #endif
+    }
+
+
+    // copies 32 bytes and returns a bit for each byte that was different
+    inline u32 copy_diff_32(u8* src, u8* dst)
+    {
+    #if defined(__AVX2__)
+
+        auto a = _mm256_loadu_si256((__m256i*)src);
+        auto b = _mm256_loadu_si256((__m256i*)dst);
+        _mm256_storeu_si256((__m256i*)dst, a);
+
+        return ~(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+
+    #elif defined(__SSE2__) || defined(_M_X64)
+
+        auto a0 = _mm_loadu_si128((__m128i*)src);
+        auto a1 = _mm_loadu_si128((__m128i*)(src + 16));
+        auto b0 = _mm_loadu_si128((__m128i*)dst);
+        auto b1 = _mm_loadu_si128((__m128i*)(dst + 16));
+        _mm_storeu_si128((__m128i*)dst, a0);
+        _mm_storeu_si128((__m128i*)(dst + 16), a1);
+
+        auto eq0 = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(a0, b0));
+        auto eq1 = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(a1, b1));
+
+        return ~(eq0 | (eq1 << 16));
+
+    #else
+
+        auto src64 = (u64*)src;
+        auto dst64 = (u64*)dst;
+
+        u64 diff = 0;
+        for (u32 i = 0; i < 4; ++i)
+        {
+            diff |= src64[i] ^ dst64[i];
+        }
+
+        u32 bits = 0;
+        if (diff)
+        {
+            for (u32 i = 0; i < 32; ++i)
+            {
+                bits |= (u32)(src[i] != dst[i]) << i;
+            }
+        }
+
+        copy_bytes(src, dst, 32);
+
+        return bits;
+
+    #endif
+    }
+
+
     template <typename T>
     static T cast_numeric_bytes(u8* src, u32 size)
     {
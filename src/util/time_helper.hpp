@@ -4,14 +4,15 @@
 #include <thread>
 
 
+// steady_clock does not jump when the system time is adjusted
 class Stopwatch
 {
 private:
-	std::chrono::system_clock::time_point start_;
-	std::chrono::system_clock::time_point end_;
+	std::chrono::steady_clock::time_point start_;
+	std::chrono::steady_clock::time_point end_;
 	bool is_on_ = false;
 
-	std::chrono::system_clock::time_point now() { return std::chrono::system_clock::now(); }
+	std::chrono::steady_clock::time_point now() { return std::chrono::steady_clock::now(); }
 
 public:
 	Stopwatch()